@@ -100,8 +100,10 @@ inline void HphpArray::init(uint size) {
   m_tableMask = computeMaskFromNumElms(size);
   size_t tableSize = computeTableSize(m_tableMask);
   size_t maxElms = computeMaxElms(m_tableMask);
+  // New arrays start out packed, so allocData() leaves out the hash;
+  // unpack() allocates and initializes it.
+  m_packed = true;
   allocData(maxElms, tableSize);
-  initHash(m_hash, tableSize);
   m_pos = ArrayData::invalid_index;
 }
 
@@ -128,20 +130,16 @@ HphpArray::HphpArray(uint size, const TypedValue* values) :
   assert(size <= m_tableMask + 1);
   // append values by moving -- Caller assumes we update refcount.  Values
   // are in reverse order since they come from the stack, which grows down.
-  // This code is hand-specialized from nextInsert().
-  assert(m_size == 0 && m_hLoad == 0 && m_nextKI == 0);
-  ElmInd* hash = m_hash;
+  // This code is hand-specialized from nextInsert(); the result is packed.
+  assert(m_packed && m_size == 0 && m_hLoad == 0 && m_nextKI == 0);
   Elm* data = m_data;
   for (uint i = 0; i < size; i++) {
-    assert(hash[i] == HphpArray::ElmIndEmpty);
     const TypedValue& tv = values[size - i - 1];
     data[i].data.m_data = tv.m_data;
     data[i].data.m_type = tv.m_type;
     data[i].setIntKey(i);
-    hash[i] = i;
   }
   m_size = size;
-  m_hLoad = size;
   m_lastE = size - 1;
   m_nextKI = size;
   if (size > 0) m_pos = 0;
@@ -190,9 +188,10 @@ void HphpArray::dumpDebugInfo() const {
          uintptr_t(this));
   fprintf(stderr, "m_data = %p\tm_hash = %p\n"
          "m_tableMask = %u\tm_size = %d\tm_hLoad = %d\n"
-         "m_nextKI = %" PRId64 "\t\tm_lastE = %d\tm_pos = %zd\n",
+         "m_nextKI = %" PRId64 "\t\tm_lastE = %d\tm_pos = %zd\n"
+         "m_packed = %d\n",
          m_data, m_hash, m_tableMask, m_size, m_hLoad,
-         m_nextKI, m_lastE, m_pos);
+         m_nextKI, m_lastE, m_pos, int(m_packed));
   fprintf(stderr, "Elements:\n");
   ssize_t lastE = m_lastE;
   Elm* elms = m_data;
@@ -218,7 +217,7 @@ void HphpArray::dumpDebugInfo() const {
     fprintf(stderr, "  [%3d..%-3zd] <uninitialized>\n", m_lastE+1, maxElms-1);
   }
   fprintf(stderr, "Hash table:");
-  for (size_t i = 0; i < tableSize; ++i) {
+  for (size_t i = 0; !m_packed && i < tableSize; ++i) {
     if ((i % 8) == 0) {
       fprintf(stderr, "\n  [%3zd..%-3zd]", i, i+7);
     }
@@ -444,12 +443,13 @@ static bool hitStringKey(const HphpArray::Elm* e, const StringData* s,
   // Therefore the assertion below must hold.
   assert(e->data.m_type != HphpArray::KindOfTombstone);
 
-  if (e->hash() != hash) {
-    return false;
-  }
+  // Keys interned by RequestStringTable are usually the very same string.
   if (e->key == s) {
     return true;
   }
+  if (e->hash() != hash) {
+    return false;
+  }
   const char* data = e->key->data();
   const char* sdata = s->data();
   int slen = s->size();
@@ -496,6 +496,14 @@ static bool hitIntKey(const HphpArray::Elm* e, int64_t ki) {
 
 NEVER_INLINE
 ssize_t /*ElmInd*/ HphpArray::find(int64_t ki) const {
+  if (m_packed) {
+    VM::Stats::inc(VM::Stats::HA_FindIntFast);
+    if (uint64_t(ki) < uint64_t(ssize_t(m_lastE) + 1) &&
+        m_data[ki].data.m_type != KindOfTombstone) {
+      return ki;
+    }
+    return ssize_t(ElmIndEmpty);
+  }
   if (uint64_t(ki) < m_size) {
     // Try to get at it without dirtying a data cache line.
     Elm* e = m_data + uint64_t(ki);
@@ -515,6 +523,7 @@ ssize_t /*ElmInd*/ HphpArray::find(int64_t ki) const {
 NEVER_INLINE
 ssize_t /*ElmInd*/ HphpArray::find(const StringData* s,
                                    strhash_t prehash) const {
+  if (m_packed) return ssize_t(ElmIndEmpty);
   int32_t h = STRING_HASH(prehash);
   FIND_BODY(prehash, hitStringKey(&elms[pos], s, h));
 }
@@ -562,12 +571,14 @@ HphpArray::ElmInd* warnUnbalanced(size_t n, HphpArray::ElmInd* ei) {
 
 NEVER_INLINE
 HphpArray::ElmInd* HphpArray::findForInsert(int64_t ki) const {
+  if (UNLIKELY(m_packed)) const_cast<HphpArray*>(this)->unpack();
   FIND_FOR_INSERT_BODY(ki, hitIntKey(&elms[pos], ki));
 }
 
 NEVER_INLINE
 HphpArray::ElmInd* HphpArray::findForInsert(const StringData* s,
                                             strhash_t prehash) const {
+  if (UNLIKELY(m_packed)) const_cast<HphpArray*>(this)->unpack();
   int32_t h = STRING_HASH(prehash);
   FIND_FOR_INSERT_BODY(prehash, hitStringKey(&elms[pos], s, h));
 }
@@ -650,6 +661,12 @@ inline ALWAYS_INLINE HphpArray::Elm* HphpArray::allocElmFast(ElmInd* ei) {
   return &m_data[i];
 }
 
+inline ALWAYS_INLINE HphpArray::Elm* HphpArray::allocElmPackedFast() {
+  assert(m_packed && !isFull() && m_nextKI == int64_t(m_lastE) + 1);
+  ++m_size;
+  return &m_data[++m_lastE];
+}
+
 inline ALWAYS_INLINE HphpArray::Elm* HphpArray::allocElm(ElmInd* ei) {
   Elm* e = allocElmFast(ei);
   if (m_pos == ArrayData::invalid_index) m_pos = ssize_t(*ei);
@@ -662,6 +679,24 @@ HphpArray::Elm* HphpArray::newElm(ElmInd* ei, size_t h0) {
   return allocElm(ei);
 }
 
+/*
+ * Append slot for integer key ki if the array is packed and ki is the next
+ * key, bumping m_nextKI.  Returns NULL (having done nothing) if the caller
+ * has to go through the hash instead; the caller still owns initializing
+ * the element.
+ */
+inline ALWAYS_INLINE HphpArray::Elm* HphpArray::newElmPacked(int64_t ki) {
+  if (!m_packed || ki != m_nextKI || ki != int64_t(m_lastE) + 1) {
+    return nullptr;
+  }
+  resizeIfNeeded();
+  if (UNLIKELY(!m_packed)) return nullptr;
+  Elm* e = allocElmPackedFast();
+  if (m_pos == ArrayData::invalid_index) m_pos = ssize_t(m_lastE);
+  m_nextKI = ki + 1;
+  return e;
+}
+
 NEVER_INLINE
 HphpArray::Elm* HphpArray::newElmGrow(size_t h0) {
   resize();
@@ -712,8 +747,8 @@ void HphpArray::allocData(size_t maxElms, size_t tableSize) {
   }
   size_t hashSize = tableSize * sizeof(ElmInd);
   size_t dataSize = maxElms * sizeof(Elm);
-  size_t allocSize = hashSize <= sizeof(m_inline_hash) ? dataSize :
-                     dataSize + hashSize;
+  bool inlineHash = hashSize <= sizeof(m_inline_hash);
+  size_t allocSize = inlineHash || m_packed ? dataSize : dataSize + hashSize;
   if (!m_nonsmart) {
     m_data = (Elm*) smart_malloc(allocSize);
     m_allocMode = kSmart;
@@ -721,7 +756,8 @@ void HphpArray::allocData(size_t maxElms, size_t tableSize) {
     m_data = (Elm*) Util::safe_malloc(allocSize);
     m_allocMode = kMalloc;
   }
-  m_hash = hashSize <= sizeof(m_inline_hash) ? m_inline_hash :
+  m_hash = inlineHash ? m_inline_hash :
+           m_packed ? nullptr :
            (ElmInd*)(uintptr_t(m_data) + dataSize);
 }
 
@@ -729,8 +765,8 @@ void HphpArray::reallocData(size_t maxElms, size_t tableSize, uint oldMask) {
   assert(m_data && oldMask > 0 && maxElms > SmallSize);
   size_t hashSize = tableSize * sizeof(ElmInd);
   size_t dataSize = maxElms * sizeof(Elm);
-  size_t allocSize = hashSize <= sizeof(m_inline_hash) ? dataSize :
-                     dataSize + hashSize;
+  bool inlineHash = hashSize <= sizeof(m_inline_hash);
+  size_t allocSize = inlineHash || m_packed ? dataSize : dataSize + hashSize;
   size_t oldDataSize = computeMaxElms(oldMask) * sizeof(Elm); // slots only.
   if (!m_nonsmart) {
     assert(m_allocMode == kInline || m_allocMode == kSmart);
@@ -751,10 +787,30 @@ void HphpArray::reallocData(size_t maxElms, size_t tableSize, uint oldMask) {
       m_data = (Elm*) Util::safe_realloc(m_data, allocSize);
     }
   }
-  m_hash = hashSize <= sizeof(m_inline_hash) ? m_inline_hash :
+  m_hash = inlineHash ? m_inline_hash :
+           m_packed ? nullptr :
            (ElmInd*)(uintptr_t(m_data) + dataSize);
 }
 
+/*
+ * Packed arrays whose hash doesn't fit in m_inline_hash are allocated
+ * without one (m_hash == nullptr).  Grow m_data to make room for it
+ * before the array starts using its hash.
+ */
+void HphpArray::allocHash() {
+  if (m_hash) return;
+  assert(m_allocMode == kSmart || m_allocMode == kMalloc);
+  size_t dataSize = computeMaxElms(m_tableMask) * sizeof(Elm);
+  size_t allocSize = dataSize +
+                     computeTableSize(m_tableMask) * sizeof(ElmInd);
+  if (m_allocMode == kSmart) {
+    m_data = (Elm*) smart_realloc(m_data, allocSize);
+  } else {
+    m_data = (Elm*) Util::safe_realloc(m_data, allocSize);
+  }
+  m_hash = (ElmInd*)(uintptr_t(m_data) + dataSize);
+}
+
 inline ALWAYS_INLINE void HphpArray::resizeIfNeeded() {
   if (isFull()) resize();
 }
@@ -793,6 +849,7 @@ void HphpArray::grow() {
   size_t tableSize = computeTableSize(m_tableMask);
   size_t maxElms = computeMaxElms(m_tableMask);
   reallocData(maxElms, tableSize, oldMask);
+  if (m_packed) return;
   // All the elements have been copied and their offsets from the base are
   // still the same, so we just need to build the new hash table.
   initHash(m_hash, tableSize);
@@ -819,6 +876,24 @@ void HphpArray::grow() {
   }
 }
 
+/*
+ * Build the hash table for a packed array, turning it into an ordinary
+ * one.  Every slot already holds its own key, so nothing moves.
+ */
+NEVER_INLINE void HphpArray::unpack() {
+  assert(m_packed && m_hLoad == 0);
+  m_packed = false;
+  allocHash();
+  initHash(m_hash, computeTableSize(m_tableMask));
+  Elm* elms = m_data;
+  for (ElmInd pos = 0; pos <= m_lastE; ++pos) {
+    if (elms[pos].data.m_type == KindOfTombstone) continue;
+    assert(elms[pos].hasIntKey() && elms[pos].ikey == pos);
+    *findForNewInsert(pos) = pos;
+  }
+  m_hLoad = m_size;
+}
+
 void HphpArray::compact(bool renumber /* = false */) {
   ElmKey mPos;
   if (m_pos != ArrayData::invalid_index) {
@@ -844,15 +919,21 @@ void HphpArray::compact(bool renumber /* = false */) {
   if (renumber) {
     m_nextKI = 0;
   }
+  // Sliding elements down breaks the key == slot invariant unless we're
+  // also renumbering them.
+  m_packed = m_packed && renumber;
+  if (!m_packed) {
+    allocHash();
+    size_t tableSize = computeTableSize(m_tableMask);
+    initHash(m_hash, tableSize);
+  }
   Elm* elms = m_data;
-  size_t tableSize = computeTableSize(m_tableMask);
-  initHash(m_hash, tableSize);
 #ifdef DEBUG
   // Wait to set m_hLoad to m_size until after rebuilding is complete,
   // in order to maintain invariants in findForNewInsert().
   m_hLoad = 0;
 #else
-  m_hLoad = m_size;
+  m_hLoad = m_packed ? 0 : m_size;
 #endif
   ElmInd frPos = 0;
   for (ElmInd toPos = 0; toPos < ElmInd(m_size); ++toPos) {
@@ -870,13 +951,16 @@ void HphpArray::compact(bool renumber /* = false */) {
       toE->ikey = m_nextKI;
       ++m_nextKI;
     }
-    ElmInd* ie = findForNewInsert(toE->hasIntKey() ? toE->ikey : toE->hash());
-    *ie = toPos;
+    if (!m_packed) {
+      ElmInd* ie = findForNewInsert(toE->hasIntKey() ? toE->ikey :
+                                                       toE->hash());
+      *ie = toPos;
+    }
     ++frPos;
   }
   m_lastE = m_size - 1;
 #ifdef DEBUG
-  m_hLoad = m_size;
+  m_hLoad = m_packed ? 0 : m_size;
 #endif
   if (m_pos != ArrayData::invalid_index) {
     // Update m_pos, now that compaction is complete.
@@ -912,8 +996,12 @@ bool HphpArray::nextInsert(CVarRef data) {
                   "already occupied");
     return false;
   }
-  resizeIfNeeded();
   int64_t ki = m_nextKI;
+  if (Elm* e = newElmPacked(ki)) {
+    initElmInt(e, ki, data);
+    return true;
+  }
+  resizeIfNeeded();
   // The check above enforces an invariant that allows us to always
   // know that m_nextKI is not present in the array, so it is safe
   // to use findForNewInsert()
@@ -932,8 +1020,12 @@ ArrayData* HphpArray::nextInsertRef(CVarRef data) {
                   "already occupied");
     return this;
   }
-  resizeIfNeeded();
   int64_t ki = m_nextKI;
+  if (Elm* e = newElmPacked(ki)) {
+    initElmInt(e, ki, data, true /*byRef*/);
+    return this;
+  }
+  resizeIfNeeded();
   // The check above enforces an invariant that allows us to always
   // know that m_nextKI is not present in the array, so it is safe
   // to use findForNewInsert()
@@ -945,8 +1037,14 @@ ArrayData* HphpArray::nextInsertRef(CVarRef data) {
 }
 
 ArrayData* HphpArray::nextInsertWithRef(CVarRef data) {
-  resizeIfNeeded();
   int64_t ki = m_nextKI;
+  if (Elm* e = newElmPacked(ki)) {
+    tvWriteNull(&e->data);
+    tvAsVariant(&e->data).setWithRef(data);
+    e->setIntKey(ki);
+    return this;
+  }
+  resizeIfNeeded();
   ElmInd* ei = findForInsert(ki);
   assert(!validElmInd(*ei));
 
@@ -963,6 +1061,19 @@ ArrayData* HphpArray::nextInsertWithRef(CVarRef data) {
 
 ArrayData* HphpArray::addLvalImpl(int64_t ki, Variant** pDest) {
   assert(pDest != nullptr);
+  if (m_packed) {
+    ssize_t pos = find(ki);
+    if (pos != ssize_t(ElmIndEmpty)) {
+      *pDest = &tvAsVariant(&m_data[pos].data);
+      return this;
+    }
+    if (Elm* e = newElmPacked(ki)) {
+      tvWriteNull(&e->data);
+      e->setIntKey(ki);
+      *pDest = &tvAsVariant(&e->data);
+      return this;
+    }
+  }
   ElmInd* ei = findForInsert(ki);
   if (validElmInd(*ei)) {
     *pDest = &tvAsVariant(&m_data[*ei].data);
@@ -1001,6 +1112,11 @@ ArrayData* HphpArray::addLvalImpl(StringData* key, strhash_t h, Variant** pDest)
 
 inline ArrayData* HphpArray::addVal(int64_t ki, CVarRef data) {
   assert(!exists(ki));
+  if (Elm* e = newElmPacked(ki)) {
+    elemConstruct((TypedValue*)(&data), &e->data);
+    e->setIntKey(ki);
+    return this;
+  }
   resizeIfNeeded();
   ElmInd* ei = findForNewInsert(ki);
   Elm* e = allocElm(ei);
@@ -1061,6 +1177,17 @@ inline ArrayData* HphpArray::addValWithRef(StringData* key, CVarRef data) {
 
 inline INLINE_SINGLE_CALLER
 ArrayData* HphpArray::update(int64_t ki, CVarRef data) {
+  if (m_packed) {
+    ssize_t pos = find(ki);
+    if (pos != ssize_t(ElmIndEmpty)) {
+      tvAsVariant(&m_data[pos].data).assignValHelper(data);
+      return this;
+    }
+    if (Elm* e = newElmPacked(ki)) {
+      initElmInt(e, ki, data);
+      return this;
+    }
+  }
   ElmInd* ei = findForInsert(ki);
   if (validElmInd(*ei)) {
     Elm* e = &m_data[*ei];
@@ -1088,6 +1215,17 @@ ArrayData* HphpArray::update(StringData* key, CVarRef data) {
 }
 
 ArrayData* HphpArray::updateRef(int64_t ki, CVarRef data) {
+  if (m_packed) {
+    ssize_t pos = find(ki);
+    if (pos != ssize_t(ElmIndEmpty)) {
+      tvAsVariant(&m_data[pos].data).assignRefHelper(data);
+      return this;
+    }
+    if (Elm* e = newElmPacked(ki)) {
+      initElmInt(e, ki, data, true /*byRef*/);
+      return this;
+    }
+  }
   ElmInd* ei = findForInsert(ki);
   if (validElmInd(*ei)) {
     Elm* e = &m_data[*ei];
@@ -1222,6 +1360,7 @@ ArrayData* HphpArray::addLval(StringData* k, Variant*& ret, bool copy) {
 // Delete.
 
 ArrayData* HphpArray::erase(ElmInd* ei, bool updateNext /* = false */) {
+  assert(!m_packed);
   ElmInd pos = *ei;
   if (!validElmInd(pos)) {
     return this;
@@ -1396,6 +1535,7 @@ bool HphpArray::nvInsert(StringData *k, TypedValue *data) {
 
 inline ALWAYS_INLINE HphpArray* HphpArray::copyImpl(HphpArray* target) const {
   target->m_pos = m_pos;
+  target->m_packed = m_packed;
   target->m_data = nullptr;
   target->m_nextKI = m_nextKI;
   target->m_tableMask = m_tableMask;
@@ -1405,8 +1545,8 @@ inline ALWAYS_INLINE HphpArray* HphpArray::copyImpl(HphpArray* target) const {
   size_t tableSize = computeTableSize(m_tableMask);
   size_t maxElms = computeMaxElms(m_tableMask);
   target->allocData(maxElms, tableSize);
-  // Copy the hash.
-  memcpy(target->m_hash, m_hash, tableSize * sizeof(ElmInd));
+  // Copy the hash, if there is one.
+  if (!m_packed) memcpy(target->m_hash, m_hash, tableSize * sizeof(ElmInd));
   // Copy the elements and bump up refcounts as needed.
   if (m_size > 0) {
     Elm* elms = m_data;
@@ -1480,21 +1620,28 @@ ArrayData* genericAddNewElemC(ArrayData* a, TypedValue value) {
 ArrayData* HphpArray::AddNewElemC(ArrayData* a, TypedValue value) {
   assert(a->getCount() <= 1 && value.m_type != KindOfRef);
   HphpArray* h;
-  ElmInd* ei;
   int64_t k;
   if (LIKELY(a->isHphpArray()) &&
       ((h = (HphpArray*)a), LIKELY(h->m_pos >= 0)) &&
       LIKELY(!h->isFull()) &&
-      ((k = h->m_nextKI), LIKELY(k >= 0)) &&
-      ((ei = &h->m_hash[k & h->m_tableMask]), LIKELY(!validElmInd(*ei)))) {
-    // Fast path is a streamlined copy of Variant.constructValHelper()
-    // with no incref+decref because we're moving (data,type) to this array.
-    Elm* e = h->allocElmFast(ei);
-    e->data.m_type = typeInitNull(value.m_type);
-    e->data.m_data.num = value.m_data.num;
-    e->setIntKey(k);
-    h->m_nextKI = k + 1;
-    return a;
+      ((k = h->m_nextKI), LIKELY(k >= 0))) {
+    Elm* e = nullptr;
+    if (h->m_packed) {
+      if (LIKELY(k == int64_t(h->m_lastE) + 1)) e = h->allocElmPackedFast();
+    } else {
+      ElmInd* ei = &h->m_hash[k & h->m_tableMask];
+      if (LIKELY(!validElmInd(*ei))) e = h->allocElmFast(ei);
+    }
+    if (LIKELY(e != nullptr)) {
+      // Fast path is a streamlined copy of Variant.constructValHelper()
+      // with no incref+decref because we're moving (data,type) to this
+      // array.
+      e->data.m_type = typeInitNull(value.m_type);
+      e->data.m_data.num = value.m_data.num;
+      e->setIntKey(k);
+      h->m_nextKI = k + 1;
+      return a;
+    }
   }
   return genericAddNewElemC(a, value);
 }
@@ -1812,7 +1959,9 @@ array_getm_i(void* dptr, int64_t key, TypedValue* out) {
   TRACE(2, "array_getm_ik1: (%p) <- %p[%" PRId64 "]\n", out, dptr, key);
   // Ref-counting the value is the translator's responsibility. We know out
   // pointed to uninitialized memory, so no need to dec it.
-  TypedValue* ret = ad->nvGetCell(key);
+  TypedValue* ret = LIKELY(ad->isHphpArray()) ?
+    static_cast<HphpArray*>(ad)->nvGetPacked(key) : nullptr;
+  ret = LIKELY(ret != nullptr) ? tvToCell(ret) : ad->nvGetCell(key);
   tvDup(ret, out);
   return ad;
 }
@@ -1867,7 +2016,9 @@ uint64_t array_issetm_s0_fast(const void* dptr, StringData* sd)
 
 uint64_t array_issetm_i(const void* dptr, int64_t key) {
   ArrayData* ad = (ArrayData*)dptr;
-  TypedValue* ret = ad->nvGet(key);
+  TypedValue* ret = LIKELY(ad->isHphpArray()) ?
+    static_cast<HphpArray*>(ad)->nvGetPacked(key) : nullptr;
+  if (!ret) ret = ad->nvGet(key);
   // Variant.isNull unboxes ret if its KindOfRef.
   return ret && !tvAsCVarRef(ret).isNull();
 }
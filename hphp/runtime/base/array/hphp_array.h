@@ -215,6 +215,22 @@ public:
   void nvGetKey(TypedValue* out, ssize_t pos);
   bool nvInsert(StringData* k, TypedValue *v);
 
+  bool isPacked() const { return m_packed; }
+
+  /**
+   * Integer lookup for packed arrays that skips the virtual call and the
+   * find() machinery; the JIT's array helpers try this first.  Returns
+   * NULL if the array isn't packed or k isn't present, in which case the
+   * caller falls back to nvGet().
+   */
+  TypedValue* nvGetPacked(int64_t k) const {
+    if (m_packed && uint64_t(k) < uint64_t(ssize_t(m_lastE) + 1)) {
+      TypedValue* tv = &m_data[k].data;
+      if (tv->m_type != KindOfTombstone) return tv;
+    }
+    return nullptr;
+  }
+
   /**
    * Main helper for AddNewElemC.  The semantics are slightly different from
    * other helpers, but tuned for the opcode.  The value to set is passed by
@@ -364,6 +380,13 @@ private:
   // m_hash --> |                    | 2^K hash table entries.
   //            +--------------------+
 
+  // Packed arrays hold only the integer keys 0..n-1, with key i in slot i.
+  // Lookups and appends of those keys go straight to the slot, so a packed
+  // array never builds (or touches) its hash table; m_hLoad stays 0.  Unless
+  // it fits in m_inline_hash, the hash isn't even allocated (m_hash is
+  // null) until the first operation that needs it calls unpack().  This
+  // sits in the padding at the end of ArrayData.
+  bool    m_packed;
   ElmInd  m_lastE;       // Index of last used element.
   Elm*    m_data;        // Contains elements and hash table.
   ElmInd* m_hash;        // Hash table.
@@ -404,6 +427,7 @@ private:
 
   inline ALWAYS_INLINE
   ElmInd* findForNewInsert(size_t h0) const {
+    if (UNLIKELY(m_packed)) const_cast<HphpArray*>(this)->unpack();
     size_t tableMask = m_tableMask;
     size_t probeIndex = h0 & tableMask;
     ElmInd* ei = &m_hash[probeIndex];
@@ -436,6 +460,9 @@ private:
   Elm* newElmGrow(size_t h0);
   Elm* allocElm(ElmInd* ei);
   Elm* allocElmFast(ElmInd* ei);
+  Elm* allocElmPackedFast();
+  Elm* newElmPacked(int64_t ki);
+  void unpack();
   void initElmInt(Elm* e, int64_t ki, CVarRef data, bool byRef=false);
   void initElmStr(Elm* e, strhash_t h, StringData* key, CVarRef data,
                   bool byRef=false);
@@ -445,6 +472,7 @@ private:
                       bool byRef=false);
   void allocData(size_t maxElms, size_t tableSize);
   void reallocData(size_t maxElms, size_t tableSize, uint oldMask);
+  void allocHash();
 
   /**
    * init(size) allocates space for size elements but initializes
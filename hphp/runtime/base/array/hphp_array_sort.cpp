@@ -110,27 +110,31 @@ done:
 /**
  * postSort() runs after the sort has been performed. For HphpArray, postSort()
  * handles rebuilding the hash. Also, if resetKeys is true, postSort() will
- * renumber the keys 0 thru n-1.
+ * renumber the keys 0 thru n-1, which leaves the array packed with no hash
+ * to rebuild.
  */
 void HphpArray::postSort(bool resetKeys) {
   assert(m_size > 0);
-  size_t tableSize = computeTableSize(m_tableMask);
-  initHash(m_hash, tableSize);
-  m_hLoad = 0;
   if (resetKeys) {
     for (ElmInd pos = 0; pos <= m_lastE; ++pos) {
       Elm* e = &m_data[pos];
       if (e->hasStrKey()) decRefStr(e->key);
       e->setIntKey(pos);
-      m_hash[pos] = pos;
     }
     m_nextKI = m_size;
-  } else {
-    for (ElmInd pos = 0; pos <= m_lastE; ++pos) {
-      Elm* e = &m_data[pos];
-      ElmInd* ei = findForNewInsert(e->hasIntKey() ? e->ikey : e->hash());
-      *ei = pos;
-    }
+    m_packed = true;
+    m_hLoad = 0;
+    return;
+  }
+  m_packed = false;
+  allocHash();
+  size_t tableSize = computeTableSize(m_tableMask);
+  initHash(m_hash, tableSize);
+  m_hLoad = 0;
+  for (ElmInd pos = 0; pos <= m_lastE; ++pos) {
+    Elm* e = &m_data[pos];
+    ElmInd* ei = findForNewInsert(e->hasIntKey() ? e->ikey : e->hash());
+    *ei = pos;
   }
   m_hLoad = m_size;
 }
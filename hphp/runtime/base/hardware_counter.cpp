@@ -164,9 +164,19 @@ public:
         PERF_COUNT_HW_CACHE_L1D | ((PERF_COUNT_HW_CACHE_OP_WRITE) << 8)) {}
 };
 
+class DtlbMissCounter : public HardwareCounterImpl {
+public:
+  DtlbMissCounter() :
+    HardwareCounterImpl(PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_DTLB | ((PERF_COUNT_HW_CACHE_OP_READ) << 8) |
+        ((PERF_COUNT_HW_CACHE_RESULT_MISS) << 16)) {}
+};
+
 HardwareCounter::HardwareCounter()
   : m_countersSet(false), m_pseudoEvents(false) {
   m_instructionCounter = new InstructionCounter();
+  m_dtlbMissCounter = RuntimeOption::EvalProfileHWDtlbMisses ?
+    new DtlbMissCounter() : nullptr;
   if (RuntimeOption::EvalProfileHWEvents == "") {
     m_loadCounter = new LoadCounter();
     m_storeCounter = new StoreCounter();
@@ -178,6 +188,7 @@ HardwareCounter::HardwareCounter()
 
 HardwareCounter::~HardwareCounter() {
   delete m_instructionCounter;
+  delete m_dtlbMissCounter;
   if (!m_countersSet) {
     delete m_loadCounter;
     delete m_storeCounter;
@@ -194,6 +205,7 @@ void HardwareCounter::Reset(void) {
 
 void HardwareCounter::reset(void) {
   m_instructionCounter->reset();
+  if (m_dtlbMissCounter) m_dtlbMissCounter->reset();
   if (!m_countersSet) {
     m_storeCounter->reset();
     m_loadCounter->reset();
@@ -227,6 +239,14 @@ int64_t HardwareCounter::getStoreCount() {
   return m_storeCounter->read();
 }
 
+int64_t HardwareCounter::GetDtlbMissCount() {
+  return s_counter->getDtlbMissCount();
+}
+
+int64_t HardwareCounter::getDtlbMissCount() {
+  return m_dtlbMissCounter ? m_dtlbMissCounter->read() : 0;
+}
+
 struct PerfTable perfTable[] = {
   /* PERF_TYPE_HARDWARE events */
 #define PC(n)    PERF_TYPE_HARDWARE, PERF_COUNT_HW_ ## n
@@ -391,6 +411,9 @@ void HardwareCounter::ClearPerfEvents() {
 
 void HardwareCounter::getPerfEvents(Array& ret) {
   ret.set("instructions", getInstructionCount());
+  if (m_dtlbMissCounter) {
+    ret.set("dtlb-load-misses", getDtlbMissCount());
+  }
   if (!m_countersSet) {
     ret.set("loads", getLoadCount());
     ret.set("stores", getStoreCount());
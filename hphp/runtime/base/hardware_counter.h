@@ -28,6 +28,7 @@ namespace HPHP {
 class InstructionCounter;
 class LoadCounter;
 class StoreCounter;
+class DtlbMissCounter;
 
 struct PerfTable {
   const char *name;
@@ -46,6 +47,7 @@ public:
   static int64_t GetInstructionCount(void);
   static int64_t GetLoadCount(void);
   static int64_t GetStoreCount(void);
+  static int64_t GetDtlbMissCount(void);
   static bool SetPerfEvents(CStrRef events);
   static void GetPerfEvents(Array& ret);
   static void ClearPerfEvents();
@@ -54,6 +56,7 @@ public:
   int64_t getInstructionCount(void);
   int64_t getLoadCount(void);
   int64_t getStoreCount(void);
+  int64_t getDtlbMissCount(void);
   bool eventExists(char *event);
   bool addPerfEvent(char* event);
   bool setPerfEvents(CStrRef events);
@@ -66,6 +69,7 @@ private:
   InstructionCounter *m_instructionCounter;
   LoadCounter *m_loadCounter;
   StoreCounter *m_storeCounter;
+  DtlbMissCounter *m_dtlbMissCounter;
   std::vector<HardwareCounterImpl *> m_counters;
   bool m_pseudoEvents;
 };
@@ -90,6 +94,8 @@ public:
          { return s_counter.getLoadCount(); }
   static int64_t GetStoreCount(void)
          { return s_counter.getStoreCount(); }
+  static int64_t GetDtlbMissCount(void)
+         { return s_counter.getDtlbMissCount(); }
   static bool SetPerfEvents(CStrRef events)
          { return s_counter.setPerfEvents(events); }
   static void GetPerfEvents(Array& ret)
@@ -104,6 +110,8 @@ public:
         { return 0; }
   int64_t getStoreCount(void)
         { return 0; }
+  int64_t getDtlbMissCount(void)
+        { return 0; }
   bool  eventExists(char *event)
         { return false; }
   bool  addPerfEvent(char* event)
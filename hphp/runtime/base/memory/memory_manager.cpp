@@ -160,6 +160,8 @@ void MemoryManager::AllocIterator::next() {
   ++m_it;
 }
 
+typedef std::vector<char*>::const_iterator SlabIter;
+
 MemoryManager::MemoryManager() : m_front(0), m_limit(0),
   m_enabled(RuntimeOption::EnableMemoryManager) {
 #ifdef USE_JEMALLOC
@@ -172,6 +174,13 @@ MemoryManager::MemoryManager() : m_front(0), m_limit(0),
   m_strings.next = m_strings.prev = &m_strings;
 }
 
+MemoryManager::~MemoryManager() {
+  for (SlabIter i = m_spareSlabs.begin(), end = m_spareSlabs.end();
+       i != end; ++i) {
+    free(*i);
+  }
+}
+
 void MemoryManager::resetStats() {
   m_stats.usage = 0;
   m_stats.alloc = 0;
@@ -229,16 +238,20 @@ struct SmallNode {
   size_t padbytes; // <= kMaxSmartSize means small block
 };
 
-typedef std::vector<char*>::const_iterator SlabIter;
-
 void MemoryManager::rollback() {
   StringData::sweepAll();
   for (unsigned int i = 0, n = m_smartAllocators.size(); i < n; i++) {
     m_smartAllocators[i]->clear();
   }
-  // free smart-malloc slabs
+  // Keep a few slabs for the next request and free the rest; a request
+  // that needed an unusual amount of memory shouldn't pin it forever.
+  size_t keep = std::max(RuntimeOption::SmartHeapRetainedSlabs, 0);
   for (SlabIter i = m_slabs.begin(), end = m_slabs.end(); i != end; ++i) {
-    free(*i);
+    if (m_spareSlabs.size() < keep) {
+      m_spareSlabs.push_back(*i);
+    } else {
+      free(*i);
+    }
   }
   m_slabs.clear();
   // free large allocation blocks
@@ -250,6 +263,7 @@ void MemoryManager::rollback() {
   // zero out freelists
   for (unsigned i = 0; i < kNumSizes; i++) {
     m_smartfree[i].clear();
+    m_sizedfree[i].clear();
   }
   m_front = m_limit = 0;
 }
@@ -267,7 +281,8 @@ void MemoryManager::checkMemory() {
   printf("Peak Usage: %" PRId64 " bytes\t", m_stats.peakUsage);
   printf("Peak Alloc: %" PRId64 " bytes\n", m_stats.peakAlloc);
 
-  printf("Slabs: %lu KiB\n", m_slabs.size() * SLAB_SIZE / 1024);
+  printf("Slabs: %lu KiB\t", m_slabs.size() * SLAB_SIZE / 1024);
+  printf("Spare Slabs: %lu KiB\n", m_spareSlabs.size() * SLAB_SIZE / 1024);
 }
 
 //
@@ -355,8 +370,19 @@ NEVER_INLINE char* MemoryManager::newSlab(size_t nbytes) {
   if (UNLIKELY(m_stats.usage > m_stats.maxBytes)) {
     refreshStatsHelper();
   }
-  char* slab = (char*) Util::safe_malloc(SLAB_SIZE);
-  JEMALLOC_STATS_ADJUST(&m_stats, SLAB_SIZE);
+  char* slab;
+  if (!m_spareSlabs.empty()) {
+    // jemalloc already counted this one, in an earlier request.
+    slab = m_spareSlabs.back();
+    m_spareSlabs.pop_back();
+  } else {
+    // A slab is exactly one huge page, and rollback() keeps the spares,
+    // so a thread's hot slabs stay huge-page backed across requests.
+    slab = RuntimeOption::EvalMapRequestHeapHuge ?
+      (char*) allocHuge(SLAB_SIZE) : nullptr;
+    if (!slab) slab = (char*) Util::safe_malloc(SLAB_SIZE);
+    JEMALLOC_STATS_ADJUST(&m_stats, SLAB_SIZE);
+  }
   m_stats.alloc += SLAB_SIZE;
   if (m_stats.alloc > m_stats.peakAlloc) {
     m_stats.peakAlloc = m_stats.alloc;
@@ -411,16 +437,32 @@ void MemoryManager::smartFreeBig(SweepNode* n) {
   free(n);
 }
 
+inline void* MemoryManager::smartMallocSize(size_t nbytes) {
+  assert(nbytes > 0);
+  size_t padbytes = (nbytes + kMask) & ~kMask;
+  assert(padbytes <= kMaxSmartSize);
+  m_stats.usage += padbytes;
+  unsigned i = (padbytes - 1) >> kLgSizeQuantum;
+  assert(i < kNumSizes);
+  void* p = m_sizedfree[i].maybePop();
+  if (LIKELY(p != 0)) return p;
+  char* mem = m_front;
+  if (LIKELY(mem + padbytes <= m_limit)) {
+    m_front = mem + padbytes;
+    return mem;
+  }
+  return newSlab(padbytes);
+}
+
 // allocate nbytes from the current slab, aligned to 16-bytes
 inline void* MemoryManager::slabAlloc(size_t nbytes) {
-  const size_t kAlignMask = 15;
-  assert((nbytes & 7) == 0);
-  char* ptr = (char*)(uintptr_t(m_front + kAlignMask) & ~kAlignMask);
-  if (ptr + nbytes <= m_limit) {
-    m_front = ptr + nbytes;
+  size_t padbytes = (nbytes + kMask) & ~kMask;
+  char* ptr = m_front;
+  if (ptr + padbytes <= m_limit) {
+    m_front = ptr + padbytes;
     return ptr;
   }
-  return newSlab(nbytes);
+  return newSlab(padbytes);
 }
 
 static inline MemoryManager& MM() {
@@ -460,10 +502,15 @@ void smart_free(void* ptr) {
 HOT_FUNC
 void* SmartAllocatorImpl::alloc(size_t nbytes) {
   assert(nbytes == size_t(m_itemSize));
-  MM().getStats().usage += nbytes;
-  void* ptr = m_free.maybePop();
-  if (UNLIKELY(!ptr)) {
-    ptr = MM().slabAlloc(nbytes);
+  void* ptr;
+  if (LIKELY(nbytes <= MemoryManager::kMaxSmartSize)) {
+    ptr = MM().smartMallocSize(nbytes);
+  } else {
+    MM().getStats().usage += nbytes;
+    ptr = m_free.maybePop();
+    if (UNLIKELY(!ptr)) {
+      ptr = MM().slabAlloc(nbytes);
+    }
   }
   TRACE(1, "alloc %zu -> %p\n", nbytes, ptr);
   return ptr;
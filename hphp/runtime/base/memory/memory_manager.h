@@ -149,6 +149,15 @@ private:
  *     objects, for example, StringData's m_data.
  *  3. Freelance memory, malloced by extensions or STL classes, that are
  *     completely out of MemoryManager's control.
+ *
+ * The first two share a single request heap: slabs carved up by bump
+ * allocation, with freelists per 16-byte size class.  SmartAllocators
+ * with items up to kMaxSmartSize are typed front ends to
+ * smartMallocSize(), so a freed StringData can be reused by an object or
+ * array of the same size class.  At request end
+ * rollback() drops every freelist and keeps up to
+ * Server.SmartHeapRetainedSlabs slabs for the next request, so a
+ * steady-state request never goes to malloc for them.
  */
 class MemoryManager : boost::noncopyable {
   static void* TlsInitSetup;
@@ -162,6 +171,7 @@ public:
   }
 
   MemoryManager();
+  ~MemoryManager();
 
   // State for iteration over all the smart allocators registered in a
   // memory manager.
@@ -328,6 +338,24 @@ public:
   void  smartFree(void* ptr);
   static const size_t kMaxSmartSize = 2048;
 
+  /*
+   * Headerless allocation for callers that know the size again when they
+   * free, like SmartAllocator.  Blocks come from the same slabs and size
+   * classes as smart_malloc, 16-byte aligned, but have freelists of their
+   * own: the link lives in the first word of a freed block, so _count
+   * keeps its kSmartFreeFill tombstone in debug builds.  nbytes must be
+   * at most kMaxSmartSize.
+   */
+  void* smartMallocSize(size_t nbytes);
+  void  smartFreeSize(void* ptr, size_t nbytes) {
+    assert(ptr != 0);
+    size_t padbytes = (nbytes + kMask) & ~kMask;
+    assert(padbytes <= kMaxSmartSize);
+    assert(memset(ptr, kSmartFreeFill, padbytes));
+    m_sizedfree[(padbytes - 1) >> kLgSizeQuantum].push(ptr);
+    m_stats.usage -= padbytes;
+  }
+
   // allocate nbytes from the current slab, aligned to 16-bytes
   void* slabAlloc(size_t nbytes);
 
@@ -350,6 +378,7 @@ private:
 private:
   char *m_front, *m_limit;
   GarbageList m_smartfree[kNumSizes];
+  GarbageList m_sizedfree[kNumSizes];
   SweepNode m_sweep;   // oversize smart_malloc'd blocks
   SweepNode m_strings; // in-place node is head of circular list
   MemoryUsageStats m_stats;
@@ -357,6 +386,7 @@ private:
 
   std::vector<SmartAllocatorImpl*> m_smartAllocators;
   std::vector<char*> m_slabs;
+  std::vector<char*> m_spareSlabs; // kept by rollback() for reuse
 
 #ifdef USE_JEMALLOC
   uint64_t* m_allocated;
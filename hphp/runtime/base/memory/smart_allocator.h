@@ -142,7 +142,10 @@ void InitAllocatorThreadLocal() ATTRIBUTE_COLD;
 #define SLAB_SIZE (2 << 20)
 
 /**
- * Just a simple free-list based memory allocator.
+ * Typed front end to the MemoryManager's size-class heap.  Items up to
+ * MemoryManager::kMaxSmartSize go back to the heap's freelist for their
+ * size class when they're deallocated; bigger ones keep a freelist of
+ * their own, carved straight out of the slabs.
  */
 class SmartAllocatorImpl : boost::noncopyable {
 public:
@@ -181,9 +184,14 @@ public:
   void* alloc(size_t size);
   void dealloc(void *obj) {
     TRACE(1, "dealloc %p\n", obj);
+    MemoryManager* mm = MemoryManager::TheMemoryManager();
+    if (LIKELY(m_itemSize <= int(MemoryManager::kMaxSmartSize))) {
+      mm->smartFreeSize(obj, m_itemSize);
+      return;
+    }
     assert(memset(obj, kSmartFreeFill, m_itemSize));
     m_free.push(obj);
-    MemoryManager::TheMemoryManager()->getStats().usage -= m_itemSize;
+    mm->getStats().usage -= m_itemSize;
   }
   void clear() { m_free.clear(); }
 
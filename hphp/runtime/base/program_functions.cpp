@@ -25,6 +25,7 @@
 #include "util/shared_memory_allocator.h"
 #include "runtime/base/server/pagelet_server.h"
 #include "runtime/base/server/xbox_server.h"
+#include "runtime/base/server/compression_pool.h"
 #include "runtime/base/server/http_server.h"
 #include "runtime/base/server/replay_transport.h"
 #include "runtime/base/server/http_request_handler.h"
@@ -64,6 +65,7 @@
 #include "runtime/vm/runtime.h"
 #include "runtime/vm/repo.h"
 #include "runtime/vm/translator/translator.h"
+#include "runtime/vm/translator/warmup-profile.h"
 #include "compiler/builtin_symbols.h"
 
 using namespace boost::program_options;
@@ -569,6 +571,8 @@ static int start_server(const std::string &username) {
     (RuntimeOption::AdminLogFormat, RuntimeOption::AdminLogSymLink,
      RuntimeOption::AdminLogFile,
      username);
+  HttpRequestHandler::GetAccessLog().startWriter
+    (RuntimeOption::AccessLogBufferSize);
 
   void *sslCTX = nullptr;
   if (RuntimeOption::EnableSSL) {
@@ -629,6 +633,15 @@ static int start_server(const std::string &username) {
     }
   }
 
+  // Get a head start on the code the previous server found hot.
+  if (VM::Transl::WarmupProfile::enabled()) {
+    hphp_session_init();
+    ExecutionContext *context = hphp_context_init();
+    VM::Transl::WarmupProfile::warmup();
+    hphp_context_exit(context, false);
+    hphp_session_exit();
+  }
+
   HttpServer::Server->run();
   return 0;
 }
@@ -1171,6 +1184,7 @@ void hphp_process_init() {
 
   PageletServer::Restart();
   XboxServer::Restart();
+  CompressionPool::Restart();
   Stream::RegisterCoreWrappers();
   Extension::InitModules();
   for (InitFiniNode *in = extra_process_init; in; in = in->next) {
@@ -1392,6 +1406,8 @@ void hphp_session_exit() {
 
 void hphp_process_exit() {
   XboxServer::Stop();
+  CompressionPool::Stop();
+  HttpRequestHandler::GetAccessLog().stopWriter();
   Eval::Debugger::Stop();
   Extension::ShutdownModules();
   LightProcess::Close();
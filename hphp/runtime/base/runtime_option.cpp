@@ -35,6 +35,7 @@
 #include <util/stack_trace.h>
 #include <util/process.h>
 #include <util/file_cache.h>
+#include <util/async_func.h>
 #include <runtime/base/hardware_counter.h>
 #include <runtime/base/preg.h>
 #include <util/parser/scanner.h>
@@ -83,6 +84,7 @@ int64_t RuntimeOption::StringOffsetLimit = 10 * 1024 * 1024; // 10MB
 
 std::string RuntimeOption::AccessLogDefaultFormat;
 std::vector<AccessLogFileData> RuntimeOption::AccessLogs;
+int RuntimeOption::AccessLogBufferSize = 0;
 
 std::string RuntimeOption::AdminLogFormat;
 std::string RuntimeOption::AdminLogFile;
@@ -98,6 +100,8 @@ int RuntimeOption::ServerPort;
 int RuntimeOption::ServerPortFd = -1;
 int RuntimeOption::ServerBacklog = 128;
 int RuntimeOption::ServerConnectionLimit = 0;
+int RuntimeOption::ServerEventLoops = 1;
+bool RuntimeOption::ServerReusePort = false;
 int RuntimeOption::ServerThreadCount = 50;
 bool RuntimeOption::ServerThreadRoundRobin = false;
 int RuntimeOption::ServerThreadDropCacheTimeoutSeconds = 0;
@@ -124,6 +128,8 @@ int RuntimeOption::ServerDanglingWait;
 int RuntimeOption::ServerShutdownListenWait = 0;
 int RuntimeOption::ServerShutdownListenNoWork = -1;
 int RuntimeOption::GzipCompressionLevel = 3;
+int RuntimeOption::ServerCompressionThreads = 0;
+bool RuntimeOption::EnableLZ4Encoding = false;
 std::string RuntimeOption::ForceCompressionURL;
 std::string RuntimeOption::ForceCompressionCookie;
 std::string RuntimeOption::ForceCompressionParam;
@@ -296,6 +302,7 @@ std::vector<std::string> RuntimeOption::APCSizeSkipPrefix;
 bool RuntimeOption::EnableAPCSizeDetail = false;
 bool RuntimeOption::EnableAPCFetchStats = false;
 bool RuntimeOption::APCSizeCountPrime = false;
+std::string RuntimeOption::APCSizePrefixSeparator = ":";
 
 int64_t RuntimeOption::MaxRSS = 0;
 int64_t RuntimeOption::MaxRSSPollingCycle = 0;
@@ -305,6 +312,7 @@ int64_t RuntimeOption::MaxMemcacheKeyCount = 0;
 int RuntimeOption::SocketDefaultTimeout = 5;
 bool RuntimeOption::LockCodeMemory = false;
 bool RuntimeOption::EnableMemoryManager = true;
+int RuntimeOption::SmartHeapRetainedSlabs = 2;
 bool RuntimeOption::CheckMemory = false;
 int RuntimeOption::MaxArrayChain = INT_MAX;
 bool RuntimeOption::StrictCollections = true;
@@ -318,9 +326,17 @@ int RuntimeOption::ApcLoadThread = 1;
 std::set<std::string> RuntimeOption::ApcCompletionKeys;
 RuntimeOption::ApcTableTypes RuntimeOption::ApcTableType = ApcConcurrentTable;
 bool RuntimeOption::EnableApcSerialize = true;
+bool RuntimeOption::ApcCompactSerialize = false;
 time_t RuntimeOption::ApcKeyMaturityThreshold = 20;
 size_t RuntimeOption::ApcMaximumCapacity = 0;
 int RuntimeOption::ApcKeyFrequencyUpdatePeriod = 1000;
+int64_t RuntimeOption::ApcMemoryLimit = 0;
+RuntimeOption::ApcEvictionPolicies RuntimeOption::ApcEvictionPolicy =
+  ApcEvictLRU;
+int RuntimeOption::ApcEvictionSamples = 5;
+std::string RuntimeOption::ApcSnapshotPath;
+int RuntimeOption::ApcSnapshotMaxAge = 600;
+int RuntimeOption::ApcSnapshotWaitSeconds = 60;
 bool RuntimeOption::ApcExpireOnSets = false;
 int RuntimeOption::ApcPurgeFrequency = 4096;
 int RuntimeOption::ApcPurgeRate = -1;
@@ -603,6 +619,7 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
                                       getString(AccessLogDefaultFormat)));
       }
     }
+    AccessLogBufferSize = logger["AccessLogBufferSize"].getInt32(0);
 
     AdminLogFormat = logger["AdminLog.Format"].getString("%h %t %s %U");
     AdminLogFile = logger["AdminLog.File"].getString();
@@ -657,6 +674,8 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
     ServerPort = server["Port"].getUInt16(80);
     ServerBacklog = server["Backlog"].getInt16(128);
     ServerConnectionLimit = server["ConnectionLimit"].getInt16(0);
+    ServerEventLoops = server["EventLoops"].getInt32(1);
+    ServerReusePort = server["ReusePort"].getBool(false);
     ServerThreadCount = server["ThreadCount"].getInt32(50);
     ServerThreadRoundRobin = server["ThreadRoundRobin"].getBool();
     ServerThreadDropCacheTimeoutSeconds =
@@ -684,6 +703,8 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
       ServerGracefulShutdownWait = ServerDanglingWait;
     }
     GzipCompressionLevel = server["GzipCompressionLevel"].getInt16(3);
+    ServerCompressionThreads = server["CompressionThreads"].getInt32(0);
+    EnableLZ4Encoding = server["EnableLZ4Encoding"].getBool();
 
     ForceCompressionURL    = server["ForceCompression"]["URL"].getString();
     ForceCompressionCookie = server["ForceCompression"]["Cookie"].getString();
@@ -782,6 +803,7 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
     if (!EnableMemoryManager) {
       MemoryManager::TheMemoryManager()->disable();
     }
+    SmartHeapRetainedSlabs = server["SmartHeapRetainedSlabs"].getInt32(2);
     CheckMemory = server["CheckMemory"].getBool();
     MaxArrayChain = server["MaxArrayChain"].getInt32(INT_MAX);
     if (MaxArrayChain != INT_MAX) {
@@ -806,11 +828,14 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
     string apcTableType = apc["TableType"].getString("concurrent");
     if (strcasecmp(apcTableType.c_str(), "concurrent") == 0) {
       ApcTableType = ApcConcurrentTable;
+    } else if (strcasecmp(apcTableType.c_str(), "sharded") == 0) {
+      ApcTableType = ApcShardedTable;
     } else {
       throw InvalidArgumentException("apc table type",
                                      "Invalid table type");
     }
     EnableApcSerialize = apc["EnableApcSerialize"].getBool(true);
+    ApcCompactSerialize = apc["CompactSerialize"].getBool(false);
     ApcExpireOnSets = apc["ExpireOnSets"].getBool();
     ApcPurgeFrequency = apc["PurgeFrequency"].getInt32(4096);
     ApcPurgeRate = apc["PurgeRate"].getInt32(-1);
@@ -835,6 +860,24 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
 
     apc["NoTTLPrefix"].get(ApcNoTTLPrefix);
 
+    ApcMemoryLimit = apc["MemoryLimit"].getInt64(0);
+    string apcEvictionPolicy = apc["EvictionPolicy"].getString("lru");
+    if (strcasecmp(apcEvictionPolicy.c_str(), "lru") == 0) {
+      ApcEvictionPolicy = ApcEvictLRU;
+    } else if (strcasecmp(apcEvictionPolicy.c_str(), "lfu") == 0) {
+      ApcEvictionPolicy = ApcEvictLFU;
+    } else {
+      throw InvalidArgumentException("apc eviction policy",
+                                     "Invalid eviction policy");
+    }
+    ApcEvictionSamples = apc["EvictionSamples"].getInt32(5);
+    if (ApcEvictionSamples < 1) ApcEvictionSamples = 1;
+
+    Hdf snapshot = apc["Snapshot"];
+    ApcSnapshotPath = snapshot["Path"].getString();
+    ApcSnapshotMaxAge = snapshot["MaxAge"].getInt32(600);
+    ApcSnapshotWaitSeconds = snapshot["WaitSeconds"].getInt32(60);
+
     Hdf dns = server["DnsCache"];
     EnableDnsCache = dns["Enable"].getBool();
     DnsCacheTTL = dns["TTL"].getInt32(600); // 10 minutes
@@ -1072,6 +1115,7 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
       if (EnableAPCFetchStats) EnableAPCSizeDetail = true;
       if (EnableAPCSizeDetail) EnableAPCSizeGroup = true;
       APCSizeCountPrime = apcSize["CountPrime"].getBool();
+      APCSizePrefixSeparator = apcSize["PrefixSeparator"].getString(":");
     }
 
     EnableHotProfiler = stats["EnableHotProfiler"].getBool(true);
@@ -1134,6 +1178,7 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
 #undef get_uint64
 
     EvalJitEnableRenameFunction = EvalJitEnableRenameFunction || !EvalJit;
+    AsyncFuncImpl::SetHugeStacks(EvalMapStacksHuge);
 
     EnableEmitSwitch = eval["EnableEmitSwitch"].getBool(true);
     EnableEmitterStats = eval["EnableEmitterStats"].getBool(EnableEmitterStats);
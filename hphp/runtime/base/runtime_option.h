@@ -81,6 +81,7 @@ public:
 
   static std::string AccessLogDefaultFormat;
   static std::vector<AccessLogFileData> AccessLogs;
+  static int AccessLogBufferSize;
 
   static std::string AdminLogFormat;
   static std::string AdminLogFile;
@@ -95,6 +96,8 @@ public:
   static int ServerPortFd;
   static int ServerBacklog;
   static int ServerConnectionLimit;
+  static int ServerEventLoops;
+  static bool ServerReusePort;
   static int ServerThreadCount;
   static bool ServerThreadRoundRobin;
   static int ServerThreadDropCacheTimeoutSeconds;
@@ -122,6 +125,8 @@ public:
   static int ServerShutdownListenWait;
   static int ServerShutdownListenNoWork;
   static int GzipCompressionLevel;
+  static int ServerCompressionThreads;
+  static bool EnableLZ4Encoding;
   static std::string ForceCompressionURL;
   static std::string ForceCompressionCookie;
   static std::string ForceCompressionParam;
@@ -290,6 +295,7 @@ public:
   static bool EnableAPCSizeDetail;
   static bool EnableAPCFetchStats;
   static bool APCSizeCountPrime;
+  static std::string APCSizePrefixSeparator;
   static bool EnableHotProfiler;
   static int32_t ProfilerTraceBuffer;
   static double ProfilerTraceExpansion;
@@ -303,6 +309,7 @@ public:
   static int  SocketDefaultTimeout;
   static bool LockCodeMemory;
   static bool EnableMemoryManager;
+  static int SmartHeapRetainedSlabs;
   static bool CheckMemory;
   static int MaxArrayChain;
   static bool StrictCollections;
@@ -315,13 +322,22 @@ public:
   static int ApcLoadThread;
   static std::set<std::string> ApcCompletionKeys;
   enum ApcTableTypes {
-    ApcConcurrentTable
+    ApcConcurrentTable,
+    ApcShardedTable
   };
   static ApcTableTypes ApcTableType;
   static bool EnableApcSerialize;
+  static bool ApcCompactSerialize;
   static time_t ApcKeyMaturityThreshold;
   static size_t ApcMaximumCapacity;
   static int ApcKeyFrequencyUpdatePeriod;
+  static int64_t ApcMemoryLimit;
+  enum ApcEvictionPolicies {
+    ApcEvictLRU,
+    ApcEvictLFU
+  };
+  static ApcEvictionPolicies ApcEvictionPolicy;
+  static int ApcEvictionSamples;
   static bool ApcExpireOnSets;
   static int ApcPurgeFrequency;
   static int ApcPurgeRate;
@@ -336,6 +352,9 @@ public:
   static bool ApcConcurrentTableLockFree;
   static bool ApcFileStorageKeepFileLinked;
   static std::vector<std::string> ApcNoTTLPrefix;
+  static std::string ApcSnapshotPath;
+  static int ApcSnapshotMaxAge;
+  static int ApcSnapshotWaitSeconds;
 
   static bool EnableDnsCache;
   static int DnsCacheTTL;
@@ -392,11 +411,19 @@ public:
   F(bool, ProfileBC,                   false)                           \
   F(bool, ProfileHWEnable,             true)                            \
   F(string, ProfileHWEvents,           string(""))                      \
+  F(bool, ProfileHWDtlbMisses,         false)                           \
   F(bool, JitTrampolines,              true)                            \
   F(string, JitProfilePath,            string(""))                      \
   F(int32_t, JitStressTypePredPercent, 0)                               \
   F(uint32_t, JitWarmupRequests,       kDefaultWarmupRequests)          \
   F(bool, JitProfileRecord,            false)                           \
+  F(string, JitWarmupProfile,          string(""))                      \
+  F(bool, JitWarmupProfileRecord,      false)                           \
+  F(uint32_t, JitCompileThreads,       0)                               \
+  F(uint32_t, JitTCReplaceFullPercent, 0)                               \
+  F(uint32_t, JitTCReplaceDeadPercent, 0)                               \
+  F(uint32_t, JitTCReplaceCheckMs,     1000)                            \
+  F(uint32_t, JitHotTraceletThreshold, 0)                               \
   F(uint32_t, GdbSyncChunks,           128)                             \
   F(bool, JitStressLease,              false)                           \
   F(bool, JitKeepDbgFiles,             false)                           \
@@ -405,6 +432,7 @@ public:
   F(bool, JitDisabledByHphpd,          false)                           \
   F(bool, ThreadingJit,                false)                           \
   F(bool, JitTransCounters,            false)                           \
+  F(bool, JitMethodCacheStats,         false)                           \
   F(bool, JitMGeneric,                 true)                            \
   F(bool, JitUseIR,                    false)                           \
   F(double, JitCompareHHIR,            0)                               \
@@ -427,14 +455,20 @@ public:
   F(bool, HHIRGenerateAsserts,         debug)                           \
   F(bool, HHIRDirectExit,              true)                            \
   F(bool, HHIRDisableTx64,             false)                           \
+  F(uint32_t, HHIRMaxCondJmpsTracedThrough, 0)                          \
   F(uint64_t, MaxHHIRTrans,            -1)                              \
   F(bool, HHIRDeadCodeElim,            true)                            \
+  F(bool, HHIREscapeOpt,               false)                           \
+  F(bool, HHIRInlineTrivialCalls,      false)                           \
   F(bool, DumpBytecode,                false)                           \
   F(bool, DumpTC,                      false)                           \
   F(bool, DumpAst,                     false)                           \
   F(bool, MapTCHuge,                   true)                            \
+  F(bool, MapRequestHeapHuge,          false)                           \
+  F(bool, MapStacksHuge,               false)                           \
   F(bool, RandomHotFuncs,              false)                           \
   F(uint32_t, ConstEstimate,           10000)                           \
+  F(uint32_t, RequestInternMaxLength,  32)                              \
   F(bool, DisableSomeRepoAuthNotices,  true)                            \
   /* */                                                                 \
 
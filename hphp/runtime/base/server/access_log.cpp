@@ -26,6 +26,8 @@
 #include <util/compatibility.h>
 #include <util/util.h>
 #include <runtime/base/hardware_counter.h>
+#include <sys/uio.h>
+#include <limits.h>
 
 using std::endl;
 
@@ -33,7 +35,43 @@ namespace HPHP {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+AccessLogRing::AccessLogRing(uint32_t size)
+  : m_size(size & ~7u), m_head(0), m_tail(0) {
+  m_buf = (char *)malloc(m_size);
+}
+
+AccessLogRing::~AccessLogRing() {
+  free(m_buf);
+}
+
+bool AccessLogRing::push(int file, const std::string &line) {
+  uint32_t need = (sizeof(RecordHeader) + line.size() + 7) & ~7u;
+  if (need > m_size) return false;
+  uint64_t head = m_head.load(std::memory_order_relaxed);
+  uint64_t tail = m_tail.load(std::memory_order_acquire);
+  uint32_t pos = head % m_size;
+  // both are multiples of 8, so there's always room for a skip record
+  uint32_t skip = pos + need > m_size ? m_size - pos : 0;
+  if (head + skip + need - tail > m_size) return false;
+  if (skip) {
+    RecordHeader *pad = (RecordHeader *)(m_buf + pos);
+    pad->len = 0;
+    pad->file = kSkip;
+    head += skip;
+    pos = 0;
+  }
+  RecordHeader *rec = (RecordHeader *)(m_buf + pos);
+  rec->len = line.size();
+  rec->file = file;
+  memcpy(rec + 1, line.data(), line.size());
+  m_head.store(head + need, std::memory_order_release);
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 AccessLog::~AccessLog() {
+  stopWriter();
   signal(SIGCHLD, SIG_DFL);
   for (uint i = 0; i < m_output.size(); ++i) {
     if (m_output[i].log) {
@@ -106,6 +144,168 @@ void AccessLog::openFiles(const string &username) {
   }
 }
 
+void AccessLog::startWriter(int bufferSize) {
+  if (!m_initialized || m_ringSize || bufferSize <= 0) return;
+  if (m_output.empty() && m_cronOutput.empty()) return;
+  m_stopping = false;
+  m_ringSize = bufferSize;
+  m_writerThread.start();
+}
+
+void AccessLog::stopWriter() {
+  if (!m_ringSize) return;
+  // requests logging from here on write synchronously
+  m_ringSize = 0;
+  {
+    Lock lock(this);
+    m_stopping = true;
+    notify();
+  }
+  m_writerThread.waitForEnd();
+  drainRings();
+}
+
+void AccessLog::writerLoop() {
+  while (true) {
+    drainRings();
+    Lock lock(this);
+    if (m_stopping) break;
+    wait(0, 10 * 1000 * 1000); // 10ms
+  }
+}
+
+/**
+ * Write the iovecs out in full, IOV_MAX at a time. Returns the number of
+ * bytes written; on an error, done is the number of iovecs written in full.
+ */
+static int writev_all(int fd, std::vector<iovec> &iov, size_t &done) {
+  int total = 0;
+  size_t i = 0;
+  while (i < iov.size()) {
+    int count = std::min(iov.size() - i, (size_t)IOV_MAX);
+    ssize_t n = writev(fd, &iov[i], count);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    total += n;
+    while (i < iov.size() && (size_t)n >= iov[i].iov_len) {
+      n -= iov[i++].iov_len;
+    }
+    if (n > 0) {
+      iov[i].iov_base = (char *)iov[i].iov_base + n;
+      iov[i].iov_len -= n;
+    }
+  }
+  done = i;
+  return total;
+}
+
+void AccessLog::drainRings() {
+  std::vector<AccessLogRingPtr> rings;
+  {
+    Lock lock(this);
+    rings = m_rings;
+  }
+  if (rings.empty()) return;
+
+  std::vector<std::vector<iovec> > iovs(m_files.size());
+  std::vector<int64_t> bytes(m_files.size());
+  std::vector<uint64_t> heads(rings.size());
+  for (uint i = 0; i < rings.size(); i++) {
+    heads[i] = rings[i]->peek([&](uint32_t file, const char *data,
+                                  uint32_t len) {
+      iovec iov;
+      iov.iov_base = (void *)data;
+      iov.iov_len = len;
+      iovs[file].push_back(iov);
+      bytes[file] += len;
+    });
+  }
+
+  for (uint i = 0; i < iovs.size(); i++) {
+    if (iovs[i].empty()) continue;
+    FILE *outFile = getOutputFile(i);
+    size_t done = 0;
+    int written = outFile ? writev_all(fileno(outFile), iovs[i], done) : 0;
+    if (written) onBytesWritten(i, outFile, written);
+    if (done < iovs[i].size()) {
+      m_droppedLines.fetch_add(iovs[i].size() - done,
+                               std::memory_order_relaxed);
+      m_droppedBytes.fetch_add(bytes[i] - written,
+                               std::memory_order_relaxed);
+    }
+  }
+
+  // only now can the producers reuse the space
+  for (uint i = 0; i < rings.size(); i++) {
+    rings[i]->release(heads[i]);
+  }
+
+  // forget the rings of threads that have exited, once they're empty
+  rings.clear();
+  Lock lock(this);
+  for (uint i = 0; i < m_rings.size(); ) {
+    if (m_rings[i].use_count() == 1 && m_rings[i]->depth() == 0) {
+      m_rings[i] = m_rings.back();
+      m_rings.pop_back();
+    } else {
+      i++;
+    }
+  }
+}
+
+void AccessLog::enqueueLog(Transport *transport, const VirtualHost *vhost,
+                           uint32_t ringSize) {
+  AccessLogRingPtr &ring = m_fGetThreadData()->ring;
+  if (!ring) {
+    ring = std::make_shared<AccessLogRing>(ringSize);
+    Lock lock(this);
+    m_rings.push_back(ring);
+  }
+  for (uint i = 0; i < m_files.size(); i++) {
+    string line = formatLog(transport, vhost, m_files[i].format.c_str());
+    if (!ring->push(i, line)) {
+      ServerStats::Log("accesslog.dropped", 1);
+      ServerStats::Log("accesslog.dropped_bytes", line.size());
+    }
+  }
+  if (m_droppedLines.load(std::memory_order_relaxed)) {
+    ServerStats::Log("accesslog.dropped",
+                     m_droppedLines.exchange(0, std::memory_order_relaxed));
+    ServerStats::Log("accesslog.dropped_bytes",
+                     m_droppedBytes.exchange(0, std::memory_order_relaxed));
+  }
+  ServerStats::Log("accesslog.queue", ring->depth());
+}
+
+FILE *AccessLog::getOutputFile(int file) {
+  if (Logger::UseCronolog) {
+    return m_cronOutput[file]->getOutputFile();
+  }
+  return m_output[file].log;
+}
+
+void AccessLog::onBytesWritten(int file, FILE *outFile, int bytes) {
+  if (Logger::UseCronolog) {
+    Cronolog &cronOutput = *m_cronOutput[file];
+    cronOutput.m_bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+    cronOutput.m_prevBytesWritten = Logger::checkDropCache(
+      cronOutput.m_bytesWritten.load(std::memory_order_relaxed),
+      cronOutput.m_prevBytesWritten,
+      outFile);
+  } else {
+    LogFileData& output = m_output[file];
+    output.bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+    if (m_files[file].file[0] != '|') {
+      output.prevBytesWritten =
+        Logger::checkDropCache(output.bytesWritten,
+                               output.prevBytesWritten,
+                               outFile);
+    }
+  }
+}
+
 void AccessLog::log(Transport *transport, const VirtualHost *vhost) {
   assert(transport);
   if (!m_initialized) return;
@@ -120,39 +320,31 @@ void AccessLog::log(Transport *transport, const VirtualHost *vhost) {
                              threadData->prevBytesWritten,
                              threadLog);
   }
-  if (Logger::UseCronolog) {
-    for (uint i = 0; i < m_cronOutput.size(); ++i) {
-      Cronolog &cronOutput = *m_cronOutput[i];
-      FILE *outFile = cronOutput.getOutputFile();
-      if (!outFile) continue;
-      const char *format = m_files[i].format.c_str();
-      int bytes = writeLog(transport, vhost, outFile, format);
-      cronOutput.m_bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
-      cronOutput.m_prevBytesWritten = Logger::checkDropCache(
-        cronOutput.m_bytesWritten.load(std::memory_order_relaxed),
-        cronOutput.m_prevBytesWritten,
-        outFile);
-    }
-  } else {
-    for (uint i = 0; i < m_output.size(); ++i) {
-      LogFileData& output = m_output[i];
-      FILE *outFile = output.log;
-      if (!outFile) continue;
-      const char *format = m_files[i].format.c_str();
-      int bytes = writeLog(transport, vhost, outFile, format);
-      output.bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
-      if (m_files[i].file[0] != '|') {
-        output.prevBytesWritten =
-          Logger::checkDropCache(output.bytesWritten,
-                                 output.prevBytesWritten,
-                                 outFile);
-      }
-    }
+  // read once: stopWriter() may turn the writer off under us
+  uint32_t ringSize = m_ringSize.load(std::memory_order_acquire);
+  if (ringSize) {
+    enqueueLog(transport, vhost, ringSize);
+    return;
+  }
+  for (uint i = 0; i < m_files.size(); ++i) {
+    FILE *outFile = getOutputFile(i);
+    if (!outFile) continue;
+    const char *format = m_files[i].format.c_str();
+    int bytes = writeLog(transport, vhost, outFile, format);
+    onBytesWritten(i, outFile, bytes);
   }
 }
 
 int AccessLog::writeLog(Transport *transport, const VirtualHost *vhost,
                         FILE *outFile, const char *format) {
+  string output = formatLog(transport, vhost, format);
+  int nbytes = fprintf(outFile, "%s", output.c_str());
+  fflush(outFile);
+  return nbytes;
+}
+
+string AccessLog::formatLog(Transport *transport, const VirtualHost *vhost,
+                            const char *format) {
    char c;
    std::ostringstream out;
    while ((c = *format++)) {
@@ -172,10 +364,7 @@ int AccessLog::writeLog(Transport *transport, const VirtualHost *vhost,
      }
    }
    out << endl;
-   string output = out.str();
-   int nbytes = fprintf(outFile, "%s", output.c_str());
-   fflush(outFile);
-   return nbytes;
+   return out.str();
 }
 
 bool AccessLog::parseConditions(const char* &format, int code) {
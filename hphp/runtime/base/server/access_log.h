@@ -21,6 +21,8 @@
 #include <util/logger.h>
 #include <util/lock.h>
 #include <util/cronolog.h>
+#include <util/async_func.h>
+#include <util/synchronizable.h>
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
@@ -36,7 +38,62 @@ public:
   std::string format;
 };
 
-class AccessLog {
+/**
+ * Formatted access log lines one request thread has handed to the
+ * background writer. There's a single producer and a single consumer, so
+ * neither side takes a lock: each record is a RecordHeader followed by the
+ * line, padded to 8 bytes, and never wraps around the end of the buffer.
+ */
+class AccessLogRing {
+public:
+  explicit AccessLogRing(uint32_t size);
+  ~AccessLogRing();
+
+  bool push(int file, const std::string &line); // false if full
+  uint64_t depth() const {
+    return m_head.load(std::memory_order_acquire) -
+      m_tail.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Consumer side: call f(file, data, len) on every record pushed so far
+   * and not yet released, oldest first. Returns the position to release()
+   * once they have been written out; until then push() can't reuse their
+   * space.
+   */
+  template <class F> uint64_t peek(F f) const {
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    while (tail < head) {
+      uint32_t pos = tail % m_size;
+      const RecordHeader *rec = (const RecordHeader *)(m_buf + pos);
+      if (rec->file == kSkip) {
+        tail += m_size - pos;
+        continue;
+      }
+      f(rec->file, (const char *)(rec + 1), rec->len);
+      tail += (sizeof(*rec) + rec->len + 7) & ~7u;
+    }
+    return head;
+  }
+  void release(uint64_t head) {
+    m_tail.store(head, std::memory_order_release);
+  }
+
+  struct RecordHeader {
+    uint32_t len;
+    uint32_t file; // kSkip pads to the end of the buffer
+  };
+  static const uint32_t kSkip = 0xffffffff;
+
+  char *m_buf;
+  uint32_t m_size;
+  std::atomic<uint64_t> m_head; // bytes ever pushed, written by the producer
+  std::atomic<uint64_t> m_tail; // bytes ever written out, by the consumer
+};
+typedef std::shared_ptr<AccessLogRing> AccessLogRingPtr;
+
+class AccessLog : public Synchronizable {
 public:
   class ThreadData {
   public:
@@ -45,10 +102,13 @@ public:
     int64_t startTime;
     int bytesWritten;
     int prevBytesWritten;
+    AccessLogRingPtr ring;
   };
   typedef ThreadData* (*GetThreadDataFunc)();
   AccessLog(GetThreadDataFunc f) :
-      m_initialized(false), m_fGetThreadData(f) {}
+      m_initialized(false), m_fGetThreadData(f), m_ringSize(0),
+      m_droppedLines(0), m_droppedBytes(0), m_stopping(false),
+      m_writerThread(this, &AccessLog::writerLoop) {}
   ~AccessLog();
   void init(const std::string &defaultFormat,
             std::vector<AccessLogFileData> &files,
@@ -59,6 +119,15 @@ public:
   bool setThreadLog(const char *file);
   void clearThreadLog();
   void onNewRequest();
+
+  /**
+   * Queue lines in a per-thread buffer of bufferSize bytes and write them
+   * out in batches from a background thread, instead of writing each one
+   * from the request thread. Lines that don't fit are dropped.
+   */
+  void startWriter(int bufferSize);
+  void stopWriter();
+
   std::string &defaultFormat() { return m_defaultFormat; }
   std::vector<AccessLogFileData> &files() { return m_files; }
 private:
@@ -68,8 +137,16 @@ private:
                 Transport *transport, const VirtualHost *vhost,
                 const std::string &arg);
   void skipField(const char* &format);
+  std::string formatLog(Transport *transport, const VirtualHost *vhost,
+                        const char *format);
   int writeLog(Transport *transport, const VirtualHost *vhost,
                FILE *outFile, const char *format);
+  void enqueueLog(Transport *transport, const VirtualHost *vhost,
+                  uint32_t ringSize);
+  FILE *getOutputFile(int file);
+  void onBytesWritten(int file, FILE *outFile, int bytes);
+  void writerLoop();
+  void drainRings();
 
   std::vector<LogFileData> m_output;
   std::vector<CronologPtr> m_cronOutput;
@@ -80,6 +157,15 @@ private:
 
   void openFiles(const std::string &username);
   Mutex m_lock;
+
+  std::atomic<uint32_t> m_ringSize; // 0 when writing synchronously
+  // Lines and bytes the writer thread failed to write. It has no
+  // ServerStats of its own, so request threads pass these on.
+  std::atomic<int64_t> m_droppedLines;
+  std::atomic<int64_t> m_droppedBytes;
+  bool m_stopping;
+  std::vector<AccessLogRingPtr> m_rings; // guarded by getMutex()
+  AsyncFunc<AccessLog> m_writerThread;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
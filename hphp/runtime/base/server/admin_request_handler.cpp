@@ -40,6 +40,7 @@
 #include "runtime/vm/translator/translator.h"
 #include "runtime/vm/translator/translator-deps.h"
 #include "runtime/vm/translator/translator-x64.h"
+#include "runtime/vm/translator/targetcache.h"
 #include "util/alloc.h"
 #include <util/timer.h>
 #include "util/repo_schema.h"
@@ -179,6 +180,7 @@ void AdminRequestHandler::handleRequest(Transport *transport) {
         "/apc-ss:          get apc size stats\n"
         "/apc-ss-flat:     get apc size stats in flat format\n"
         "/apc-ss-keys:     get apc size break-down on keys\n"
+        "/apc-ss-prefix:   get apc memory and evictions by key prefix\n"
         "/apc-ss-dump:     dump the size info on each key to /tmp/APC_details\n"
         "                  only valid when EnableAPCSizeDetail is true\n"
         "    keysample     optional, only dump keys that belongs to the same\n"
@@ -214,6 +216,8 @@ void AdminRequestHandler::handleRequest(Transport *transport) {
         "                  /tmp/tc_dump_astub\n"
         "/vm-preconsts:    show information about preconsts\n"
         "/vm-tcreset:      throw away translations and start over\n"
+        "/vm-method-caches: show per call site method cache hit counts,\n"
+        "                  if Eval.JitMethodCacheStats is set\n"
         ;
 #ifdef USE_TCMALLOC
         if (MallocExtensionInstance) {
@@ -886,7 +890,7 @@ bool AdminRequestHandler::handleAPCSizeRequest (const std::string &cmd,
                                                 Transport *transport) {
   if (!RuntimeOption::EnableAPCSizeStats &&
       (cmd == "apc-ss" || cmd == "apc-ss-keys" || cmd == "apc-ss-dump" ||
-       cmd == "apc-ss-flat")) {
+       cmd == "apc-ss-flat" || cmd == "apc-ss-prefix")) {
     transport->sendString("Not Enabled\n");
     return true;
   }
@@ -900,6 +904,11 @@ bool AdminRequestHandler::handleAPCSizeRequest (const std::string &cmd,
     transport->sendString(result);
     return true;
   }
+  if (cmd == "apc-ss-prefix") {
+    std::string result = SharedStoreStats::report_prefixes();
+    transport->sendString(result);
+    return true;
+  }
   if (cmd == "apc-ss-keys") {
     if (!RuntimeOption::EnableAPCSizeGroup) {
       transport->sendString("Not Enabled\n");
@@ -964,6 +973,10 @@ bool AdminRequestHandler::handleVMRequest(const std::string &cmd,
     transport->sendString(VM::Transl::Translator::Get()->getUsage());
     return true;
   }
+  if (cmd == "vm-method-caches") {
+    transport->sendString(VM::Transl::TargetCache::dumpMethodCacheStats());
+    return true;
+  }
   if (cmd == "vm-preconsts") {
     InfoMap counts;
     using namespace HPHP::VM::Transl;
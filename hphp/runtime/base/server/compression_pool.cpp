@@ -0,0 +1,155 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#include <runtime/base/server/compression_pool.h>
+#include <runtime/base/runtime_option.h>
+#include <util/compression.h>
+#include <util/job_queue.h>
+#include <util/synchronizable.h>
+#include <util/lock.h>
+#include <util/logger.h>
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+// pieces smaller than this aren't worth handing to another thread
+static const int kMinPieceSize = 128 * 1024;
+
+// how much of the input before a piece deflate can refer back to
+static const int kDictionarySize = 32 * 1024;
+
+namespace {
+
+class CompressionBatch;
+
+struct CompressionJob {
+  const char *data;
+  int len;
+  int dictLen;
+  int level;
+  bool last;
+  CompressionBatch *batch;
+
+  char *out;
+  int outLen;
+  uLong crc;
+
+  void run() {
+    out = deflate_piece(data, len, dictLen, level, last, outLen);
+    crc = crc32(crc32(0L, Z_NULL, 0), (const Bytef *)data, len);
+  }
+};
+
+/**
+ * Lets the request thread wait for the pieces it gave to the pool.
+ */
+class CompressionBatch : public Synchronizable {
+public:
+  explicit CompressionBatch(int pending) : m_pending(pending) {}
+
+  void done() {
+    Lock lock(this);
+    if (--m_pending == 0) notify();
+  }
+
+  void waitForAll() {
+    Lock lock(this);
+    while (m_pending) wait();
+  }
+
+private:
+  int m_pending;
+};
+
+class CompressionWorker : public JobQueueWorker<CompressionJob*> {
+public:
+  virtual void doJob(CompressionJob *job) {
+    job->run();
+    job->batch->done();
+  }
+};
+
+}
+
+static JobQueueDispatcher<CompressionJob*, CompressionWorker> *s_dispatcher;
+
+void CompressionPool::Restart() {
+  Stop();
+  if (RuntimeOption::ServerCompressionThreads > 0) {
+    s_dispatcher = new JobQueueDispatcher<CompressionJob*, CompressionWorker>
+      (RuntimeOption::ServerCompressionThreads,
+       RuntimeOption::ServerThreadRoundRobin,
+       RuntimeOption::ServerThreadDropCacheTimeoutSeconds,
+       RuntimeOption::ServerThreadDropStack,
+       nullptr);
+    s_dispatcher->start();
+  }
+}
+
+void CompressionPool::Stop() {
+  if (s_dispatcher) {
+    s_dispatcher->stop();
+    delete s_dispatcher;
+    s_dispatcher = nullptr;
+  }
+}
+
+char *CompressionPool::GzipEncode(const char *data, int &len, int level) {
+  if (!s_dispatcher || len < 2 * kMinPieceSize) return nullptr;
+
+  // one piece for each pool thread plus one for the request thread
+  int count = std::min(RuntimeOption::ServerCompressionThreads + 1,
+                       len / kMinPieceSize);
+  int pieceSize = len / count;
+  std::vector<CompressionJob> jobs(count);
+  CompressionBatch batch(count - 1);
+  for (int i = 0; i < count; i++) {
+    CompressionJob &job = jobs[i];
+    int start = i * pieceSize;
+    job.data = data + start;
+    job.len = i == count - 1 ? len - start : pieceSize;
+    job.dictLen = std::min(start, kDictionarySize);
+    job.level = level;
+    job.last = i == count - 1;
+    job.batch = &batch;
+  }
+  for (int i = 1; i < count; i++) {
+    s_dispatcher->enqueue(&jobs[i]);
+  }
+  jobs[0].run();
+  batch.waitForAll();
+
+  std::vector<char*> pieces(count);
+  std::vector<int> lens(count);
+  uLong size = len;
+  uLong crc = jobs[0].crc;
+  bool failed = false;
+  for (int i = 0; i < count; i++) {
+    pieces[i] = jobs[i].out;
+    lens[i] = jobs[i].outLen;
+    if (!pieces[i]) failed = true;
+    if (i) crc = crc32_combine(crc, jobs[i].crc, jobs[i].len);
+  }
+  char *ret = failed ? nullptr :
+    gzip_wrap(&pieces[0], &lens[0], count, crc, size, len);
+  for (int i = 0; i < count; i++) {
+    free(pieces[i]);
+  }
+  return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}
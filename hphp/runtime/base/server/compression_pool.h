@@ -0,0 +1,49 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef __HPHP_COMPRESSION_POOL_H__
+#define __HPHP_COMPRESSION_POOL_H__
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Threads that help request threads gzip large responses. The body is cut
+ * into pieces that are deflated at the same time, each using the 32KB
+ * before it as a dictionary, and joined into one gzip stream. Clients can't
+ * tell the difference and the ratio barely changes, but a worker no longer
+ * spends tens of milliseconds compressing a response of a few megabytes.
+ */
+class CompressionPool {
+public:
+  /**
+   * Start or restart the pool with Server.CompressionThreads threads.
+   */
+  static void Restart();
+  static void Stop();
+
+  /**
+   * gzip data the way gzencode() does, sharing the work with the pool.
+   * Returns null without doing anything when the pool isn't running or
+   * the data is too small to be worth splitting.
+   */
+  static char *GzipEncode(const char *data, int &len, int level);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif // __HPHP_COMPRESSION_POOL_H__
@@ -0,0 +1,109 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#include <runtime/base/server/header_table.h>
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+// headers added one at a time share blocks of at least this size
+static const int kMinBlockSize = 256;
+
+HeaderTable::HeaderTable() : m_free(nullptr), m_left(0) {
+}
+
+HeaderTable::~HeaderTable() {
+  for (unsigned int i = 0; i < m_blocks.size(); i++) {
+    free(m_blocks[i]);
+  }
+}
+
+void HeaderTable::reserve(int count, int bytes) {
+  m_entries.reserve(m_entries.size() + count);
+  bytes += count * 2; // NULs
+  if (bytes > m_left) {
+    m_free = (char*)malloc(bytes);
+    m_left = bytes;
+    m_blocks.push_back(m_free);
+  }
+}
+
+const char *HeaderTable::copy(const char *s, int len) {
+  if (len + 1 > m_left) {
+    m_left = std::max(len + 1, kMinBlockSize);
+    m_free = (char*)malloc(m_left);
+    m_blocks.push_back(m_free);
+  }
+  char *ret = m_free;
+  memcpy(ret, s, len);
+  ret[len] = '\0';
+  m_free += len + 1;
+  m_left -= len + 1;
+  return ret;
+}
+
+void HeaderTable::add(const char *name, const char *value) {
+  assert(name && value);
+  Entry e;
+  e.nameLen = strlen(name);
+  e.name = copy(name, e.nameLen);
+  e.value = copy(value, strlen(value));
+  m_entries.push_back(e);
+}
+
+void HeaderTable::remove(const char *name) {
+  assert(name);
+  int len = strlen(name);
+  unsigned int j = 0;
+  for (unsigned int i = 0; i < m_entries.size(); i++) {
+    const Entry &e = m_entries[i];
+    if (e.nameLen != len || strcasecmp(e.name, name)) {
+      m_entries[j++] = e;
+    }
+  }
+  m_entries.resize(j);
+}
+
+const char *HeaderTable::find(const char *name) const {
+  assert(name);
+  int len = strlen(name);
+  for (unsigned int i = 0; i < m_entries.size(); i++) {
+    const Entry &e = m_entries[i];
+    if (e.nameLen == len && !strcasecmp(e.name, name)) {
+      return e.value;
+    }
+  }
+  return nullptr;
+}
+
+void HeaderTable::getHeaders(HeaderMap &headers) const {
+  headers.clear();
+  for (unsigned int i = 0; i < m_entries.size(); i++) {
+    const Entry &e = m_entries[i];
+    headers[e.name].push_back(e.value);
+  }
+}
+
+void HeaderTable::forEach(Transport::HeaderVisitor visitor,
+                          void *data) const {
+  for (unsigned int i = 0; i < m_entries.size(); i++) {
+    const Entry &e = m_entries[i];
+    visitor(e.name, e.value, data);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}
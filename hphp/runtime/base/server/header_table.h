@@ -0,0 +1,76 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef __HTTP_SERVER_HEADER_TABLE_H__
+#define __HTTP_SERVER_HEADER_TABLE_H__
+
+#include <runtime/base/server/transport.h>
+#include <boost/noncopyable.hpp>
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Request headers as a flat table of name/value pairs, in the order they
+ * arrived, with all the strings copied into a few large blocks instead of
+ * one allocation each. Lookups scan the table, which for the dozen or so
+ * headers of a typical request is cheaper than building a HeaderMap.
+ */
+class HeaderTable : private boost::noncopyable {
+public:
+  HeaderTable();
+  ~HeaderTable();
+
+  /**
+   * Make room for count more headers whose names and values take bytes in
+   * all, not counting terminating NULs, so adding them allocates nothing.
+   */
+  void reserve(int count, int bytes);
+
+  void add(const char *name, const char *value);
+  void remove(const char *name);
+
+  /**
+   * First value of a header, matching the name case-insensitively, or
+   * null if the request doesn't have it.
+   */
+  const char *find(const char *name) const;
+
+  void getHeaders(HeaderMap &headers) const;
+  // Visit every header in the order it arrived, without building a map.
+  void forEach(Transport::HeaderVisitor visitor, void *data) const;
+  int size() const { return m_entries.size();}
+
+private:
+  struct Entry {
+    const char *name;
+    const char *value;
+    int nameLen;
+  };
+  std::vector<Entry> m_entries;
+
+  // blocks holding the strings; new ones start when m_free runs out
+  std::vector<char*> m_blocks;
+  char *m_free;
+  int m_left;
+
+  const char *copy(const char *s, int len);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif // __HTTP_SERVER_HEADER_TABLE_H__
@@ -56,6 +56,49 @@ static bool read_all_post_data(Transport *transport,
   return false;
 }
 
+// HTTP_ headers -- we don't exclude headers we handle elsewhere (e.g.,
+// Content-Type, Authorization), since the CGI "spec" merely says the server
+// "may" exclude them; this is not what APE does, but it's harmless.
+struct HttpHeaderVars {
+  explicit HttpHeaderVars(Variant &s) : server(s) {}
+  Variant &server;
+  Array names; // key => header that set it, for LogHeaderMangle
+};
+
+static void set_http_header(const char *name, const char *value,
+                            void *data) {
+  HttpHeaderVars &vars = *(HttpHeaderVars*)data;
+  String key = "HTTP_";
+  key += StringUtil::ToUpper(name).replace("-", "_");
+
+  // Detect suspicious headers.  We are about to modify header names
+  // for the SERVER variable.  This means that it is possible to
+  // deliberately cause a header collision, which an attacker could
+  // use to sneak a header past a proxy that would either overwrite
+  // or filter it otherwise.  Client code should use
+  // apache_request_headers() to retrieve the original headers if
+  // they are security-critical.
+  // A header sent more than once just sets its key again.
+  static int bad_request_count = -1;
+  if (RuntimeOption::LogHeaderMangle != 0) {
+    if (vars.server.asArrRef().exists(key) &&
+        (!vars.names.exists(key) ||
+         strcasecmp(vars.names[key].toString().data(), name)) &&
+        !(++bad_request_count % RuntimeOption::LogHeaderMangle)) {
+      Logger::Warning(
+        "HeaderMangle warning: "
+        "The header %s overwrote another header which mapped to the same "
+        "key. This happens because PHP normalises - to _, ie AN_EXAMPLE "
+        "and AN-EXAMPLE are equivalent.  You should treat this as "
+        "malicious.",
+        name);
+    }
+    vars.names.set(key, String(name, CopyString));
+  }
+
+  vars.server.set(key, String(value, CopyString));
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 const VirtualHost *HttpProtocol::GetVirtualHost(Transport *transport) {
@@ -190,46 +233,8 @@ void HttpProtocol::PrepareSystemVariables(Transport *transport,
 
   // $_SERVER
 
-  // HTTP_ headers -- we don't exclude headers we handle elsewhere (e.g.,
-  // Content-Type, Authorization), since the CGI "spec" merely says the server
-  // "may" exclude them; this is not what APE does, but it's harmless.
-  HeaderMap headers;
-  transport->getHeaders(headers);
-
-  static int bad_request_count = -1;
-  for (HeaderMap::const_iterator iter = headers.begin();
-       iter != headers.end(); ++iter) {
-    const vector<string> &values = iter->second;
-
-    // Detect suspicious headers.  We are about to modify header names
-    // for the SERVER variable.  This means that it is possible to
-    // deliberately cause a header collision, which an attacker could
-    // use to sneak a header past a proxy that would either overwrite
-    // or filter it otherwise.  Client code should use
-    // apache_request_headers() to retrieve the original headers if
-    // they are security-critical.
-    if (RuntimeOption::LogHeaderMangle != 0) {
-      String key = "HTTP_";
-      key += StringUtil::ToUpper(iter->first).replace("-","_");
-      if (server.asArrRef().exists(key)) {
-        if (!(++bad_request_count % RuntimeOption::LogHeaderMangle)) {
-          Logger::Warning(
-            "HeaderMangle warning: "
-            "The header %s overwrote another header which mapped to the same "
-            "key. This happens because PHP normalises - to _, ie AN_EXAMPLE "
-            "and AN-EXAMPLE are equivalent.  You should treat this as "
-            "malicious.",
-            iter->first.c_str());
-        }
-      }
-    }
-
-    for (unsigned int i = 0; i < values.size(); i++) {
-      String key = "HTTP_";
-      key += StringUtil::ToUpper(iter->first).replace("-", "_");
-      server.set(key, String(values[i]));
-    }
-  }
+  HttpHeaderVars headerVars(server);
+  transport->forEachHeader(set_http_header, &headerVars);
 
   string host = transport->getHeader("Host");
   String hostName(VirtualHost::GetCurrent()->serverName(host));
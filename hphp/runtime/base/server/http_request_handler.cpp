@@ -46,12 +46,89 @@ HttpRequestHandler::HttpRequestHandler()
   : m_pathTranslation(true) {
 }
 
+/**
+ * Whether an If-None-Match header lists etag. Tags compare weakly, as GET
+ * and HEAD allow, so W/"x" matches "x".
+ */
+static bool etag_matches(const std::string &header, const std::string &etag) {
+  if (header.empty() || etag.empty()) return false;
+  const char *tag = etag.c_str();
+  if (strncmp(tag, "W/", 2) == 0) tag += 2;
+  int tagLen = strlen(tag);
+
+  const char *p = header.c_str();
+  while (true) {
+    while (*p == ' ' || *p == '\t' || *p == ',') p++;
+    if (!*p) return false;
+    if (*p == '*') return true;
+    if (strncmp(p, "W/", 2) == 0) p += 2;
+    const char *start = p;
+    if (*p == '"') {
+      p = strchr(p + 1, '"');
+      if (!p) return false;
+      p++;
+    } else {
+      while (*p && *p != ',') p++;
+    }
+    if (p - start == tagLen && memcmp(start, tag, tagLen) == 0) return true;
+  }
+}
+
+void HttpRequestHandler::addCacheHeaders(Transport *transport, time_t mtime,
+                                         const std::string &cmd,
+                                         const std::string &etag) {
+  time_t base = time(nullptr);
+  if (RuntimeOption::ExpiresActive) {
+    time_t expires = base + RuntimeOption::ExpiresDefault;
+    char age[20];
+    snprintf(age, sizeof(age), "max-age=%d", RuntimeOption::ExpiresDefault);
+    transport->addHeader("Cache-Control", age);
+    transport->addHeader
+      ("Expires", DateTime(expires, true).toString(DateTime::HttpHeader));
+  }
+
+  if (mtime) {
+    transport->addHeader
+      ("Last-Modified", DateTime(mtime, true).toString(DateTime::HttpHeader));
+  }
+  if (!etag.empty()) {
+    transport->addHeader("ETag", etag.c_str());
+  }
+
+  for (unsigned int i = 0; i < RuntimeOption::FilesMatches.size(); i++) {
+    FilesMatch &rule = *RuntimeOption::FilesMatches[i];
+    if (rule.match(cmd)) {
+      const vector<string> &headers = rule.getHeaders();
+      for (unsigned int j = 0; j < headers.size(); j++) {
+        transport->addHeader(String(headers[j]));
+      }
+    }
+  }
+}
+
+bool HttpRequestHandler::sendNotModified(Transport *transport, time_t mtime,
+                                         const std::string &cmd,
+                                         const std::string &etag) {
+  // Only a GET or HEAD can be answered with a 304; anything else is served
+  // as usual.
+  Transport::Method method = transport->getMethod();
+  if (method != Transport::GET && method != Transport::HEAD) return false;
+  if (!etag_matches(transport->getHeader("If-None-Match"), etag)) {
+    return false;
+  }
+  addCacheHeaders(transport, mtime, cmd, etag);
+  transport->disableCompression();
+  transport->sendRaw((void*)"", 0, 304);
+  return true;
+}
+
 void HttpRequestHandler::sendStaticContent(Transport *transport,
                                            const char *data, int len,
                                            time_t mtime,
                                            bool compressed,
                                            const std::string &cmd,
-                                           const char *ext) {
+                                           const char *ext,
+                                           const std::string &etag /* = "" */) {
   assert(ext);
   assert(cmd.rfind('.') != string::npos);
   assert(strcmp(ext, cmd.c_str() + cmd.rfind('.') + 1) == 0);
@@ -74,32 +151,9 @@ void HttpRequestHandler::sendStaticContent(Transport *transport,
     transport->addHeader("Content-Type", "application/octet-stream");
   }
 
-  time_t base = time(nullptr);
-  if (RuntimeOption::ExpiresActive) {
-    time_t expires = base + RuntimeOption::ExpiresDefault;
-    char age[20];
-    snprintf(age, sizeof(age), "max-age=%d", RuntimeOption::ExpiresDefault);
-    transport->addHeader("Cache-Control", age);
-    transport->addHeader
-      ("Expires", DateTime(expires, true).toString(DateTime::HttpHeader));
-  }
-
-  if (mtime) {
-    transport->addHeader
-      ("Last-Modified", DateTime(mtime, true).toString(DateTime::HttpHeader));
-  }
+  addCacheHeaders(transport, mtime, cmd, etag);
   transport->addHeader("Accept-Ranges", "bytes");
 
-  for (unsigned int i = 0; i < RuntimeOption::FilesMatches.size(); i++) {
-    FilesMatch &rule = *RuntimeOption::FilesMatches[i];
-    if (rule.match(cmd)) {
-      const vector<string> &headers = rule.getHeaders();
-      for (unsigned int j = 0; j < headers.size(); j++) {
-        transport->addHeader(String(headers[j]));
-      }
-    }
-  }
-
   // misnomer, it means we have made decision on compression, transport
   // should not attempt to compress it.
   transport->disableCompression();
@@ -174,6 +228,13 @@ void HttpRequestHandler::handleRequest(Transport *transport) {
       bool original = compressed;
       // check against static content cache
       if (StaticContentCache::TheCache.find(path, data, len, compressed)) {
+        // answered before looking at the data, which may not be paged in
+        string etag = StaticContentCache::TheCache.getETag(path);
+        if (sendNotModified(transport, 0, path, etag)) {
+          ServerStats::LogPage(path, 304);
+          GetAccessLog().log(transport, vhost);
+          return;
+        }
         Util::ScopedMem decompressed_data;
         // (qigao) not calling stat at this point because the timestamp of
         // local cache file is not valuable, maybe misleading. This way
@@ -187,8 +248,11 @@ void HttpRequestHandler::handleRequest(Transport *transport) {
           decompressed_data = const_cast<char*>(data);
           compressed = false;
         }
-        sendStaticContent(transport, data, len, 0, compressed, path, ext);
-        StaticContentCache::TheFileCache->adviseOutMemory();
+        sendStaticContent(transport, data, len, 0, compressed, path, ext,
+                          etag);
+        if (StaticContentCache::TheFileCache) {
+          StaticContentCache::TheFileCache->adviseOutMemory();
+        }
         ServerStats::LogPage(path, 200);
         GetAccessLog().log(transport, vhost);
         return;
@@ -197,14 +261,20 @@ void HttpRequestHandler::handleRequest(Transport *transport) {
 
     if (RuntimeOption::EnableStaticContentFromDisk) {
       String translated = File::TranslatePath(String(absPath));
-      if (!translated.empty()) {
+      struct stat st;
+      if (!translated.empty() && stat(translated.data(), &st) == 0 &&
+          S_ISREG(st.st_mode)) {
+        // no need to read the file if the client has it already
+        string etag = StaticContentCache::MakeETag(st.st_mtime, st.st_size);
+        if (sendNotModified(transport, st.st_mtime, path, etag)) {
+          ServerStats::LogPage(path, 304);
+          GetAccessLog().log(transport, vhost);
+          return;
+        }
         CstrBuffer sb(translated.data());
         if (sb.valid()) {
-          struct stat st;
-          st.st_mtime = 0;
-          stat(translated.data(), &st);
           sendStaticContent(transport, sb.data(), sb.size(), st.st_mtime,
-                            false, path, ext);
+                            false, path, ext, etag);
           ServerStats::LogPage(path, 200);
           GetAccessLog().log(transport, vhost);
           return;
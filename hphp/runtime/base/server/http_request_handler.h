@@ -48,7 +48,12 @@ private:
   void sendStaticContent(Transport *transport, const char *data, int len,
                          time_t mtime, bool compressed,
                          const std::string &cmd,
-                         const char *ext);
+                         const char *ext,
+                         const std::string &etag = "");
+  bool sendNotModified(Transport *transport, time_t mtime,
+                       const std::string &cmd, const std::string &etag);
+  void addCacheHeaders(Transport *transport, time_t mtime,
+                       const std::string &cmd, const std::string &etag);
   bool executePHPRequest(Transport *transport, RequestURI &reqURI,
                          SourceRootInfo &sourceRootInfo,
                          bool cachableDynamicContent);
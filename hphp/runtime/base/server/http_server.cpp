@@ -47,13 +47,22 @@ time_t HttpServer::StartTime;
 
 ///////////////////////////////////////////////////////////////////////////////
 
+static Compressor *create_lz4_compressor(int level) {
+  return new LZ4StreamCompressor();
+}
+
 HttpServer::HttpServer(void *sslCTX /* = NULL */)
   : m_stopped(false), m_sslCTX(sslCTX),
-    m_watchDog(this, &HttpServer::watchDog) {
+    m_watchDog(this, &HttpServer::watchDog),
+    m_apcAdopter(this, &HttpServer::adoptApcSnapshot) {
 
   // enabling mutex profiling, but it's not turned on
   LockProfiler::s_pfunc_profile = server_stats_log_mutex;
 
+  if (RuntimeOption::EnableLZ4Encoding) {
+    Transport::RegisterCompressor("x-lz4", create_lz4_compressor);
+  }
+
   if (RuntimeOption::ServerPortFd != -1 || RuntimeOption::SSLPortFd != -1) {
     LibEventServerWithFd* server =
       (new TypedServer<LibEventServerWithFd, HttpRequestHandler>
@@ -62,13 +71,18 @@ HttpServer::HttpServer(void *sslCTX /* = NULL */)
         RuntimeOption::RequestTimeoutSeconds));
     server->setServerSocketFd(RuntimeOption::ServerPortFd);
     server->setSSLSocketFd(RuntimeOption::SSLPortFd);
+    server->setEventLoopCount(RuntimeOption::ServerEventLoops,
+                              RuntimeOption::ServerReusePort);
     m_pageServer = ServerPtr(server);
   } else if (RuntimeOption::TakeoverFilename.empty()) {
-    m_pageServer = ServerPtr
+    LibEventServer* server =
       (new TypedServer<LibEventServer, HttpRequestHandler>
        (RuntimeOption::ServerIP, RuntimeOption::ServerPort,
         RuntimeOption::ServerThreadCount,
         RuntimeOption::RequestTimeoutSeconds));
+    server->setEventLoopCount(RuntimeOption::ServerEventLoops,
+                              RuntimeOption::ServerReusePort);
+    m_pageServer = ServerPtr(server);
   } else {
     LibEventServerWithTakeover* server =
       (new TypedServer<LibEventServerWithTakeover, HttpRequestHandler>
@@ -77,6 +91,8 @@ HttpServer::HttpServer(void *sslCTX /* = NULL */)
         RuntimeOption::RequestTimeoutSeconds));
     server->setTransferFilename(RuntimeOption::TakeoverFilename);
     server->addTakeoverListener(this);
+    server->setEventLoopCount(RuntimeOption::ServerEventLoops,
+                              RuntimeOption::ServerReusePort);
     m_pageServer = ServerPtr(server);
   }
 
@@ -215,6 +231,13 @@ void HttpServer::run() {
     m_serviceThreads[i]->waitForStarted();
   }
 
+  // The server we may be taking over from writes its snapshot only after
+  // it lets go of the page server port, so start looking before that.
+  bool adoptingApc = !RuntimeOption::ApcSnapshotPath.empty();
+  if (adoptingApc) {
+    m_apcAdopter.start();
+  }
+
   if (RuntimeOption::ServerPort) {
     if (!startServer(true)) {
       Logger::Error("Unable to start page server");
@@ -291,6 +314,11 @@ void HttpServer::run() {
     m_serviceThreads[i]->waitForEnd();
   }
 
+  if (adoptingApc) {
+    m_apcAdopter.waitForEnd();
+    saveApcSnapshot();
+  }
+
   hphp_process_exit();
   m_watchDog.waitForEnd();
   Logger::Info("all servers stopped");
@@ -362,6 +390,31 @@ void HttpServer::killPid() {
   }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// apc snapshots
+
+void HttpServer::adoptApcSnapshot() {
+  for (int i = RuntimeOption::ApcSnapshotWaitSeconds * 10; !m_stopped; i--) {
+    if (apc_adopt_snapshot()) return;
+    if (i <= 0) break;
+    usleep(100000);
+  }
+  Logger::Info("No apc snapshot to adopt from %s",
+               RuntimeOption::ApcSnapshotPath.c_str());
+}
+
+void HttpServer::saveApcSnapshot() {
+  // Writing serializes values, which needs a request's memory manager.
+  hphp_session_init();
+  ExecutionContext *context = hphp_context_init();
+  if (!apc_save_snapshot()) {
+    Logger::Error("Unable to write apc snapshot %s",
+                  RuntimeOption::ApcSnapshotPath.c_str());
+  }
+  hphp_context_exit(context, false, true);
+  hphp_session_exit();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // watch dog thread
 
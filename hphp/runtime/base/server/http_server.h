@@ -44,6 +44,7 @@ public:
 
   void flushLog();
   void watchDog();
+  void adoptApcSnapshot();
 
   void takeoverShutdown(LibEventServerWithTakeover* server);
 
@@ -58,11 +59,13 @@ private:
   SatelliteServerPtrVec m_satellites;
   SatelliteServerPtrVec m_danglings;
   AsyncFunc<HttpServer> m_watchDog;
+  AsyncFunc<HttpServer> m_apcAdopter;
   ServiceThreadPtrVec m_serviceThreads;
 
   bool startServer(bool pageServer);
   void onServerShutdown();
   void abortServers();
+  void saveApcSnapshot();
 
   // pid file functions
   void createPid();
@@ -23,6 +23,14 @@
 #include <util/compatibility.h>
 #include <util/logger.h>
 
+#include <boost/lexical_cast.hpp>
+#include <netdb.h>
+#include <fcntl.h>
+
+#ifndef SO_REUSEPORT
+#define SO_REUSEPORT 15
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 // static handler
 
@@ -44,11 +52,76 @@ static void on_thread_stop(int fd, short events, void *context) {
   event_base_loopbreak((struct event_base *)context);
 }
 
+static void on_loop_request(struct evhttp_request *request, void *obj) {
+  assert(obj);
+  HPHP::LibEventLoop *loop = (HPHP::LibEventLoop*)obj;
+  loop->getServer()->onRequest(request, loop->getIndex());
+}
+
+static void on_loop_control(int fd, short what, void *obj) {
+  assert(obj);
+  ((HPHP::LibEventLoop*)obj)->onControl();
+}
+
 namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+// helpers
+
+static void dispatch_with_timeout(event_base *eventBase, int timeoutSeconds) {
+  struct timeval timeout;
+  timeout.tv_sec = timeoutSeconds;
+  timeout.tv_usec = 0;
+
+  event eventTimeout;
+  event_set(&eventTimeout, -1, 0, on_timer, eventBase);
+  event_base_set(eventBase, &eventTimeout);
+  event_add(&eventTimeout, &timeout);
+
+  event_base_loop(eventBase, EVLOOP_ONCE);
+
+  event_del(&eventTimeout);
+}
+
+/**
+ * A non-blocking listen socket with SO_REUSEPORT set, so that every event
+ * loop can have its own on the same port and the kernel (Linux 3.9 and up)
+ * spreads new connections across them. Returns -1 and sets errno on error.
+ */
+static int bind_reuseport_socket(const std::string &address, int port) {
+  struct addrinfo hints, *ai = nullptr;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  std::string service = boost::lexical_cast<std::string>(port);
+  if (getaddrinfo(address.empty() ? nullptr : address.c_str(),
+                  service.c_str(), &hints, &ai) != 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  int on = 1;
+  int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+  if (fd < 0 ||
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+      setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0 ||
+      fcntl(fd, F_SETFL, O_NONBLOCK) < 0 ||
+      bind(fd, ai->ai_addr, ai->ai_addrlen) < 0 ||
+      listen(fd, RuntimeOption::ServerBacklog) < 0) {
+    int errno_save = errno;
+    if (fd >= 0) close(fd);
+    freeaddrinfo(ai);
+    errno = errno_save;
+    return -1;
+  }
+  freeaddrinfo(ai);
+  return fd;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // LibEventJob
 
-LibEventJob::LibEventJob(evhttp_request *req) : request(req) {
+LibEventJob::LibEventJob(evhttp_request *req, int loop)
+  : request(req), loop(loop) {
   gettime(CLOCK_MONOTONIC, &start);
 }
 
@@ -86,13 +159,16 @@ void LibEventWorker::doJob(LibEventJobPtr job) {
   evhttp_request *request = job->request;
   assert(m_opaque);
   LibEventServer *server = (LibEventServer*)m_opaque;
+  if (server->getEventLoopCount() > 1) {
+    server->logLoopStats(*job);
+  }
 
   if (m_handler == nullptr || server->supportReset()) {
     m_handler = server->createRequestHandler();
     assert(m_handler);
   }
 
-  LibEventTransport transport(server, request, m_id);
+  LibEventTransport transport(server, request, m_id, job->loop);
 #ifdef _EVENT_USE_OPENSSL
   if (evhttp_is_connection_ssl(job->request->evcon)) {
     transport.setSSL();
@@ -157,6 +233,8 @@ LibEventServer::LibEventServer(const std::string &address, int port,
     m_accept_sock_ssl(-1),
     m_timeoutThreadData(timeoutSeconds),
     m_timeoutThread(&m_timeoutThreadData, &TimeoutThread::run),
+    m_loopCount(1),
+    m_reusePort(false),
     m_dispatcher(thread, RuntimeOption::ServerThreadRoundRobin,
                  RuntimeOption::ServerThreadDropCacheTimeoutSeconds,
                  RuntimeOption::ServerThreadDropStack,
@@ -182,6 +260,23 @@ LibEventServer::~LibEventServer() {
   if (getStatus() != STOPPING) {
     event_base_free(m_eventBase);
   }
+  for (unsigned int i = 0; i < m_loops.size(); i++) {
+    delete m_loops[i];
+  }
+}
+
+void LibEventServer::setEventLoopCount(int count, bool reusePort) {
+  assert(getStatus() == NOT_YET_STARTED);
+  m_loopCount = std::max(count, 1);
+  m_reusePort = reusePort;
+  evhttp_set_connection_limit(m_server, getLoopConnectionLimit());
+}
+
+int LibEventServer::getLoopConnectionLimit() const {
+  // ServerConnectionLimit is for the whole server, so split it up
+  int limit = RuntimeOption::ServerConnectionLimit;
+  if (limit <= 0) return limit;
+  return std::max(limit / m_loopCount, 1);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -189,6 +284,17 @@ LibEventServer::~LibEventServer() {
 
 int LibEventServer::getAcceptSocket() {
   int ret;
+  if (m_reusePort && m_loopCount > 1) {
+    // the other loops can only bind the port too if this one allows it
+    ret = bind_reuseport_socket(m_address, m_port);
+    if (ret >= 0 && evhttp_accept_socket(m_server, ret) == 0) {
+      m_accept_sock = ret;
+      return 0;
+    }
+    Logger::Warning("Unable to listen on port %d with SO_REUSEPORT: %s",
+                    m_port, Util::safe_strerror(errno).c_str());
+    if (ret >= 0) close(ret);
+  }
   const char *address = m_address.empty() ? nullptr : m_address.c_str();
   ret = evhttp_bind_socket_backlog_fd(m_server, address,
                                       m_port, RuntimeOption::ServerBacklog);
@@ -201,7 +307,28 @@ int LibEventServer::getAcceptSocket() {
 }
 
 int LibEventServer::getLibEventConnectionCount() {
-  return evhttp_get_connection_count(m_server);
+  int count = evhttp_get_connection_count(m_server);
+  for (unsigned int i = 0; i < m_loops.size(); i++) {
+    count += m_loops[i]->getConnectionCount();
+  }
+  return count;
+}
+
+int LibEventServer::getConnectionCount(int loop) {
+  if (loop == 0) return evhttp_get_connection_count(m_server);
+  return m_loops[loop - 1]->getConnectionCount();
+}
+
+void LibEventServer::logLoopStats(const LibEventJob &job) {
+  if (!RuntimeOption::EnableStats || !RuntimeOption::EnableWebStats) return;
+  timespec now;
+  gettime(CLOCK_MONOTONIC, &now);
+  std::string prefix =
+    "evloop." + boost::lexical_cast<std::string>(job.loop) + ".";
+  ServerStats::Log(prefix + "requests", 1);
+  ServerStats::Log(prefix + "queuing",
+                   gettime_diff_us(job.getStartTimer(), now));
+  ServerStats::Log(prefix + "connections", getConnectionCount(job.loop));
 }
 
 void LibEventServer::start() {
@@ -224,30 +351,48 @@ void LibEventServer::start() {
 
   setStatus(RUNNING);
   m_dispatcher.start();
+  startLoops();
   m_dispatcherThread.start();
   m_timeoutThread.start();
 }
 
+void LibEventServer::startLoops() {
+  for (int i = (int)m_loops.size() + 1; i < m_loopCount; i++) {
+    LibEventLoop *loop = new LibEventLoop(this, i);
+    if (!loop->listen(m_address, m_port, m_accept_sock, m_reusePort)) {
+      delete loop;
+      break;
+    }
+    m_loops.push_back(loop);
+    loop->start();
+  }
+  if (m_loopCount > 1) {
+    Logger::Info("Serving port %d from %d event loops", m_port,
+                 (int)m_loops.size() + 1);
+  }
+}
+
+void LibEventServer::stopLoopsAccepting() {
+  for (unsigned int i = 0; i < m_loops.size(); i++) {
+    m_loops[i]->requestStopAccepting();
+  }
+  for (unsigned int i = 0; i < m_loops.size(); i++) {
+    m_loops[i]->waitForStopAccepting();
+  }
+}
+
 void LibEventServer::waitForEnd() {
   m_dispatcherThread.waitForEnd();
+  for (unsigned int i = 0; i < m_loops.size(); i++) {
+    m_loops[i]->waitForEnd();
+  }
 
   m_timeoutThreadData.stop();
   m_timeoutThread.waitForEnd();
 }
 
 void LibEventServer::dispatchWithTimeout(int timeoutSeconds) {
-  struct timeval timeout;
-  timeout.tv_sec = timeoutSeconds;
-  timeout.tv_usec = 0;
-
-  event eventTimeout;
-  event_set(&eventTimeout, -1, 0, on_timer, m_eventBase);
-  event_base_set(m_eventBase, &eventTimeout);
-  event_add(&eventTimeout, &timeout);
-
-  event_base_loop(m_eventBase, EVLOOP_ONCE);
-
-  event_del(&eventTimeout);
+  dispatch_with_timeout(m_eventBase, timeoutSeconds);
 }
 
 void LibEventServer::dispatch() {
@@ -289,6 +434,9 @@ void LibEventServer::stop() {
    */
   if (RuntimeOption::ServerShutdownListenWait > 0 &&
       m_accept_sock != -1 && shutdown(m_accept_sock, SHUT_FBLISTEN) == 0) {
+    for (unsigned int i = 0; i < m_loops.size(); i++) {
+      m_loops[i]->shutdownListen(SHUT_FBLISTEN);
+    }
     int noWorkCount = 0;
     for (int i = 0; i < RuntimeOption::ServerShutdownListenWait; i++) {
       // Give the acceptor thread time to clean out all requests
@@ -318,12 +466,19 @@ void LibEventServer::stop() {
   // stop JobQueue processing
   m_dispatcher.stop();
 
-  // stop event loop
+  // stop event loops; each may spend ServerGracefulShutdownWait flushing,
+  // so tell them all before waiting for any of them
   setStatus(STOPPED);
   if (write(m_pipeStop.getIn(), "", 1) < 0) {
     // an error occured but we're in shutdown already, so ignore
   }
+  for (unsigned int i = 0; i < m_loops.size(); i++) {
+    m_loops[i]->requestStop();
+  }
   m_dispatcherThread.waitForEnd();
+  for (unsigned int i = 0; i < m_loops.size(); i++) {
+    m_loops[i]->waitForStop();
+  }
 
   // wait for the timeout thread to stop
   m_timeoutThreadData.stop();
@@ -380,7 +535,8 @@ void LibEventServer::onThreadExit(RequestHandler *handler) {
     (&ThreadInfo::s_threadInfo->m_reqInjectionData);
 }
 
-void LibEventServer::onRequest(struct evhttp_request *request) {
+void LibEventServer::onRequest(struct evhttp_request *request,
+                               int loop /* = 0 */) {
   if (RuntimeOption::EnableKeepAlive &&
       RuntimeOption::ConnectionTimeoutSeconds > 0) {
     // before processing request, set the connection timeout
@@ -389,13 +545,18 @@ void LibEventServer::onRequest(struct evhttp_request *request) {
                                   RuntimeOption::ConnectionTimeoutSeconds);
   }
   if (getStatus() == RUNNING) {
-    m_dispatcher.enqueue(LibEventJobPtr(new LibEventJob(request)));
+    m_dispatcher.enqueue(LibEventJobPtr(new LibEventJob(request, loop)));
   } else {
     Logger::Error("throwing away one new request while shutting down");
   }
 }
 
-void LibEventServer::onResponse(int worker, evhttp_request *request,
+PendingResponseQueue &LibEventServer::getResponseQueue(int loop) {
+  if (loop == 0) return m_responseQueue;
+  return m_loops[loop - 1]->getResponseQueue();
+}
+
+void LibEventServer::onResponse(int worker, int loop, evhttp_request *request,
                                 int code, LibEventTransport *transport) {
   int nwritten = 0;
   bool skip_sync = false;
@@ -425,24 +586,181 @@ void LibEventServer::onResponse(int worker, evhttp_request *request,
     transport->onFlushBegin(totalSize);
     transport->onFlushProgress(nwritten, delay);
   }
-  m_responseQueue.enqueue(worker, request, code, nwritten);
+  getResponseQueue(loop).enqueue(worker, request, code, nwritten);
 }
 
-void LibEventServer::onChunkedResponse(int worker, evhttp_request *request,
+void LibEventServer::onChunkedResponse(int worker, int loop,
+                                       evhttp_request *request,
                                        int code, evbuffer *chunk,
                                        bool firstChunk) {
-  m_responseQueue.enqueue(worker, request, code, chunk, firstChunk);
+  getResponseQueue(loop).enqueue(worker, request, code, chunk, firstChunk);
 }
 
-void LibEventServer::onChunkedResponseEnd(int worker,
+void LibEventServer::onChunkedResponseEnd(int worker, int loop,
                                           evhttp_request *request) {
-  m_responseQueue.enqueue(worker, request);
+  getResponseQueue(loop).enqueue(worker, request);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// LibEventLoop
+
+LibEventLoop::LibEventLoop(LibEventServer *server, int index)
+  : m_server(server), m_index(index), m_accept_sock(-1), m_ownSock(false),
+    m_stopped(false), m_acceptStopped(false),
+    m_thread(this, &LibEventLoop::run) {
+  m_eventBase = event_base_new();
+  m_evhttp = evhttp_new(m_eventBase);
+  evhttp_set_connection_limit(m_evhttp, server->getLoopConnectionLimit());
+  evhttp_set_gencb(m_evhttp, on_loop_request, this);
+#ifdef EVHTTP_PORTABLE_READ_LIMITING
+  evhttp_set_read_limit(m_evhttp, RuntimeOption::RequestBodyReadLimit);
+#endif
+  m_responseQueue.create(m_eventBase);
+
+  if (!m_pipeControl.open()) {
+    throw FatalErrorException("unable to create pipe for event loop");
+  }
+  event_set(&m_eventControl, m_pipeControl.getOut(), EV_READ|EV_PERSIST,
+            on_loop_control, this);
+  event_base_set(m_eventBase, &m_eventControl);
+  event_add(&m_eventControl, nullptr);
+}
+
+LibEventLoop::~LibEventLoop() {
+  if (m_evhttp) {
+    // never started, or never stopped; either way nothing runs on it now
+    removeAcceptSocket();
+    evhttp_free(m_evhttp);
+  }
+  event_del(&m_eventControl);
+  event_base_free(m_eventBase);
+}
+
+bool LibEventLoop::listen(const std::string &address, int port,
+                          int sharedSock, bool reusePort) {
+  if (reusePort) {
+    int fd = bind_reuseport_socket(address, port);
+    if (fd >= 0 && evhttp_accept_socket(m_evhttp, fd) == 0) {
+      m_accept_sock = fd;
+      m_ownSock = true;
+      return true;
+    }
+    // e.g. an inherited or taken over socket without SO_REUSEPORT
+    Logger::Warning("Event loop %d sharing the accept socket for port %d: "
+                    "%s", m_index, port, Util::safe_strerror(errno).c_str());
+    if (fd >= 0) close(fd);
+  }
+  if (sharedSock < 0 || evhttp_accept_socket(m_evhttp, sharedSock) != 0) {
+    Logger::Error("Event loop %d unable to accept on port %d", m_index, port);
+    return false;
+  }
+  m_accept_sock = sharedSock;
+  m_ownSock = false;
+  return true;
+}
+
+void LibEventLoop::start() {
+  m_thread.start();
+}
+
+void LibEventLoop::waitForEnd() {
+  m_thread.waitForEnd();
+}
+
+void LibEventLoop::requestStop() {
+  if (write(m_pipeControl.getIn(), "s", 1) < 0) {
+    // an error occured but we're in shutdown already, so ignore
+  }
+}
+
+void LibEventLoop::waitForStop() {
+  m_thread.waitForEnd();
+  removeAcceptSocket();
+  evhttp_free(m_evhttp);
+  m_evhttp = nullptr;
+}
+
+void LibEventLoop::requestStopAccepting() {
+  if (write(m_pipeControl.getIn(), "a", 1) < 0) {
+    Logger::Error("Unable to tell event loop %d to stop accepting", m_index);
+  }
+}
+
+static const int kStopAcceptingWaitSeconds = 5;
+
+void LibEventLoop::waitForStopAccepting() {
+  Lock lock(this);
+  for (int i = 0; !m_acceptStopped && !m_stopped; i++) {
+    if (i == kStopAcceptingWaitSeconds) {
+      Logger::Error("Event loop %d didn't stop accepting in %d seconds",
+                    m_index, kStopAcceptingWaitSeconds);
+      return;
+    }
+    wait(1);
+  }
+}
+
+void LibEventLoop::shutdownListen(int how) {
+  if (m_ownSock && m_accept_sock != -1) {
+    shutdown(m_accept_sock, how);
+  }
+}
+
+int LibEventLoop::getConnectionCount() {
+  return m_evhttp ? evhttp_get_connection_count(m_evhttp) : 0;
+}
+
+void LibEventLoop::removeAcceptSocket() {
+  if (m_accept_sock == -1) return;
+  if (evhttp_del_accept_socket(m_evhttp, m_accept_sock) < 0) {
+    Logger::Error("Event loop %d unable to delete accept socket", m_index);
+  }
+  if (m_ownSock) {
+    close(m_accept_sock);
+  }
+  m_accept_sock = -1;
+}
+
+void LibEventLoop::run() {
+  while (!m_stopped) {
+    event_base_loop(m_eventBase, EVLOOP_ONCE);
+  }
+
+  // flushing all responses
+  if (!m_responseQueue.empty()) {
+    m_responseQueue.process();
+  }
+  m_responseQueue.close();
+
+  // flusing all remaining events
+  if (RuntimeOption::ServerGracefulShutdownWait) {
+    dispatch_with_timeout(m_eventBase,
+                          RuntimeOption::ServerGracefulShutdownWait);
+  }
+}
+
+void LibEventLoop::onControl() {
+  char buf[16];
+  int n = read(m_pipeControl.getOut(), buf, sizeof(buf));
+  for (int i = 0; i < n; i++) {
+    if (buf[i] == 'a') {
+      removeAcceptSocket();
+      Lock lock(this);
+      m_acceptStopped = true;
+      notifyAll();
+    } else if (buf[i] == 's') {
+      Lock lock(this);
+      m_stopped = true;
+      notifyAll();
+      event_base_loopbreak(m_eventBase);
+    }
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // PendingResponseQueue
 
-PendingResponseQueue::PendingResponseQueue() {
+PendingResponseQueue::PendingResponseQueue() : m_signaled(false) {
   assert(RuntimeOption::ResponseQueueCount > 0);
   for (int i = 0; i < RuntimeOption::ResponseQueueCount; i++) {
     m_responseQueues.push_back(ResponseQueuePtr(new ResponseQueue()));
@@ -479,8 +797,9 @@ void PendingResponseQueue::enqueue(int worker, ResponsePtr response) {
     q.m_responses.push_back(response);
   }
 
-  // signal to call process()
-  if (write(m_ready.getIn(), &response, 1) < 0) {
+  // signal to call process(), unless it's already coming
+  if (!m_signaled.exchange(true) &&
+      write(m_ready.getIn(), &response, 1) < 0) {
     // an error occured but nothing we can really do
   }
 }
@@ -514,11 +833,13 @@ void PendingResponseQueue::enqueue(int worker, evhttp_request *request) {
 }
 
 void PendingResponseQueue::process() {
-  // clean up the pipe for next signals
+  // clean up the pipe for next signals; anything enqueued from here on
+  // either gets picked up below or signals again
   char buf[512];
   if (read(m_ready.getOut(), buf, sizeof(buf)) < 0) {
     // an error occured but nothing we can really do
   }
+  m_signaled = false;
 
   // making a copy so we don't hold up the mutex very long
   ResponsePtrVec responses;
@@ -23,6 +23,8 @@
 #include <runtime/base/server/job_queue_vm_stack.h>
 #include <util/job_queue.h>
 #include <util/process.h>
+#include <util/synchronizable.h>
+#include <atomic>
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
@@ -34,12 +36,13 @@ namespace HPHP {
 DECLARE_BOOST_TYPES(LibEventJob);
 class LibEventJob {
 public:
-  LibEventJob(evhttp_request *req);
+  LibEventJob(evhttp_request *req, int loop);
 
   const timespec &getStartTimer() const { return start;}
   void stopTimer();
 
   evhttp_request *request;
+  int loop; // the event loop that owns the request's connection
 
 private:
   timespec start;
@@ -110,17 +113,86 @@ private:
     std::deque<ResponsePtr> m_responses;
   };
 
-  // signal between worker thread and response processing thread
+  // signal between worker thread and response processing thread; only the
+  // first response since the last process() writes to the pipe, so a burst
+  // of small keep-alive responses wakes the event loop once
   event m_event;
   CPipe m_ready;
+  std::atomic<bool> m_signaled;
   ResponseQueuePtrVec m_responseQueues;
 
   void enqueue(int worker, ResponsePtr response);
 };
 
+class LibEventServer;
+
+/**
+ * An event loop beyond the server's first one, with its own event_base,
+ * evhttp, response queue and thread. It listens on its own SO_REUSEPORT
+ * socket when it can, so the kernel spreads connections across loops, and
+ * otherwise accepts from the server's socket. Requests go to the server's
+ * shared worker pool; their responses come back to the loop they came from.
+ */
+class LibEventLoop : public Synchronizable {
+public:
+  LibEventLoop(LibEventServer *server, int index);
+  ~LibEventLoop();
+
+  LibEventServer *getServer() const { return m_server;}
+  int getIndex() const { return m_index;}
+  bool listen(const std::string &address, int port, int sharedSock,
+              bool reusePort);
+  void start();
+  void waitForEnd();
+
+  /**
+   * Stopping is split in two so that a server with several loops can tell
+   * them all to stop before it waits for any of them: requestStop() returns
+   * right away, and waitForStop() joins the loop's thread and frees its
+   * evhttp.
+   */
+  void requestStop();
+  void waitForStop();
+
+  /**
+   * Ask the loop to stop accepting, e.g. when the accept socket is handed
+   * over to a new server, and then wait until it has.
+   */
+  void requestStopAccepting();
+  void waitForStopAccepting();
+  void shutdownListen(int how);
+
+  int getConnectionCount();
+  PendingResponseQueue &getResponseQueue() { return m_responseQueue;}
+
+  // loop thread runs these functions
+  void run();
+  void onControl();
+
+private:
+  LibEventServer *m_server;
+  int m_index;
+  event_base *m_eventBase;
+  evhttp *m_evhttp;
+  int m_accept_sock;
+  bool m_ownSock; // or shared with the server
+  bool m_stopped;
+  bool m_acceptStopped; // set, under our lock, once 'a' has been handled
+  PendingResponseQueue m_responseQueue;
+
+  // commands from other threads: 's' to stop, 'a' to stop accepting
+  event m_eventControl;
+  CPipe m_pipeControl;
+
+  AsyncFunc<LibEventLoop> m_thread;
+
+  void removeAcceptSocket();
+};
+
 /**
  * Implementing an evhttp based HTTP server with JobQueueDispatcher. This
- * server will have one dispather thread and multiple worker threads.
+ * server will have one dispather thread and multiple worker threads, plus
+ * an extra thread for each event loop set with setEventLoopCount().
  */
 class LibEventServer : public Server {
 public:
@@ -143,23 +215,33 @@ public:
   }
   int getLibEventConnectionCount();
 
+  /**
+   * Run this many event loops in all (see LibEventLoop). Call before
+   * start(); only plain HTTP is spread across loops, SSL stays on the first.
+   */
+  void setEventLoopCount(int count, bool reusePort);
+  int getEventLoopCount() const { return m_loopCount;}
+  int getLoopConnectionLimit() const;
+  int getConnectionCount(int loop);
+  void logLoopStats(const LibEventJob &job);
+
   void onThreadEnter();
   virtual void onThreadExit(RequestHandler *handler);
 
   /**
    * Request handler called by evhttp library.
    */
-  void onRequest(evhttp_request *request);
+  void onRequest(evhttp_request *request, int loop = 0);
   void onChunkedRead();
 
   /**
    * Called by LibEventTransport when a response is fully prepared.
    */
-  void onResponse(int worker, evhttp_request *request, int code,
+  void onResponse(int worker, int loop, evhttp_request *request, int code,
                   LibEventTransport* transport);
-  void onChunkedResponse(int worker, evhttp_request *request, int code,
-                         evbuffer *chunk, bool firstChunk);
-  void onChunkedResponseEnd(int worker, evhttp_request *request);
+  void onChunkedResponse(int worker, int loop, evhttp_request *request,
+                         int code, evbuffer *chunk, bool firstChunk);
+  void onChunkedResponseEnd(int worker, int loop, evhttp_request *request);
   void onChunkedRequest(evhttp_request *request);
 
   /**
@@ -190,12 +272,22 @@ protected:
   TimeoutThread m_timeoutThreadData;
   AsyncFunc<TimeoutThread> m_timeoutThread;
 
+  // event loops 1..n; loop 0 is m_eventBase on m_dispatcherThread
+  std::vector<LibEventLoop*> m_loops;
+  int m_loopCount;
+  bool m_reusePort;
+
+  void startLoops();
+  void stopLoopsAccepting();
+
 private:
   JobQueueDispatcher<LibEventJobPtr, LibEventWorker> m_dispatcher;
   AsyncFunc<LibEventServer> m_dispatcherThread;
 
   PendingResponseQueue m_responseQueue;
 
+  PendingResponseQueue &getResponseQueue(int loop);
+
   // dispatcher thread runs this function
   void dispatch();
 
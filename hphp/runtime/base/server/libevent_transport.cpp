@@ -31,9 +31,10 @@ struct m_evkeyvalq {
 
 LibEventTransport::LibEventTransport(LibEventServer *server,
                                      evhttp_request *request,
-                                     int workerId)
+                                     int workerId, int loop /* = 0 */)
   : m_server(server), m_request(request), m_eventBasePostData(nullptr),
-    m_workerId(workerId), m_sendStarted(false), m_sendEnded(false) {
+    m_workerId(workerId), m_loop(loop),
+    m_sendStarted(false), m_sendEnded(false) {
   // HttpProtocol::PrepareSystemVariables needs this
   evbuffer *buf = m_request->input_buffer;
   assert(buf);
@@ -74,14 +75,21 @@ LibEventTransport::LibEventTransport(LibEventServer *server,
   m_extended_method = m_request->ext_method;
 
   assert(m_request->input_headers);
-  for (evkeyval *p = ((m_evkeyvalq*)m_request->input_headers)->tqh_first; p;
-       p = p->next.tqe_next) {
+  evkeyval *first = ((m_evkeyvalq*)m_request->input_headers)->tqh_first;
+  int count = 0, bytes = 0;
+  for (evkeyval *p = first; p; p = p->next.tqe_next) {
     if (p->key && p->value) {
-      m_requestHeaders[p->key].push_back(p->value);
-      //key, value, ": " and CR/LF
-      m_requestSize += strlen(p->key) + strlen(p->value) + 4;
+      count++;
+      bytes += strlen(p->key) + strlen(p->value);
     }
   }
+  m_requestHeaders.reserve(count, bytes);
+  for (evkeyval *p = first; p; p = p->next.tqe_next) {
+    if (p->key && p->value) {
+      m_requestHeaders.add(p->key, p->value);
+    }
+  }
+  m_requestSize += bytes + count * 4; //key, value, ": " and CR/LF
 
   m_url = m_request->uri;
   m_requestSize += m_url.size();
@@ -192,17 +200,16 @@ int LibEventTransport::getRequestSize() const {
 std::string LibEventTransport::getHeader(const char *name) {
   assert(name && *name);
 
-  HeaderMap::const_iterator iter = m_requestHeaders.find(name);
-  if (iter != m_requestHeaders.end()) {
-    return iter->second[0];
-  }
-  return "";
+  const char *value = m_requestHeaders.find(name);
+  return value ? value : "";
 }
 
 void LibEventTransport::getHeaders(HeaderMap &headers) {
-  if (&m_requestHeaders != &headers) {
-    headers = m_requestHeaders;
-  }
+  m_requestHeaders.getHeaders(headers);
+}
+
+void LibEventTransport::forEachHeader(HeaderVisitor visitor, void *data) {
+  m_requestHeaders.forEach(visitor, data);
 }
 
 void LibEventTransport::addHeaderImpl(const char *name, const char *value) {
@@ -245,14 +252,14 @@ void LibEventTransport::addRequestHeaderImpl(const char *name,
     Logger::Error("failed to add header '%s: %s'", name, value);
     return;
   }
-  m_requestHeaders[name].push_back(value);
+  m_requestHeaders.add(name, value);
 }
 
 void LibEventTransport::removeRequestHeaderImpl(const char *name) {
   assert(name && *name);
   assert(m_request->input_headers);
   evhttp_remove_header(m_request->input_headers, name);
-  m_requestHeaders.erase(name);
+  m_requestHeaders.remove(name);
 }
 
 bool LibEventTransport::isServerStopping() {
@@ -275,8 +282,8 @@ void LibEventTransport::sendImpl(const void *data, int size, int code,
      * very useful.
      */
     onChunkedProgress(size);
-    m_server->onChunkedResponse(m_workerId, m_request, code, chunk,
-                               !m_sendStarted);
+    m_server->onChunkedResponse(m_workerId, m_loop, m_request, code, chunk,
+                                !m_sendStarted);
   } else {
     if (m_method != HEAD) {
       evbuffer_add(m_request->output_buffer, data, size);
@@ -286,7 +293,7 @@ void LibEventTransport::sendImpl(const void *data, int size, int code,
       snprintf(buf, sizeof(buf), "%d", size);
       addHeaderImpl("Content-Length", buf);
     }
-    m_server->onResponse(m_workerId, m_request, code, this);
+    m_server->onResponse(m_workerId, m_loop, m_request, code, this);
     m_sendEnded = true;
   }
   m_sendStarted = true;
@@ -294,7 +301,7 @@ void LibEventTransport::sendImpl(const void *data, int size, int code,
 
 void LibEventTransport::onSendEndImpl() {
   if (m_chunkedEncoding) {
-    m_server->onChunkedResponseEnd(m_workerId, m_request);
+    m_server->onChunkedResponseEnd(m_workerId, m_loop, m_request);
     m_sendEnded = true;
   } else {
     assert(m_sendEnded); // otherwise, we didn't call send for this request
@@ -18,6 +18,7 @@
 #define __HTTP_SERVER_LIB_EVENT_TRANSPORT_H__
 
 #include <runtime/base/server/transport.h>
+#include <runtime/base/server/header_table.h>
 #include <evhttp.h>
 
 namespace HPHP {
@@ -27,7 +28,7 @@ class LibEventServer;
 class LibEventTransport : public Transport {
 public:
   LibEventTransport(LibEventServer *server, evhttp_request *request,
-                    int workerId);
+                    int workerId, int loop = 0);
 
   /**
    * Implementing Transport...
@@ -43,6 +44,7 @@ public:
   virtual std::string getHTTPVersion() const;
   virtual std::string getHeader(const char *name);
   virtual void getHeaders(HeaderMap &headers);
+  virtual void forEachHeader(HeaderVisitor visitor, void *data);
   virtual void addHeaderImpl(const char *name, const char *value);
   virtual void removeHeaderImpl(const char *name);
   virtual void addRequestHeaderImpl(const char *name, const char *value);
@@ -58,13 +60,14 @@ private:
   struct event_base *m_eventBasePostData;
   struct event m_moreDataRead;
   int m_workerId;
+  int m_loop;
   std::string m_url;
   std::string m_remote_host;
   uint16_t m_remote_port;
   std::string m_http_version;
   Method m_method;
   const char *m_extended_method;
-  HeaderMap m_requestHeaders;
+  HeaderTable m_requestHeaders;
   bool m_sendStarted;
   bool m_sendEnded;
   int m_requestSize;
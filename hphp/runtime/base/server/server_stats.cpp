@@ -1231,12 +1231,15 @@ Array ServerStats::getThreadIOStatuses() {
 
 ServerStatsHelper::ServerStatsHelper(const char *section,
                                      uint32_t track /* = false */)
-  : m_section(section), m_instStart(0), m_track(track) {
+  : m_section(section), m_instStart(0), m_dtlbStart(0), m_track(track) {
   if (RuntimeOption::EnableStats && RuntimeOption::EnableWebStats) {
     gettime(CLOCK_MONOTONIC, &m_wallStart);
     gettime(CLOCK_THREAD_CPUTIME_ID, &m_cpuStart);
     if (m_track & TRACK_HWINST) {
       m_instStart = HardwareCounter::GetInstructionCount();
+      if (RuntimeOption::EvalProfileHWDtlbMisses) {
+        m_dtlbStart = HardwareCounter::GetDtlbMissCount();
+      }
     }
   }
 }
@@ -1259,6 +1262,11 @@ ServerStatsHelper::~ServerStatsHelper() {
     if (m_track & TRACK_HWINST) {
       int64_t instEnd = HardwareCounter::GetInstructionCount();
       logTime("page.inst.", m_instStart, instEnd);
+      if (RuntimeOption::EvalProfileHWDtlbMisses) {
+        // Divide by page.inst for the miss rate.
+        int64_t dtlbEnd = HardwareCounter::GetDtlbMissCount();
+        logTime("page.dtlb.", m_dtlbStart, dtlbEnd);
+      }
     }
   }
 }
@@ -214,6 +214,7 @@ private:
   timespec m_wallStart;
   timespec m_cpuStart;
   int64_t m_instStart;
+  int64_t m_dtlbStart;
   uint32_t m_track;
 
   void logTime(const std::string &prefix, const timespec &start,
@@ -21,6 +21,8 @@
 #include <util/process.h>
 #include <util/util.h>
 #include <util/compression.h>
+#include <util/hash.h>
+#include <sys/stat.h>
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
@@ -28,7 +30,15 @@ namespace HPHP {
 StaticContentCache StaticContentCache::TheCache;
 FileCachePtr StaticContentCache::TheFileCache;
 
-StaticContentCache::StaticContentCache() : m_totalSize(0) {
+StaticContentCache::StaticContentCache()
+  : m_totalSize(0), m_fileCacheMtime(0) {
+}
+
+std::string StaticContentCache::MakeETag(time_t mtime, int64_t id) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "W/\"%lx-%llx\"", (long)mtime,
+           (unsigned long long)id);
+  return buf;
 }
 
 void StaticContentCache::load() {
@@ -44,6 +54,11 @@ void StaticContentCache::load() {
       TheFileCache->load(RuntimeOption::FileCache.c_str(),
                          RuntimeOption::EnableOnDemandUncompress, version);
     }
+    // the cache file is rebuilt whenever anything in it changes
+    struct stat st;
+    if (stat(RuntimeOption::FileCache.c_str(), &st) == 0) {
+      m_fileCacheMtime = st.st_mtime;
+    }
     Logger::Info("loaded file cache from %s",
                  RuntimeOption::FileCache.c_str());
     return;
@@ -92,6 +107,11 @@ void StaticContentCache::load() {
         f->file = sb;
         m_files[url] = f;
 
+        struct stat st;
+        if (stat(out[i].c_str(), &st) == 0) {
+          f->etag = MakeETag(st.st_mtime, sb->size());
+        }
+
         // prepare gzipped content, skipping image and swf files
         if (iter->second.find("image/") != 0 && iter->first != "swf") {
           int len = sb->size();
@@ -135,5 +155,19 @@ bool StaticContentCache::find(const std::string &name, const char *&data,
   return false;
 }
 
+std::string StaticContentCache::getETag(const std::string &name) const {
+  if (TheFileCache) {
+    if (!m_fileCacheMtime) return "";
+    return MakeETag(m_fileCacheMtime,
+                    (uint32_t)hash_string(name.data(), name.size()));
+  }
+
+  StringToResourceFilePtrMap::const_iterator iter = m_files.find(name);
+  if (iter != m_files.end()) {
+    return iter->second->etag;
+  }
+  return "";
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 }
@@ -42,13 +42,29 @@ public:
   bool find(const std::string &name, const char *&data, int &len,
             bool &compressed) const;
 
+  /**
+   * ETag of a file find() can return, made when the cache was loaded, so
+   * a conditional request can be answered without touching the data.
+   * Empty if the file isn't in the cache.
+   */
+  std::string getETag(const std::string &name) const;
+
+  /**
+   * A weak ETag, as the same tag is sent for both the plain and the
+   * gzipped body: when the file was last changed and some number telling
+   * it apart from other files changed at the same time, such as its size.
+   */
+  static std::string MakeETag(time_t mtime, int64_t id);
+
 private:
   int m_totalSize;
+  time_t m_fileCacheMtime;
 
   DECLARE_BOOST_TYPES(ResourceFile);
   struct ResourceFile {
     CstrBufferPtr file;
     CstrBufferPtr compressed;
+    std::string etag;
   };
 
   StringToResourceFilePtrMap m_files;
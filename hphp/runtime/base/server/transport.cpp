@@ -30,8 +30,46 @@
 #include <util/logger.h>
 #include <util/compatibility.h>
 #include <runtime/base/hardware_counter.h>
+#include <runtime/base/server/compression_pool.h>
 
 namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+// registered compressors
+
+namespace {
+struct CompressorInfo {
+  std::string encoding;
+  Transport::CompressorFactory factory;
+};
+}
+
+static Compressor *create_gzip_compressor(int level) {
+  return new StreamCompressor(level, CODING_GZIP, true);
+}
+
+static std::vector<CompressorInfo> &registered_compressors() {
+  static std::vector<CompressorInfo> s_compressors;
+  if (s_compressors.empty()) {
+    CompressorInfo gzip = { "gzip", create_gzip_compressor };
+    s_compressors.push_back(gzip);
+  }
+  return s_compressors;
+}
+
+void Transport::RegisterCompressor(const char *encoding,
+                                   CompressorFactory factory) {
+  assert(encoding && *encoding && factory);
+  std::vector<CompressorInfo> &compressors = registered_compressors();
+  for (unsigned int i = 0; i < compressors.size(); i++) {
+    if (compressors[i].encoding == encoding) {
+      compressors[i].factory = factory;
+      return;
+    }
+  }
+  CompressorInfo info = { encoding, factory };
+  compressors.push_back(info);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 Transport::Transport()
@@ -41,7 +79,8 @@ Transport::Transport()
     m_responseCode(-1), m_firstHeaderSet(false), m_firstHeaderLine(0),
     m_responseSize(0), m_responseTotalSize(0), m_responseSentSize(0),
     m_flushTimeUs(0), m_sendContentType(true),
-    m_compression(true), m_compressor(nullptr), m_isSSL(false),
+    m_compression(true), m_compressor(nullptr), m_compressorIndex(0),
+    m_isSSL(false),
     m_compressionDecision(NotDecidedYet), m_threadType(RequestThread) {
   memset(&m_queueTime, 0, sizeof(m_queueTime));
   memset(&m_wallTime, 0, sizeof(m_wallTime));
@@ -416,6 +455,18 @@ void Transport::removeAllHeaders() {
   m_responseCookies.clear();
 }
 
+void Transport::forEachHeader(HeaderVisitor visitor, void *data) {
+  HeaderMap headers;
+  getHeaders(headers);
+  for (HeaderMap::const_iterator iter = headers.begin();
+       iter != headers.end(); ++iter) {
+    const vector<string> &values = iter->second;
+    for (unsigned int i = 0; i < values.size(); i++) {
+      visitor(iter->first.c_str(), values[i].c_str(), data);
+    }
+  }
+}
+
 void Transport::getResponseHeaders(HeaderMap &headers) {
   headers = m_responseHeaders;
 
@@ -480,17 +531,30 @@ bool Transport::decideCompression() {
     return true;
   }
 
-  if (acceptEncoding("gzip") ||
-      (!RuntimeOption::ForceCompressionCookie.empty() &&
-       cookieExists(RuntimeOption::ForceCompressionCookie.c_str())) ||
-      (!RuntimeOption::ForceCompressionParam.empty() &&
-       paramExists(RuntimeOption::ForceCompressionParam.c_str()))) {
-    m_compressionDecision = ShouldCompress;
-    return true;
+  // the return value is for content that's already gzipped, so it only
+  // depends on gzip, whichever codec we end up compressing with
+  bool gzip = acceptEncoding("gzip") ||
+    (!RuntimeOption::ForceCompressionCookie.empty() &&
+     cookieExists(RuntimeOption::ForceCompressionCookie.c_str())) ||
+    (!RuntimeOption::ForceCompressionParam.empty() &&
+     paramExists(RuntimeOption::ForceCompressionParam.c_str()));
+
+  const std::vector<CompressorInfo> &compressors = registered_compressors();
+  for (int i = compressors.size() - 1; i > 0; i--) {
+    if (acceptEncoding(compressors[i].encoding.c_str())) {
+      m_compressorIndex = i;
+      break;
+    }
   }
 
-  m_compressionDecision = ShouldNotCompress;
-  return false;
+  m_compressionDecision =
+    gzip || m_compressorIndex ? ShouldCompress : ShouldNotCompress;
+  return gzip;
+}
+
+Compressor *Transport::createCompressor() {
+  const CompressorInfo &info = registered_compressors()[m_compressorIndex];
+  return info.factory(RuntimeOption::GzipCompressionLevel);
 }
 
 std::string Transport::getHTTPVersion() const {
@@ -611,7 +675,9 @@ void Transport::prepareHeaders(bool compressed, const void *data, int size) {
   }
 
   if (compressed) {
-    addHeaderImpl("Content-Encoding", "gzip");
+    // anything we didn't stream through m_compressor went out gzipped
+    addHeaderImpl("Content-Encoding",
+                  m_compressor ? m_compressor->encoding() : "gzip");
     removeHeaderImpl("Content-Length");
     if (m_responseHeaders.find("Content-MD5") != m_responseHeaders.end()) {
       String response((const char *)data, size, AttachLiteral);
@@ -681,13 +747,22 @@ String Transport::prepareResponse(const void *data, int size, bool &compressed,
   // where we don't really know if next chunk will benefit from compresseion.
   if (m_chunkedEncoding || size > 1000 ||
       m_compressionDecision == HasToCompress) {
-    if (m_compressor == nullptr) {
-      m_compressor = new StreamCompressor(RuntimeOption::GzipCompressionLevel,
-                                          CODING_GZIP, true);
-    }
     int len = size;
-    char *compressedData =
-      m_compressor->compress((const char*)data, len, last);
+    char *compressedData = nullptr;
+    if (m_compressor == nullptr && m_compressorIndex == 0 &&
+        last && !m_chunkedEncoding) {
+      // the whole response at once; big ones can use the compression pool
+      compressedData = CompressionPool::GzipEncode((const char*)data, len,
+                                                   RuntimeOption::
+                                                   GzipCompressionLevel);
+    }
+    if (compressedData == nullptr) {
+      if (m_compressor == nullptr) {
+        m_compressor = createCompressor();
+      }
+      len = size;
+      compressedData = m_compressor->compress((const char*)data, len, last);
+    }
     if (compressedData) {
       String deleter(compressedData, len, AttachString);
       if (m_chunkedEncoding || len < size ||
@@ -79,6 +79,18 @@ public:
     RpcThread,
   };
 
+  typedef Compressor *(*CompressorFactory)(int level);
+
+  /**
+   * Offer another Content-Encoding to clients that list it in
+   * Accept-Encoding. The factory gets Server.GzipCompressionLevel. Codecs
+   * registered later are preferred, and gzip is always there as the last
+   * resort. Registering an encoding again replaces it. Call at startup,
+   * before any requests come in.
+   */
+  static void RegisterCompressor(const char *encoding,
+                                 CompressorFactory factory);
+
 public:
   Transport();
   virtual ~Transport();
@@ -129,6 +141,15 @@ public:
   virtual std::string getHeader(const char *name) = 0;
   virtual void getHeaders(HeaderMap &headers) = 0;
 
+  /**
+   * Call visitor(name, value, data) for every request header value. The
+   * default builds a HeaderMap with getHeaders(); transports that already
+   * keep their headers in a list override it to walk that instead.
+   */
+  typedef void (*HeaderVisitor)(const char *name, const char *value,
+                                void *data);
+  virtual void forEachHeader(HeaderVisitor visitor, void *data);
+
 
   /**
    * Get/set response headers.
@@ -396,7 +417,8 @@ protected:
   std::string m_mimeType;
   bool m_sendContentType;
   bool m_compression;
-  StreamCompressor *m_compressor;
+  Compressor *m_compressor;
+  int m_compressorIndex; // into the registered compressors; 0 is gzip
 
   bool m_isSSL;
 
@@ -416,6 +438,7 @@ protected:
   static void parseQuery(char *query, ParamMap &params);
   static void urlUnescape(char *value);
   bool splitHeader(CStrRef header, String &name, const char *&value);
+  Compressor *createCompressor();
 
   String prepareResponse(const void *data, int size, bool &compressed,
                          bool last);
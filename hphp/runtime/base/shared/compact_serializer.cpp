@@ -0,0 +1,547 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#include <runtime/base/shared/compact_serializer.h>
+#include <runtime/base/complex_types.h>
+#include <runtime/base/builtin_functions.h>
+#include <runtime/base/array/array_init.h>
+#include <runtime/base/array/array_iterator.h>
+#include <runtime/base/util/string_buffer.h>
+#include <runtime/base/zend/zend_printf.h>
+#include <runtime/vm/instance.h>
+#include <system/lib/systemlib.h>
+
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+static StaticString s___sleep("__sleep");
+
+namespace {
+
+void appendVarint(StringBuffer &buf, uint64_t v) {
+  while (v >= 0x80) {
+    buf.append((char)(v | 0x80));
+    v >>= 7;
+  }
+  buf.append((char)v);
+}
+
+class Encoder {
+public:
+  bool value(CVarRef v);
+  String finish();
+
+private:
+  bool array(ArrayData *arr);
+  bool object(ObjectData *obj);
+  uint32_t name(const StringData *s);
+
+  StringBuffer m_body;
+  // points at the keys of m_nameIds, which don't move
+  std::vector<const std::string*> m_names;
+  std::unordered_map<std::string, uint32_t> m_nameIds;
+  std::unordered_set<ObjectData*> m_seen;
+};
+
+uint32_t Encoder::name(const StringData *s) {
+  auto ins = m_nameIds.insert(
+    std::make_pair(std::string(s->data(), s->size()), m_names.size()));
+  if (ins.second) m_names.push_back(&ins.first->first);
+  return ins.first->second;
+}
+
+bool Encoder::value(CVarRef v) {
+  // Text serialize() only writes a reference when it sees the same one
+  // twice; we don't try to tell.
+  if (v.isReferenced()) return false;
+  switch (v.getType()) {
+  case KindOfUninit:
+  case KindOfNull:
+    m_body.append('N');
+    return true;
+  case KindOfBoolean:
+    m_body.append(v.toBoolean() ? 'T' : 'F');
+    return true;
+  case KindOfInt64: {
+    int64_t n = v.getInt64();
+    m_body.append('I');
+    m_body.append((const char *)&n, sizeof(n));
+    return true;
+  }
+  case KindOfDouble: {
+    double d = v.getDouble();
+    m_body.append('D');
+    m_body.append((const char *)&d, sizeof(d));
+    return true;
+  }
+  case KindOfStaticString:
+  case KindOfString: {
+    StringData *s = v.getStringData();
+    m_body.append('S');
+    appendVarint(m_body, s->size());
+    m_body.append(s->data(), s->size());
+    return true;
+  }
+  case KindOfArray:
+    return array(v.getArrayData());
+  case KindOfObject:
+    return object(v.getObjectData());
+  default:
+    return false;
+  }
+}
+
+bool Encoder::array(ArrayData *arr) {
+  if (arr->isVectorData()) {
+    m_body.append('V');
+    appendVarint(m_body, arr->size());
+    for (ArrayIter it(arr); !it.end(); it.next()) {
+      if (!value(it.secondRef())) return false;
+    }
+    return true;
+  }
+  m_body.append('A');
+  appendVarint(m_body, arr->size());
+  for (ArrayIter it(arr); !it.end(); it.next()) {
+    Variant key(it.first());
+    if (key.isInteger()) {
+      int64_t n = key.toInt64();
+      m_body.append('I');
+      m_body.append((const char *)&n, sizeof(n));
+    } else {
+      m_body.append('K');
+      appendVarint(m_body, name(key.getStringData()));
+    }
+    if (!value(it.secondRef())) return false;
+  }
+  return true;
+}
+
+bool Encoder::object(ObjectData *obj) {
+  if (obj->isResource() || obj->isCollection()) return false;
+  VM::Class *cls = obj->getVMClass();
+  if (cls->instanceCtor() ||
+      obj->instanceof(SystemLib::s_SerializableClass) ||
+      cls->lookupMethod(s___sleep.get())) {
+    return false;
+  }
+  // serialize() keeps a second sighting of an object as a back reference.
+  if (!m_seen.insert(obj).second) return false;
+
+  Array props = obj->o_toArray();
+  m_body.append('O');
+  appendVarint(m_body, name(obj->o_getClassName().get()));
+  appendVarint(m_body, props.size());
+  for (ArrayIter it(props); !it.end(); it.next()) {
+    Variant key(it.first());
+    appendVarint(m_body, name(key.toString().get()));
+    if (!value(it.secondRef())) return false;
+  }
+  return true;
+}
+
+String Encoder::finish() {
+  StringBuffer out(m_body.size() + 16 * m_names.size() + 16);
+  out.append('\0');
+  out.append('C');
+  out.append(CompactSerializer::kVersion);
+  appendVarint(out, m_names.size());
+  for (unsigned i = 0; i < m_names.size(); i++) {
+    appendVarint(out, m_names[i]->size());
+    out.append(*m_names[i]);
+  }
+  out.append(m_body.data(), m_body.size());
+  return out.detach();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+class Reader {
+public:
+  Reader(const char *data, int len) : m_pos(data), m_end(data + len) {
+    if (!CompactSerializer::IsCompact(data, len) ||
+        data[2] != CompactSerializer::kVersion) {
+      corrupt();
+    }
+    m_pos += 3;
+    uint64_t count = varint();
+    // every name takes at least a byte
+    if (count > (uint64_t)(m_end - m_pos)) corrupt();
+    m_names.reserve(count);
+    for (uint64_t i = 0; i < count; i++) {
+      uint64_t len = varint();
+      const char *p = bytes(len);
+      m_names.push_back(std::make_pair(p, (int)len));
+    }
+  }
+
+  static void corrupt() ATTRIBUTE_NORETURN;
+
+  char tag() {
+    if (m_pos >= m_end) corrupt();
+    return *m_pos++;
+  }
+
+  uint64_t varint() {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (m_pos >= m_end) break;
+      unsigned char c = *m_pos++;
+      v |= (uint64_t)(c & 0x7f) << shift;
+      if (!(c & 0x80)) return v;
+    }
+    corrupt();
+  }
+
+  // a count of things that each take at least one more byte
+  uint64_t count() {
+    uint64_t n = varint();
+    if (n > (uint64_t)(m_end - m_pos)) corrupt();
+    return n;
+  }
+
+  template<class T> T fixed() {
+    T v;
+    memcpy(&v, bytes(sizeof(T)), sizeof(T));
+    return v;
+  }
+
+  const char *bytes(uint64_t len) {
+    if (len > (uint64_t)(m_end - m_pos)) corrupt();
+    const char *p = m_pos;
+    m_pos += len;
+    return p;
+  }
+
+  uint32_t nameIndex() {
+    uint64_t i = varint();
+    if (i >= m_names.size()) corrupt();
+    return i;
+  }
+
+  const std::pair<const char*, int> &rawName(uint32_t i) const {
+    return m_names[i];
+  }
+  uint32_t numNames() const { return m_names.size(); }
+
+private:
+  const char *m_pos;
+  const char *m_end;
+  std::vector<std::pair<const char*, int> > m_names;
+};
+
+void Reader::corrupt() {
+  throw Exception("Corrupt compact apc data");
+}
+
+struct MissingClass {};
+
+/*
+ * Everything derived from a name is built the first time it is used and
+ * then shared by every array key and property that uses it.
+ */
+class Decoder {
+public:
+  Decoder(const char *data, int len) : m_in(data, len) {
+    m_names.resize(m_in.numNames());
+  }
+
+  Variant value();
+  // Run the __wakeup()s that value() deferred.
+  void wakeup();
+
+private:
+  struct Name {
+    Name() : built(false), propBuilt(false), mangled(false),
+             protectedProp(false), ctx(nullptr), cls(nullptr) {}
+    bool built;
+    bool propBuilt;
+    bool mangled;
+    bool protectedProp;
+    String str;
+    String prop;     // the name without its mangling
+    String ctxName;  // for a private property, the class declaring it
+    VM::Class *ctx;
+    VM::Class *cls;  // when used as a class name
+  };
+
+  Name &name(uint32_t i);
+  Name &propName(uint32_t i);
+  Object object();
+
+  Reader m_in;
+  std::vector<Name> m_names;
+  // Objects in the order they were finished, which is the order
+  // unserialize() would have woken them up in.
+  std::vector<Object> m_wakeups;
+};
+
+Decoder::Name &Decoder::name(uint32_t i) {
+  Name &n = m_names[i];
+  if (!n.built) {
+    const std::pair<const char*, int> &raw = m_in.rawName(i);
+    n.str = String(raw.first, raw.second, CopyString);
+    n.built = true;
+  }
+  return n;
+}
+
+// Same rules as ObjectData::o_setArray() for mangled names.
+Decoder::Name &Decoder::propName(uint32_t i) {
+  Name &n = name(i);
+  if (!n.propBuilt) {
+    n.propBuilt = true;
+    const char *data = n.str.data();
+    int size = n.str.size();
+    if (size && data[0] == '\0') {
+      int subLen = strnlen(data + 1, size - 1) + 2;
+      if (subLen >= size) Reader::corrupt();
+      n.mangled = true;
+      String cls(data + 1, subLen - 2, CopyString);
+      n.prop = String(data + subLen, size - subLen, CopyString);
+      if (cls == "*") {
+        n.protectedProp = true;
+      } else {
+        // leaves ctx null if there's no such class; the property is dropped
+        n.ctx = VM::Unit::lookupClass(cls.get());
+        n.ctxName = cls;
+      }
+    } else {
+      n.prop = n.str;
+    }
+  }
+  return n;
+}
+
+Variant Decoder::value() {
+  switch (m_in.tag()) {
+  case 'N': return uninit_null();
+  case 'T': return true;
+  case 'F': return false;
+  case 'I': return m_in.fixed<int64_t>();
+  case 'D': return m_in.fixed<double>();
+  case 'S': {
+    uint64_t len = m_in.varint();
+    return String(m_in.bytes(len), len, CopyString);
+  }
+  case 'V': {
+    uint64_t n = m_in.count();
+    ArrayInit ai(n, ArrayInit::vectorInit);
+    for (uint64_t i = 0; i < n; i++) {
+      ai.set(value());
+    }
+    return ai.create();
+  }
+  case 'A': {
+    uint64_t n = m_in.count();
+    ArrayInit ai(n, ArrayInit::mapInit);
+    for (uint64_t i = 0; i < n; i++) {
+      char k = m_in.tag();
+      if (k == 'I') {
+        int64_t key = m_in.fixed<int64_t>();
+        ai.set(key, value(), true);
+      } else if (k == 'K') {
+        CStrRef key = name(m_in.nameIndex()).str;
+        ai.set(key, value(), true);
+      } else {
+        Reader::corrupt();
+      }
+    }
+    return ai.create();
+  }
+  case 'O':
+    return object();
+  default:
+    Reader::corrupt();
+  }
+}
+
+Object Decoder::object() {
+  Name &clsName = name(m_in.nameIndex());
+  if (!clsName.cls) {
+    clsName.cls = VM::Unit::loadClass(clsName.str.get());
+    if (!clsName.cls) throw MissingClass();
+  }
+  Object obj = VM::Instance::newInstance(clsName.cls);
+  uint64_t n = m_in.count();
+  for (uint64_t i = 0; i < n; i++) {
+    Name &prop = propName(m_in.nameIndex());
+    Variant v = value();
+    if (prop.mangled && !prop.protectedProp && !prop.ctx) continue;
+    // As in unserialize(): write the property itself, never via __set().
+    CStrRef context = prop.protectedProp ? clsName.str : prop.ctxName;
+    Variant *t = obj->o_realProp(prop.prop, ObjectData::RealPropCreate,
+                                 context);
+    if (!t) continue;
+    *t = v;
+  }
+  m_wakeups.push_back(obj);
+  return obj;
+}
+
+/*
+ * A MissingClass anywhere in the value sends Unserialize() back through
+ * unserialize(), which wakes every object up itself; so none of them can
+ * be woken up until the whole value has been decoded.
+ */
+void Decoder::wakeup() {
+  for (unsigned i = 0; i < m_wakeups.size(); i++) {
+    m_wakeups[i]->t___wakeup();
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void appendSerializedString(StringBuffer &out, const char *s, int len) {
+  out.append("s:");
+  out.append(len);
+  out.append(":\"");
+  out.append(s, len);
+  out.append("\";");
+}
+
+// Mirrors VariableSerializer::write(double) for Serialize.
+void appendSerializedDouble(StringBuffer &out, double v) {
+  out.append("d:");
+  if (std::isnan(v)) {
+    out.append("NAN");
+  } else if (std::isinf(v)) {
+    if (v < 0) out.append('-');
+    out.append("INF");
+  } else {
+    char *buf;
+    if (v == 0.0) v = 0.0; // so to avoid "-0" output
+    vspprintf(&buf, 0, "%.*H", 14, v);
+    out.append(buf);
+    free(buf);
+  }
+  out.append(';');
+}
+
+void toSerialized(Reader &in, StringBuffer &out) {
+  switch (in.tag()) {
+  case 'N': out.append("N;"); break;
+  case 'T': out.append("b:1;"); break;
+  case 'F': out.append("b:0;"); break;
+  case 'I':
+    out.append("i:");
+    out.append(in.fixed<int64_t>());
+    out.append(';');
+    break;
+  case 'D':
+    appendSerializedDouble(out, in.fixed<double>());
+    break;
+  case 'S': {
+    uint64_t len = in.varint();
+    appendSerializedString(out, in.bytes(len), len);
+    break;
+  }
+  case 'V': {
+    uint64_t n = in.count();
+    out.append("a:");
+    out.append((int64_t)n);
+    out.append(":{");
+    for (uint64_t i = 0; i < n; i++) {
+      out.append("i:");
+      out.append((int64_t)i);
+      out.append(';');
+      toSerialized(in, out);
+    }
+    out.append('}');
+    break;
+  }
+  case 'A': {
+    uint64_t n = in.count();
+    out.append("a:");
+    out.append((int64_t)n);
+    out.append(":{");
+    for (uint64_t i = 0; i < n; i++) {
+      char k = in.tag();
+      if (k == 'I') {
+        out.append("i:");
+        out.append(in.fixed<int64_t>());
+        out.append(';');
+      } else if (k == 'K') {
+        const std::pair<const char*, int> &key = in.rawName(in.nameIndex());
+        appendSerializedString(out, key.first, key.second);
+      } else {
+        Reader::corrupt();
+      }
+      toSerialized(in, out);
+    }
+    out.append('}');
+    break;
+  }
+  case 'O': {
+    const std::pair<const char*, int> &cls = in.rawName(in.nameIndex());
+    uint64_t n = in.count();
+    out.append("O:");
+    out.append(cls.second);
+    out.append(":\"");
+    out.append(cls.first, cls.second);
+    out.append("\":");
+    out.append((int64_t)n);
+    out.append(":{");
+    for (uint64_t i = 0; i < n; i++) {
+      const std::pair<const char*, int> &prop = in.rawName(in.nameIndex());
+      appendSerializedString(out, prop.first, prop.second);
+      toSerialized(in, out);
+    }
+    out.append('}');
+    break;
+  }
+  default:
+    Reader::corrupt();
+  }
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+String CompactSerializer::Serialize(CVarRef value) {
+  Encoder enc;
+  if (!enc.value(value)) return String();
+  return enc.finish();
+}
+
+Variant CompactSerializer::Unserialize(const char *data, int len) {
+  try {
+    Decoder dec(data, len);
+    Variant v = dec.value();
+    dec.wakeup();
+    return v;
+  } catch (MissingClass &e) {
+    // Let unserialize() make an __PHP_Incomplete_Class out of it.
+    StringBuffer buf;
+    ToSerialized(data, len, buf);
+    return unserialize_ex(buf.detach(), VariableUnserializer::Serialize);
+  }
+}
+
+void CompactSerializer::ToSerialized(const char *data, int len,
+                                     StringBuffer &out) {
+  Reader in(data, len);
+  toSerialized(in, out);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}
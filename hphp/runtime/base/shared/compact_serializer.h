@@ -0,0 +1,79 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef __HPHP_COMPACT_SERIALIZER_H__
+#define __HPHP_COMPACT_SERIALIZER_H__
+
+#include <runtime/base/types.h>
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+class StringBuffer;
+
+/**
+ * A binary alternative to apc_serialize() for the objects APC keeps
+ * serialized, which decodes without parsing any text:
+ *
+ *   '\0' 'C' version  varint nameCount  (varint len, bytes)*  value
+ *
+ * Class names, property names and string array keys go in the name table
+ * once each, and values refer to them by index, so an array of records
+ * carries each field name once and the decoder builds each name once.
+ * Everything else is length-prefixed and decoded straight out of the
+ * buffer, so it works just as well on a mapped file.
+ *
+ *   'N' | 'F' | 'T'                     null, false, true
+ *   'I' int64 | 'D' double              8 bytes each, native order
+ *   'S' varint len, bytes               string
+ *   'V' varint n, value*                array with keys 0..n-1
+ *   'A' varint n, (key value)*          other arrays; key is 'I' int64
+ *                                       or 'K' varint name
+ *   'O' varint class, varint n, (varint name, value)*
+ *                                       object; names are mangled as in
+ *                                       serialize()
+ *
+ * Only values serialize() would write without any of its special cases
+ * can be encoded: user classes without __sleep or Serializable, no
+ * resources, collections or builtin objects, no object seen twice, and no
+ * PHP references. Serialize() returns a null String for anything else,
+ * and the caller keeps the text format.
+ *
+ * Text serialize() data never starts with '\0', so the two formats can
+ * share storage and IsCompact() tells them apart.
+ */
+class CompactSerializer {
+public:
+  static const char kVersion = 1;
+
+  static bool IsCompact(const char *data, int len) {
+    return len >= 3 && data[0] == '\0' && data[1] == 'C';
+  }
+
+  static String Serialize(CVarRef value);
+  static Variant Unserialize(const char *data, int len);
+
+  /**
+   * Convert to serialize() text without loading any classes, for writing
+   * out (apc snapshots) and for objects whose class is missing.
+   */
+  static void ToSerialized(const char *data, int len, StringBuffer &out);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif // __HPHP_COMPACT_SERIALIZER_H__
@@ -15,6 +15,7 @@
 */
 
 #include <runtime/base/shared/concurrent_shared_store.h>
+#include <runtime/base/shared/shared_store_snapshot.h>
 #include <runtime/base/variable_serializer.h>
 #include <runtime/ext/ext_apc.h>
 #include <util/logger.h>
@@ -98,6 +99,220 @@ static void stats_on_add(const StringData* key, const StoreValue* sval,
   }
 }
 
+static string std_apc_miss = "apc.miss";
+static string std_apc_hit = "apc.hit";
+static string std_apc_cas = "apc.cas";
+static string std_apc_update = "apc.update";
+static string std_apc_new = "apc.new";
+static string std_apc_evict = "apc.evict";
+
+///////////////////////////////////////////////////////////////////////////////
+// memory accounting and eviction
+
+static bool track_memory() {
+  return RuntimeOption::ApcMemoryLimit > 0 ||
+    RuntimeOption::EnableAPCSizeStats;
+}
+
+// Recompute what sval costs after its value changed; call with sval locked
+void ConcurrentTableSharedStore::setCharge(const char* key,
+                                          const StoreValue* sval) {
+  if (!track_memory()) return;
+  int32_t charge = sval->inMem() ?
+    strlen(key) + 1 + sval->var->getSpaceUsage() : 0;
+  int32_t delta = charge - sval->charge;
+  if (!delta) return;
+  int count = (charge != 0) - (sval->charge != 0);
+  sval->charge = charge;
+  m_memUsed.fetch_add(delta, std::memory_order_relaxed);
+  if (RuntimeOption::EnableAPCSizeStats) {
+    SharedStoreStats::onCharge(key, delta, count);
+  }
+}
+
+void ConcurrentTableSharedStore::clearCharge(const char* key,
+                                            const StoreValue* sval) {
+  if (!sval->charge) return;
+  m_memUsed.fetch_sub(sval->charge, std::memory_order_relaxed);
+  if (RuntimeOption::EnableAPCSizeStats) {
+    SharedStoreStats::onCharge(key, -sval->charge, -1);
+  }
+  sval->charge = 0;
+}
+
+// Call with sval locked, for a key that isn't on the queue yet: a new one,
+// a primed one being overwritten, or an adopted one as it is first
+// unserialized or overwritten
+void ConcurrentTableSharedStore::addToEvictionQueue(const char* key,
+                                                   const StoreValue* sval) {
+  if (RuntimeOption::ApcMemoryLimit <= 0) return;
+  sval->evictId = ++m_evictSeq;
+  sval->ctime = sval->atime = time(nullptr);
+  sval->hits.store(0, std::memory_order_relaxed);
+  EvictionCandidate c = { strdup(key), sval->evictId };
+  m_evictQueue.push(c);
+}
+
+/*
+ * Lower scores are evicted first. Returns false if the candidate is stale:
+ * the key is gone, or was deleted and stored again since it was queued.
+ * Call with m_lock held for read, as for evict().
+ */
+bool ConcurrentTableSharedStore::scoreCandidate(const EvictionCandidate& c,
+                                                time_t now, double& score,
+                                                bool& eligible) {
+  Map::const_accessor acc;
+  if (!m_vars.find(acc, c.key)) return false;
+  const StoreValue& sval = acc->second;
+  if (sval.evictId != c.id || !sval.inMem()) return false;
+  time_t age = now - sval.ctime;
+  eligible = age >= RuntimeOption::ApcKeyMaturityThreshold;
+  if (sval.expired()) {
+    score = -1;
+    eligible = true;
+  } else if (RuntimeOption::ApcEvictionPolicy ==
+             RuntimeOption::ApcEvictLFU) {
+    // Same measure as LFUTable: hits over lifetime.
+    score = (double)sval.hits.load(std::memory_order_relaxed) /
+      (age > 0 ? age : 1);
+  } else {
+    // atime only has a resolution of seconds, so also give keys that were
+    // fetched since we last sampled them a second chance, as in CLOCK.
+    score = sval.atime;
+    eligible = sval.hits.exchange(0, std::memory_order_relaxed) == 0;
+  }
+  return true;
+}
+
+static bool evict_queue_bloated(size_t queued, size_t live) {
+  return queued > 1024 && queued > 2 * live;
+}
+
+/*
+ * Deleting keys leaves their candidates on m_evictQueue, and evict() only
+ * drops them as it comes across them, which it never does while we're
+ * under the limit.  Once most of the queue is stale, go around it once and
+ * free those.  Each pass is paid for by the stale entries it frees.  Call
+ * with m_lock held for read, as for evict().
+ */
+void ConcurrentTableSharedStore::pruneEvictionQueue() {
+  if (RuntimeOption::ApcMemoryLimit <= 0) return;
+  if (!evict_queue_bloated(m_evictQueue.unsafe_size(), m_vars.size())) {
+    return;
+  }
+  bool expected = false;
+  if (!m_evicting.compare_exchange_strong(expected, true)) return;
+  int64_t budget = m_evictQueue.unsafe_size();
+  EvictionCandidate c;
+  while (budget-- > 0 && m_evictQueue.try_pop(c)) {
+    bool live;
+    {
+      Map::const_accessor acc;
+      live = m_vars.find(acc, c.key) && acc->second.evictId == c.id &&
+        acc->second.inMem();
+    }
+    if (live) {
+      m_evictQueue.push(c);
+    } else {
+      free((void *)c.key);
+    }
+  }
+  m_evicting.store(false);
+}
+
+// Call with m_lock held for read, as for evict().
+bool ConcurrentTableSharedStore::evictCandidate(const EvictionCandidate& c) {
+  Map::accessor acc;
+  if (!m_vars.find(acc, c.key)) return false;
+  StoreValue* sval = &acc->second;
+  if (sval->evictId != c.id || !sval->inMem()) return false;
+  if (RuntimeOption::EnableAPCSizeStats) {
+    StackStringData sd(c.key);
+    SharedStoreStats::removeDirect(sd.size(), sval->size, false, true);
+    if (RuntimeOption::EnableAPCSizeGroup ||
+        RuntimeOption::EnableAPCSizeDetail) {
+      SharedStoreStats::onDelete(&sd, sval->var, false, sval->expiry == 0);
+    }
+  }
+  SharedStoreStats::onEvict(c.key, sval->charge);
+  clearCharge(c.key, sval);
+  sval->var->decRef();
+  eraseAcc(acc);
+  return true;
+}
+
+// Call with m_lock held for read: sampling and evicting look keys up in
+// m_vars, which clear() may be tearing down under its write lock.  We
+// don't take it here, since a second read lock could queue behind a
+// waiting writer.
+void ConcurrentTableSharedStore::evict() {
+  if (!track_memory()) return;
+  int64_t used = m_memUsed.load(std::memory_order_relaxed);
+  SharedStoreStats::setMemoryUsed(used);
+  int64_t limit = RuntimeOption::ApcMemoryLimit;
+  if (limit <= 0 || used <= limit) return;
+  // One thread evicts at a time; the others go on with their stores.
+  bool expected = false;
+  if (!m_evicting.compare_exchange_strong(expected, true)) return;
+
+  // Evict down to a low water mark so that we don't come back here on
+  // every store, but don't go around the queue more than once.
+  int64_t target = limit - limit / 20;
+  time_t now = time(nullptr);
+  int64_t budget = m_evictQueue.unsafe_size();
+  std::vector<EvictionCandidate> sample;
+  while (budget > 0 &&
+         m_memUsed.load(std::memory_order_relaxed) > target) {
+    sample.clear();
+    int victim = -1;
+    double victimScore = 0;
+    bool victimEligible = false;
+    while ((int)sample.size() < RuntimeOption::ApcEvictionSamples &&
+           budget > 0) {
+      EvictionCandidate c;
+      if (!m_evictQueue.try_pop(c)) {
+        budget = 0;
+        break;
+      }
+      --budget;
+      double score;
+      bool eligible;
+      if (!scoreCandidate(c, now, score, eligible)) {
+        free((void *)c.key);
+        continue;
+      }
+      // Prefer keys the policy doesn't protect; then the lowest score.
+      if (victim < 0 || (eligible && !victimEligible) ||
+          (eligible == victimEligible && score < victimScore)) {
+        victim = sample.size();
+        victimScore = score;
+        victimEligible = eligible;
+      }
+      sample.push_back(c);
+    }
+    for (int i = 0; i < (int)sample.size(); i++) {
+      if (i == victim) continue;
+      m_evictQueue.push(sample[i]);
+    }
+    if (victim < 0) continue;
+    if (evictCandidate(sample[victim])) {
+      log_apc(std_apc_evict);
+    }
+    free((void *)sample[victim].key);
+  }
+  SharedStoreStats::setMemoryUsed(m_memUsed.load(std::memory_order_relaxed));
+  m_evicting.store(false);
+}
+
+ConcurrentTableSharedStore::~ConcurrentTableSharedStore() {
+  EvictionCandidate c;
+  while (m_evictQueue.try_pop(c)) {
+    free((void *)c.key);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 bool ConcurrentTableSharedStore::clear() {
   if (RuntimeOption::ApcConcurrentTableLockFree) {
     return false;
@@ -105,6 +320,7 @@ bool ConcurrentTableSharedStore::clear() {
   WriteLock l(m_lock);
   for (Map::iterator iter = m_vars.begin(); iter != m_vars.end();
        ++iter) {
+    clearCharge(iter->first, &iter->second);
     if (iter->second.inMem()) {
       iter->second.var->decRef();
     }
@@ -130,14 +346,15 @@ bool ConcurrentTableSharedStore::eraseImpl(CStrRef key, bool expired) {
     if (expired && !acc->second.expired()) {
       return false;
     }
+    clearCharge(acc->first, &acc->second);
     if (acc->second.inMem()) {
       stats_on_delete(key.get(), &acc->second, expired);
       acc->second.var->decRef();
     } else {
       assert(acc->second.inFile());
-      assert(acc->second.expiry == 0);
+      assert(acc->second.expiry == 0 || acc->second.adopted);
     }
-    if (expired && acc->second.inFile()) {
+    if (expired && acc->second.inFile() && !acc->second.adopted) {
       // a primed key expired, do not erase the table entry
       acc->second.var = nullptr;
       acc->second.size = 0;
@@ -227,6 +444,7 @@ bool ConcurrentTableSharedStore::handlePromoteObj(CStrRef key,
       int64_t ttl = sval->expiry ? sval->expiry - time(nullptr) : 0;
       stats_on_update(key.get(), sval, converted, ttl);
       sval->var = converted;
+      setCharge(acc->first, sval);
       sv->decRef();
       return true;
     }
@@ -235,12 +453,6 @@ bool ConcurrentTableSharedStore::handlePromoteObj(CStrRef key,
   return false;
 }
 
-static string std_apc_miss = "apc.miss";
-static string std_apc_hit = "apc.hit";
-static string std_apc_cas = "apc.cas";
-static string std_apc_update = "apc.update";
-static string std_apc_new = "apc.new";
-
 SharedVariant* ConcurrentTableSharedStore::unserialize(CStrRef key,
                                                        const StoreValue* sval) {
   try {
@@ -254,6 +466,10 @@ SharedVariant* ConcurrentTableSharedStore::unserialize(CStrRef key,
     v.unserialize(&vu);
     sval->var = SharedVariant::Create(v, sval->isSerializedObj());
     stats_on_add(key.get(), sval, 0, true, true); // delayed prime
+    setCharge(key.data(), sval);
+    if (sval->adopted && !sval->evictId) {
+      addToEvictionQueue(key.data(), sval);
+    }
     return sval->var;
   } catch (Exception &e) {
     raise_notice("APC Primed fetch failed: key %s (%s).",
@@ -301,6 +517,19 @@ bool ConcurrentTableSharedStore::get(CStrRef key, Variant &value) {
         }
         value = svar->toLocal();
         stats_on_get(key.get(), svar);
+        if (sval->evictId) {
+          // Avoid dirtying the line of a hot key more than we have to:
+          // LRU only needs to know that there was a hit since the key was
+          // last sampled, so only LFU pays for the atomic increment.
+          uint32_t now = time(nullptr);
+          if (sval->atime != now) sval->atime = now;
+          if (RuntimeOption::ApcEvictionPolicy ==
+              RuntimeOption::ApcEvictLFU) {
+            sval->hits.fetch_add(1, std::memory_order_relaxed);
+          } else if (!sval->hits.load(std::memory_order_relaxed)) {
+            sval->hits.store(1, std::memory_order_relaxed);
+          }
+        }
       }
     }
   }
@@ -344,8 +573,9 @@ int64_t ConcurrentTableSharedStore::inc(CStrRef key, int64_t step, bool &found)
       if (!sval->expired()) {
         ret = get_int64_value(sval) + step;
         SharedVariant *svar = construct(Variant(ret));
-        sval->var->decRef();
+        if (sval->var) sval->var->decRef();
         sval->var = svar;
+        setCharge(acc->first, sval);
         found = true;
         log_apc(std_apc_hit);
       }
@@ -365,8 +595,9 @@ bool ConcurrentTableSharedStore::cas(CStrRef key, int64_t old, int64_t val) {
       sval = &acc->second;
       if (!sval->expired() && get_int64_value(sval) == old) {
         SharedVariant *var = construct(Variant(val));
-        sval->var->decRef();
+        if (sval->var) sval->var->decRef();
         sval->var = var;
+        setCharge(acc->first, sval);
         success = true;
         log_apc(std_apc_cas);
       }
@@ -437,6 +668,12 @@ bool ConcurrentTableSharedStore::store(CStrRef key, CVarRef value, int64_t ttl,
       if (overwrite || sval->expired()) {
         // if ApcTTLLimit is set, then only primed keys can have expiry == 0
         overwritePrime = (sval->expiry == 0);
+        if (sval->adopted) {
+          // unlike primed keys, don't fall back to the old value later
+          sval->sAddr = nullptr;
+          sval->sSize = 0;
+          sval->adopted = false;
+        }
         if (sval->inMem()) {
           stats_on_update(key.get(), sval, svar,
                           adjust_ttl(ttl, overwritePrime));
@@ -461,6 +698,12 @@ bool ConcurrentTableSharedStore::store(CStrRef key, CVarRef value, int64_t ttl,
     if (!update) {
       stats_on_add(key.get(), sval, adjustedTtl, false, false);
     }
+    setCharge(acc->first, sval);
+    // primed and adopted keys aren't queued until they're first stored
+    // (or, for adopted ones, fetched)
+    if (!present || !sval->evictId) {
+      addToEvictionQueue(acc->first, sval);
+    }
   }
   if (expiry) {
     addToExpirationQueue(key.data(), expiry);
@@ -468,6 +711,9 @@ bool ConcurrentTableSharedStore::store(CStrRef key, CVarRef value, int64_t ttl,
   if (RuntimeOption::ApcExpireOnSets) {
     purgeExpired();
   }
+  // Still under l.
+  evict();
+  pruneEvictionQueue();
   if (present) {
     log_apc(std_apc_update);
   } else {
@@ -492,6 +738,7 @@ void ConcurrentTableSharedStore::prime
     m_vars.insert(acc, copy);
     if (item.inMem()) {
       acc->second.set(item.value, 0);
+      setCharge(acc->first, &acc->second);
     } else {
       acc->second.sAddr = item.sAddr;
       acc->second.sSize = item.sSize;
@@ -563,8 +810,81 @@ void ConcurrentTableSharedStore::primeDone() {
     const char *copy = strdup(iter->c_str());
     if (m_vars.insert(acc, copy)) {
       acc->second.set(this->construct(1), 0);
+      setCharge(acc->first, &acc->second);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// snapshots
+
+int ConcurrentTableSharedStore::writeSnapshot(SharedStoreSnapshot& snapshot) {
+  // Like dump(), this holds up everything else, but it is only meant to run
+  // once the server has stopped taking requests.
+  WriteLock l(m_lock);
+  int count = 0, skipped = 0;
+  for (Map::iterator iter = m_vars.begin(); iter != m_vars.end(); ++iter) {
+    const StoreValue *sval = &iter->second;
+    if (sval->expired()) continue;
+    String value;
+    bool serializedObj = false;
+    if (sval->inMem()) {
+      if (!apc_portable_serialize(sval->var, value, serializedObj)) {
+        ++skipped;
+        continue;
+      }
+    } else if (sval->inFile()) {
+      try {
+        value = apc_portable_reserialize(
+          String(sval->sAddr, sval->getSerializedSize(), AttachLiteral));
+      } catch (Exception &e) {
+        ++skipped;
+        continue;
+      }
+      serializedObj = sval->isSerializedObj();
+    } else {
+      continue;
+    }
+    snapshot.add(iter->first, strlen(iter->first), value.data(),
+                 value.size(), serializedObj, sval->expiry);
+    ++count;
+  }
+  if (skipped) {
+    Logger::Warning("apc snapshot: skipped %d keys we can't write out",
+                    skipped);
+  }
+  return count;
+}
+
+int ConcurrentTableSharedStore::adoptSnapshot(SharedStoreSnapshot& snapshot) {
+  ConditionalReadLock l(m_lock, !RuntimeOption::ApcConcurrentTableLockFree ||
+                                m_lockingFlag);
+  time_t now = time(nullptr);
+  int count = 0;
+  SharedStoreSnapshot::Entry entry;
+  while (snapshot.next(entry)) {
+    if (entry.expiry && entry.expiry <= now) continue;
+    {
+      Map::accessor acc;
+      const char *copy = strdup(entry.key);
+      if (!m_vars.insert(acc, copy)) {
+        // stored since we started, so newer than the snapshot
+        free((void *)copy);
+        continue;
+      }
+      // Unserialized on first fetch, like keys in primed file storage.
+      StoreValue *sval = &acc->second;
+      sval->sAddr = entry.sAddr;
+      sval->sSize = entry.sSize;
+      sval->expiry = entry.expiry;
+      sval->adopted = true;
+    }
+    if (entry.expiry) {
+      addToExpirationQueue(entry.key, entry.expiry);
     }
+    ++count;
   }
+  return count;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -28,6 +28,7 @@
 #include <runtime/base/server/server_stats.h>
 #include <tbb/concurrent_hash_map.h>
 #include <tbb/concurrent_priority_queue.h>
+#include <tbb/concurrent_queue.h>
 #include <runtime/base/shared/shared_store_stats.h>
 
 namespace HPHP {
@@ -39,7 +40,9 @@ namespace HPHP {
 class ConcurrentTableSharedStore : public SharedStore {
 public:
   ConcurrentTableSharedStore(int id)
-    : SharedStore(id), m_lockingFlag(false), m_purgeCounter(0) {}
+    : SharedStore(id), m_lockingFlag(false), m_purgeCounter(0),
+      m_memUsed(0), m_evictSeq(0), m_evicting(false) {}
+  ~ConcurrentTableSharedStore();
 
   virtual int size() {
     return m_vars.size();
@@ -57,6 +60,9 @@ public:
   virtual bool constructPrime(CVarRef v, KeyValuePair& item);
   virtual void primeDone();
 
+  virtual int writeSnapshot(SharedStoreSnapshot& snapshot);
+  virtual int adoptSnapshot(SharedStoreSnapshot& snapshot);
+
   // debug support
   virtual void dump(std::ostream & out, bool keyOnly, int waitSeconds);
 
@@ -116,6 +122,36 @@ protected:
 
   void addToExpirationQueue(const char* key, int64_t etime);
 
+  /*
+   * Memory accounting and eviction for APC.MemoryLimit. Every key that is
+   * stored (not primed) goes on m_evictQueue in insertion order, tagged
+   * with its StoreValue's evictId so that entries for keys which have
+   * since been deleted, or deleted and stored again, can be told apart and
+   * dropped. To evict, we pop a few candidates off the front, evict the
+   * worst of them by the configured policy and push the rest back on the
+   * tail, which gives keys that are still in use a second chance.
+   * pruneEvictionQueue() keeps stale entries from piling up while we're
+   * under the limit and nothing is being evicted.
+   */
+  struct EvictionCandidate {
+    const char* key;
+    uint64_t id;
+  };
+
+  std::atomic<int64_t> m_memUsed;
+  std::atomic<uint64_t> m_evictSeq;
+  std::atomic<bool> m_evicting;
+  tbb::concurrent_queue<EvictionCandidate> m_evictQueue;
+
+  void setCharge(const char* key, const StoreValue* sval);
+  void clearCharge(const char* key, const StoreValue* sval);
+  void addToEvictionQueue(const char* key, const StoreValue* sval);
+  bool scoreCandidate(const EvictionCandidate& c, time_t now,
+                      double& score, bool& eligible);
+  bool evictCandidate(const EvictionCandidate& c);
+  void evict();
+  void pruneEvictionQueue();
+
   bool handleUpdate(CStrRef key, SharedVariant* svar);
   bool handlePromoteObj(CStrRef key, SharedVariant* svar, CVarRef valye);
 private:
@@ -0,0 +1,499 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#include <runtime/base/shared/sharded_shared_store.h>
+#include <runtime/base/runtime_option.h>
+#include <runtime/base/variable_serializer.h>
+#include <runtime/base/server/server_stats.h>
+#include <runtime/vm/treadmill.h>
+#include <util/alloc.h>
+#include <util/hash.h>
+#include <util/logger.h>
+#include <util/util.h>
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+typedef ShardedTableSharedStore::Entry Entry;
+typedef ShardedTableSharedStore::Table Table;
+
+static const uint32_t kMinCapacity = 64;
+
+// Marks a slot whose entry was erased, so probes keep going past it.
+static Entry s_tombstone;
+static Entry* const kTombstone = &s_tombstone;
+
+// helpers
+
+static void log_apc(const string& name) {
+  if (RuntimeOption::EnableStats && RuntimeOption::EnableAPCStats) {
+    ServerStats::Log(name, 1);
+  }
+}
+
+static bool check_noTTL(const char *key) {
+  const std::vector<std::string>& list = RuntimeOption::ApcNoTTLPrefix;
+  for (unsigned int i = 0; i < list.size(); ++i) {
+    if (memcmp(key, list[i].c_str(), list[i].size()) == 0) return true;
+  }
+  return false;
+}
+
+static int64_t expiry_for(const char* key, int64_t ttl, bool overwritePrime) {
+  if (RuntimeOption::ApcTTLLimit > 0 && !overwritePrime) {
+    if (ttl == 0 || ttl > RuntimeOption::ApcTTLLimit) {
+      ttl = RuntimeOption::ApcTTLLimit;
+    }
+  }
+  if (check_noTTL(key)) ttl = 0;
+  return ttl ? time(nullptr) + ttl : 0;
+}
+
+static Table* new_table(uint32_t capacity) {
+  assert(Util::isPowerOfTwo(capacity));
+  Table* t = (Table*)Util::safe_calloc(
+    1, sizeof(Table) + (capacity - 1) * sizeof(t->slots[0]));
+  t->mask = capacity - 1;
+  return t;
+}
+
+static Entry* new_entry(const char* key, int len, strhash_t hash,
+                        SharedVariant* var, int64_t expiry) {
+  Entry* e = (Entry*)Util::safe_malloc(offsetof(Entry, key) + len + 1);
+  e->hash = hash;
+  e->len = len;
+  e->var = var;
+  e->expiry = expiry;
+  memcpy(e->key, key, len);
+  e->key[len] = '\0';
+  return e;
+}
+
+static bool matches(const Entry* e, const char* key, int len,
+                    strhash_t hash) {
+  return e->hash == hash && e->len == len && !memcmp(e->key, key, len);
+}
+
+/*
+ * Readers may still be looking at an entry we've unlinked, so its
+ * reference on the SharedVariant is dropped by the Treadmill.
+ */
+class RetireEntry : public VM::Treadmill::WorkItem {
+public:
+  explicit RetireEntry(Entry* e) : m_entry(e) {}
+  virtual void operator()() {
+    m_entry->var->decRef();
+    free(m_entry);
+  }
+private:
+  Entry* m_entry;
+};
+
+static void retire(Entry* e) {
+  VM::Treadmill::WorkItem::enqueue(new RetireEntry(e));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ShardedTableSharedStore::Shard::Shard()
+  : table(new_table(kMinCapacity)), used(0), live(0) {
+}
+
+void* ShardedTableSharedStore::operator new(size_t sz) {
+  void* p;
+  if (posix_memalign(&p, kCacheLine, sz) != 0) throw std::bad_alloc();
+  return p;
+}
+
+ShardedTableSharedStore::ShardedTableSharedStore(int id)
+  : SharedStore(id), m_purgeCounter(0) {
+}
+
+ShardedTableSharedStore::~ShardedTableSharedStore() {
+  // Nothing can be reading by now, so don't bother with the Treadmill.
+  for (int i = 0; i < kNumShards; i++) {
+    Table* t = m_shards[i].table.load(std::memory_order_relaxed);
+    for (uint32_t j = 0; j <= t->mask; j++) {
+      Entry* e = t->slots[j].load(std::memory_order_relaxed);
+      if (e && e != kTombstone) {
+        e->var->decRef();
+        free(e);
+      }
+    }
+    free(t);
+  }
+}
+
+const Entry* ShardedTableSharedStore::find(const Shard& shard,
+                                           const char* key, int len,
+                                           strhash_t hash) {
+  const Table* t = shard.table.load(std::memory_order_acquire);
+  for (uint32_t i = hash & t->mask, n = 0; n <= t->mask;
+       i = (i + 1) & t->mask, n++) {
+    const Entry* e = t->slots[i].load(std::memory_order_acquire);
+    if (!e) break;
+    if (e != kTombstone && matches(e, key, len, hash)) return e;
+  }
+  return nullptr;
+}
+
+std::atomic<Entry*>* ShardedTableSharedStore::findSlot(Shard& shard,
+                                                       const char* key,
+                                                       int len,
+                                                       strhash_t hash) {
+  Table* t = shard.table.load(std::memory_order_relaxed);
+  for (uint32_t i = hash & t->mask, n = 0; n <= t->mask;
+       i = (i + 1) & t->mask, n++) {
+    Entry* e = t->slots[i].load(std::memory_order_relaxed);
+    if (!e) break;
+    if (e != kTombstone && matches(e, key, len, hash)) return &t->slots[i];
+  }
+  return nullptr;
+}
+
+/*
+ * Point key at a new entry for var, replacing (and retiring) any entry
+ * it had.  Takes over the caller's reference to var.
+ */
+void ShardedTableSharedStore::publish(Shard& shard, const char* key, int len,
+                                      strhash_t hash, SharedVariant* var,
+                                      int64_t expiry) {
+  Entry* e = new_entry(key, len, hash, var, expiry);
+  Table* t = shard.table.load(std::memory_order_relaxed);
+  std::atomic<Entry*>* target = nullptr;
+  bool targetEmpty = false;
+  for (uint32_t i = hash & t->mask, n = 0; n <= t->mask;
+       i = (i + 1) & t->mask, n++) {
+    Entry* old = t->slots[i].load(std::memory_order_relaxed);
+    if (!old) {
+      if (!target) {
+        target = &t->slots[i];
+        targetEmpty = true;
+      }
+      break;
+    }
+    if (old == kTombstone) {
+      if (!target) target = &t->slots[i];
+      continue;
+    }
+    if (matches(old, key, len, hash)) {
+      t->slots[i].store(e, std::memory_order_release);
+      retire(old);
+      return;
+    }
+  }
+  assert(target);
+  target->store(e, std::memory_order_release);
+  shard.live++;
+  if (targetEmpty && ++shard.used * 4 > (t->mask + 1) * 3) {
+    grow(shard);
+  }
+}
+
+void ShardedTableSharedStore::unpublish(Shard& shard,
+                                        std::atomic<Entry*>* slot) {
+  Entry* old = slot->load(std::memory_order_relaxed);
+  assert(old && old != kTombstone);
+  slot->store(kTombstone, std::memory_order_release);
+  shard.live--;
+  retire(old);
+}
+
+/*
+ * Rehash into a table with room for the live entries to double.  If it
+ * was mostly tombstones, that may be no bigger than the one we had.
+ */
+void ShardedTableSharedStore::grow(Shard& shard) {
+  Table* old = shard.table.load(std::memory_order_relaxed);
+  uint32_t capacity = kMinCapacity;
+  while (capacity < shard.live * 4) capacity *= 2;
+  Table* t = new_table(capacity);
+  for (uint32_t j = 0; j <= old->mask; j++) {
+    Entry* e = old->slots[j].load(std::memory_order_relaxed);
+    if (!e || e == kTombstone) continue;
+    uint32_t i = e->hash & t->mask;
+    while (t->slots[i].load(std::memory_order_relaxed)) i = (i + 1) & t->mask;
+    t->slots[i].store(e, std::memory_order_relaxed);
+  }
+  shard.table.store(t, std::memory_order_release);
+  shard.used = shard.live;
+  VM::Treadmill::deferredFree(old);
+}
+
+int ShardedTableSharedStore::size() {
+  int total = 0;
+  for (int i = 0; i < kNumShards; i++) total += m_shards[i].live;
+  return total;
+}
+
+bool ShardedTableSharedStore::clear() {
+  for (int i = 0; i < kNumShards; i++) {
+    Shard& shard = m_shards[i];
+    SimpleLock lock(shard.lock);
+    Table* old = shard.table.load(std::memory_order_relaxed);
+    for (uint32_t j = 0; j <= old->mask; j++) {
+      Entry* e = old->slots[j].load(std::memory_order_relaxed);
+      if (e && e != kTombstone) retire(e);
+    }
+    shard.table.store(new_table(kMinCapacity), std::memory_order_release);
+    shard.used = shard.live = 0;
+    VM::Treadmill::deferredFree(old);
+  }
+  return true;
+}
+
+bool ShardedTableSharedStore::eraseImpl(CStrRef key, bool expired) {
+  if (key.isNull()) return false;
+  strhash_t hash = hash_string(key.data(), key.size());
+  Shard& shard = shardFor(hash);
+  SimpleLock lock(shard.lock);
+  std::atomic<Entry*>* slot = findSlot(shard, key.data(), key.size(), hash);
+  if (!slot) return false;
+  if (expired && !slot->load(std::memory_order_relaxed)->expired()) {
+    return false;
+  }
+  unpublish(shard, slot);
+  return true;
+}
+
+/*
+ * Entries aren't on an expiration queue; every ApcPurgeFrequency stores
+ * we sweep the next shard instead.
+ */
+void ShardedTableSharedStore::purgeExpired() {
+  uint64_t count = m_purgeCounter.fetch_add(1, std::memory_order_relaxed);
+  if (count % RuntimeOption::ApcPurgeFrequency != 0) return;
+  Shard& shard =
+    m_shards[(count / RuntimeOption::ApcPurgeFrequency) % kNumShards];
+  SimpleLock lock(shard.lock);
+  Table* t = shard.table.load(std::memory_order_relaxed);
+  int purged = 0;
+  for (uint32_t j = 0; j <= t->mask; j++) {
+    if (RuntimeOption::ApcPurgeRate >= 0 &&
+        purged >= RuntimeOption::ApcPurgeRate) {
+      break;
+    }
+    Entry* e = t->slots[j].load(std::memory_order_relaxed);
+    if (e && e != kTombstone && e->expired()) {
+      unpublish(shard, &t->slots[j]);
+      purged++;
+    }
+  }
+}
+
+static string std_apc_miss = "apc.miss";
+static string std_apc_hit = "apc.hit";
+static string std_apc_cas = "apc.cas";
+static string std_apc_update = "apc.update";
+static string std_apc_new = "apc.new";
+
+bool ShardedTableSharedStore::handlePromoteObj(CStrRef key,
+                                               SharedVariant* svar,
+                                               CVarRef value) {
+  SharedVariant *converted = svar->convertObj(value);
+  if (!converted) return false;
+  strhash_t hash = hash_string(key.data(), key.size());
+  Shard& shard = shardFor(hash);
+  SimpleLock lock(shard.lock);
+  std::atomic<Entry*>* slot = findSlot(shard, key.data(), key.size(), hash);
+  // Another thread may have updated or deleted the key while we were
+  // converting; if so, leave it alone.
+  Entry* e = slot ? slot->load(std::memory_order_relaxed) : nullptr;
+  if (!e || e->var != svar || svar->isUnserializedObj()) {
+    converted->decRef();
+    return false;
+  }
+  publish(shard, key.data(), key.size(), hash, converted, e->expiry);
+  return true;
+}
+
+bool ShardedTableSharedStore::get(CStrRef key, Variant &value) {
+  strhash_t hash = hash_string(key.data(), key.size());
+  const Entry* e = find(shardFor(hash), key.data(), key.size(), hash);
+  if (!e || e->expired()) {
+    log_apc(std_apc_miss);
+    if (e) eraseImpl(key, true);
+    return false;
+  }
+  // No need to hold a reference on var: it stays alive until this
+  // request finishes, however the entry changes in the meantime.
+  SharedVariant* svar = e->var;
+  value = svar->toLocal();
+  log_apc(std_apc_hit);
+  if (RuntimeOption::ApcAllowObj && svar->is(KindOfObject)) {
+    handlePromoteObj(key, svar, value);
+  }
+  return true;
+}
+
+bool ShardedTableSharedStore::exists(CStrRef key) {
+  strhash_t hash = hash_string(key.data(), key.size());
+  const Entry* e = find(shardFor(hash), key.data(), key.size(), hash);
+  if (!e || e->expired()) {
+    log_apc(std_apc_miss);
+    if (e) eraseImpl(key, true);
+    return false;
+  }
+  log_apc(std_apc_hit);
+  return true;
+}
+
+bool ShardedTableSharedStore::store(CStrRef key, CVarRef value, int64_t ttl,
+                                    bool overwrite /* = true */) {
+  SharedVariant* svar = construct(value);
+  strhash_t hash = hash_string(key.data(), key.size());
+  Shard& shard = shardFor(hash);
+  bool present;
+  {
+    SimpleLock lock(shard.lock);
+    std::atomic<Entry*>* slot = findSlot(shard, key.data(), key.size(), hash);
+    present = slot != nullptr;
+    bool overwritePrime = false;
+    if (present) {
+      Entry* old = slot->load(std::memory_order_relaxed);
+      if (!overwrite && !old->expired()) {
+        svar->decRef();
+        return false;
+      }
+      // if ApcTTLLimit is set, then only primed keys can have expiry == 0
+      overwritePrime = old->expiry == 0;
+    }
+    publish(shard, key.data(), key.size(), hash, svar,
+            expiry_for(key.data(), ttl, overwritePrime));
+  }
+  if (RuntimeOption::ApcExpireOnSets) {
+    purgeExpired();
+  }
+  if (present) {
+    log_apc(std_apc_update);
+  } else {
+    log_apc(std_apc_new);
+    if (RuntimeOption::EnableStats && RuntimeOption::EnableAPCKeyStats) {
+      string prefix = "apc.new." + GetSkeleton(key);
+      ServerStats::Log(prefix, 1);
+    }
+  }
+  return true;
+}
+
+int64_t ShardedTableSharedStore::inc(CStrRef key, int64_t step, bool &found) {
+  found = false;
+  strhash_t hash = hash_string(key.data(), key.size());
+  Shard& shard = shardFor(hash);
+  SimpleLock lock(shard.lock);
+  std::atomic<Entry*>* slot = findSlot(shard, key.data(), key.size(), hash);
+  Entry* e = slot ? slot->load(std::memory_order_relaxed) : nullptr;
+  if (!e || e->expired()) return 0;
+  int64_t ret = e->var->toLocal().toInt64() + step;
+  publish(shard, key.data(), key.size(), hash, construct(Variant(ret)),
+          e->expiry);
+  found = true;
+  log_apc(std_apc_hit);
+  return ret;
+}
+
+bool ShardedTableSharedStore::cas(CStrRef key, int64_t old, int64_t val) {
+  strhash_t hash = hash_string(key.data(), key.size());
+  Shard& shard = shardFor(hash);
+  SimpleLock lock(shard.lock);
+  std::atomic<Entry*>* slot = findSlot(shard, key.data(), key.size(), hash);
+  Entry* e = slot ? slot->load(std::memory_order_relaxed) : nullptr;
+  if (!e || e->expired() || e->var->toLocal().toInt64() != old) {
+    return false;
+  }
+  publish(shard, key.data(), key.size(), hash, construct(Variant(val)),
+          e->expiry);
+  log_apc(std_apc_cas);
+  return true;
+}
+
+void ShardedTableSharedStore::prime
+(const std::vector<SharedStore::KeyValuePair> &vars) {
+  // we are priming, so we are not checking existence or expiration
+  for (unsigned int i = 0; i < vars.size(); i++) {
+    const SharedStore::KeyValuePair &item = vars[i];
+    assert(item.inMem());
+    strhash_t hash = hash_string(item.key, item.len);
+    Shard& shard = shardFor(hash);
+    SimpleLock lock(shard.lock);
+    publish(shard, item.key, item.len, hash, item.value, 0);
+  }
+}
+
+bool ShardedTableSharedStore::constructPrime(CStrRef v, KeyValuePair& item,
+                                             bool serialized) {
+  item.value = SharedVariant::Create(v, serialized);
+  return true;
+}
+
+bool ShardedTableSharedStore::constructPrime(CVarRef v, KeyValuePair& item) {
+  item.value = SharedVariant::Create(v, false);
+  return true;
+}
+
+void ShardedTableSharedStore::primeDone() {
+  for (std::set<string>::const_iterator iter =
+         RuntimeOption::ApcCompletionKeys.begin();
+       iter != RuntimeOption::ApcCompletionKeys.end(); ++iter) {
+    const char* key = iter->c_str();
+    int len = iter->size();
+    strhash_t hash = hash_string(key, len);
+    Shard& shard = shardFor(hash);
+    SimpleLock lock(shard.lock);
+    if (!findSlot(shard, key, len, hash)) {
+      publish(shard, key, len, hash, construct(1), 0);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// debugging support
+
+void ShardedTableSharedStore::dump(std::ostream & out, bool keyOnly,
+                                   int waitSeconds) {
+  // Holding each shard's lock while we walk it keeps its entries alive;
+  // unlike fetches, we may not be inside a request.
+  Logger::Info("dumping apc");
+  out << "Total " << size() << std::endl;
+  for (int i = 0; i < kNumShards; i++) {
+    Shard& shard = m_shards[i];
+    SimpleLock lock(shard.lock);
+    Table* t = shard.table.load(std::memory_order_relaxed);
+    for (uint32_t j = 0; j <= t->mask; j++) {
+      Entry* e = t->slots[j].load(std::memory_order_relaxed);
+      if (!e || e == kTombstone) continue;
+      out << e->key;
+      if (!keyOnly) {
+        out << " #### ";
+        if (!e->expired()) {
+          VariableSerializer vs(VariableSerializer::Serialize);
+          Variant value = e->var->toLocal();
+          try {
+            String valS(vs.serialize(value, true));
+            out << valS->toCPPString();
+          } catch (const Exception &ex) {
+            out << "Exception: " << ex.what();
+          }
+        }
+      }
+      out << std::endl;
+    }
+  }
+  Logger::Info("dumping apc done");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}
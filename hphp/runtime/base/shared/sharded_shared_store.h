@@ -0,0 +1,148 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef __HPHP_SHARDED_SHARED_STORE_H__
+#define __HPHP_SHARDED_SHARED_STORE_H__
+
+#include <atomic>
+
+#include <runtime/base/shared/shared_store_base.h>
+#include <runtime/base/complex_types.h>
+#include <runtime/base/shared/shared_variant.h>
+#include <util/lock.h>
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// ShardedTableSharedStore
+
+/**
+ * An APC table for read-mostly workloads.  Keys are spread over kNumShards
+ * open-addressed tables; writers serialize on their shard's mutex, readers
+ * take no locks at all and never write to the table.
+ *
+ * Entries are immutable once published.  A writer updates a key by
+ * building a new Entry and swapping it into the slot, and a shard grows by
+ * building a new Table and swapping the shard's pointer.  What it replaced
+ * goes to the Treadmill, which frees it once every request that might
+ * still be looking at it has finished.  So a fetch that hits only reads
+ * the shard pointer, the slots it probes and the entry, and a hot key
+ * stays in every core's cache in shared state.
+ *
+ * Readers must be inside a request (between Treadmill::startRequest and
+ * finishRequest).  APC file storage isn't supported; primed values always
+ * live in memory.
+ */
+class ShardedTableSharedStore : public SharedStore {
+public:
+  explicit ShardedTableSharedStore(int id);
+  virtual ~ShardedTableSharedStore();
+
+  // m_shards must be cache line aligned, which plain new doesn't promise.
+  static void* operator new(size_t sz);
+  static void operator delete(void* p) { free(p); }
+
+  virtual int size();
+  virtual bool get(CStrRef key, Variant &value);
+  virtual bool store(CStrRef key, CVarRef val, int64_t ttl,
+                     bool overwrite = true);
+  virtual int64_t inc(CStrRef key, int64_t step, bool &found);
+  virtual bool cas(CStrRef key, int64_t old, int64_t val);
+  virtual bool exists(CStrRef key);
+
+  virtual void prime(const std::vector<SharedStore::KeyValuePair> &vars);
+  virtual bool constructPrime(CStrRef v, KeyValuePair& item,
+                              bool serialized);
+  virtual bool constructPrime(CVarRef v, KeyValuePair& item);
+  virtual void primeDone();
+
+  // debug support
+  virtual void dump(std::ostream & out, bool keyOnly, int waitSeconds);
+
+  struct Entry {
+    strhash_t hash;
+    int32_t len;
+    SharedVariant* var;
+    int64_t expiry;
+    char key[1]; // really len + 1 bytes
+
+    bool expired() const {
+      return expiry && time(nullptr) >= expiry;
+    }
+  };
+
+  struct Table {
+    uint32_t mask;
+    std::atomic<Entry*> slots[1]; // really mask + 1 of them
+  };
+
+protected:
+  virtual SharedVariant* construct(CVarRef v) {
+    return SharedVariant::Create(v, false);
+  }
+
+  virtual bool clear();
+  virtual bool eraseImpl(CStrRef key, bool expired);
+
+private:
+  static const int kLgNumShards = 6;
+  static const int kNumShards = 1 << kLgNumShards;
+
+  static const size_t kCacheLine = 64;
+
+  struct Shard {
+    Shard();
+
+    // Only this line is read by fetches; keep the writer state off it.
+    std::atomic<Table*> table;
+    char pad[kCacheLine - sizeof(std::atomic<Table*>)];
+
+    SimpleMutex lock;
+    uint32_t used; // slots that aren't empty, counting tombstones
+    uint32_t live;
+    // The alignment pads the writer state out to a whole line, so it
+    // doesn't share one with the next shard's table either.
+  } __attribute__((aligned(64)));
+  static_assert(sizeof(Shard) % kCacheLine == 0,
+                "each Shard must start on its own cache line");
+
+  Shard& shardFor(strhash_t hash) {
+    return m_shards[(uint32_t(hash) * 0x9e3779b9U) >> (32 - kLgNumShards)];
+  }
+
+  static const Entry* find(const Shard& shard, const char* key, int len,
+                           strhash_t hash);
+
+  // The rest are called with the shard's lock held.
+  static std::atomic<Entry*>* findSlot(Shard& shard, const char* key, int len,
+                                       strhash_t hash);
+  static void publish(Shard& shard, const char* key, int len, strhash_t hash,
+                      SharedVariant* var, int64_t expiry);
+  static void unpublish(Shard& shard, std::atomic<Entry*>* slot);
+  static void grow(Shard& shard);
+
+  void purgeExpired();
+  bool handlePromoteObj(CStrRef key, SharedVariant* svar, CVarRef value);
+
+  Shard m_shards[kNumShards];
+  std::atomic<uint64_t> m_purgeCounter;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif /* __HPHP_SHARDED_SHARED_STORE_H__ */
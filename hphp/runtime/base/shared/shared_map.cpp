@@ -146,6 +146,17 @@ ArrayData *SharedMap::copy() const {
   return SharedMap::escalate();
 }
 
+SharedMap *SharedMap::copyShared() const {
+  SharedMap *ret = NEW(SharedMap)(m_arr);
+  ret->m_pos = m_pos;
+  return ret;
+}
+
+SharedMap *SharedMap::sharedValues() const {
+  if (!m_arr->arrIsVector()) return nullptr;
+  return NEW(SharedMap)(m_arr);
+}
+
 ArrayData *SharedMap::append(CVarRef v, bool copy) {
   ArrayData *escalated = SharedMap::escalate();
   return releaseIfCopied(escalated, escalated->append(v, false));
@@ -97,6 +97,16 @@ public:
   ArrayData *remove(const StringData* k, bool copy);
 
   ArrayData *copy() const;
+
+  /**
+   * Copies that share our SharedVariant instead of escalating, for when
+   * the caller won't write to the elements.  copyShared() keeps the
+   * internal pointer where it is.  sharedValues() is array_values(), but
+   * only if we're already a vector; otherwise it returns null.
+   */
+  SharedMap *copyShared() const;
+  SharedMap *sharedValues() const;
+
   /**
    * Copy (escalate) the SharedMap without triggering local cache.
    */
@@ -22,6 +22,7 @@
 #include <runtime/base/memory/leak_detectable.h>
 #include <runtime/base/server/server_stats.h>
 #include <runtime/base/shared/concurrent_shared_store.h>
+#include <runtime/base/shared/sharded_shared_store.h>
 #include <util/timer.h>
 #include <util/logger.h>
 #include <sys/mman.h>
@@ -88,6 +89,9 @@ void SharedStores::create() {
       case RuntimeOption::ApcConcurrentTable:
         m_stores[i] = new ConcurrentTableSharedStore(i);
         break;
+      case RuntimeOption::ApcShardedTable:
+        m_stores[i] = new ShardedTableSharedStore(i);
+        break;
       default:
         assert(false);
     }
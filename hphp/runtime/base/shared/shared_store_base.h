@@ -17,6 +17,8 @@
 #ifndef __HPHP_SHARED_STORE_BASE_H__
 #define __HPHP_SHARED_STORE_BASE_H__
 
+#include <atomic>
+
 #include <runtime/base/types.h>
 #include <runtime/base/shared/shared_variant.h>
 #include <util/lock.h>
@@ -30,12 +32,20 @@
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
 
+class SharedStoreSnapshot;
+
 class StoreValue {
 public:
-  StoreValue() : var(nullptr), sAddr(nullptr), expiry(0), size(0), sSize(0) {}
+  StoreValue() : var(nullptr), sAddr(nullptr), expiry(0), size(0), sSize(0),
+                 charge(0), atime(0), hits(0), ctime(0), evictId(0),
+                 adopted(false) {}
   StoreValue(const StoreValue& v) : var(v.var), sAddr(v.sAddr),
                                     expiry(v.expiry), size(v.size),
-                                    sSize(v.sSize) {}
+                                    sSize(v.sSize), charge(v.charge),
+                                    atime(v.atime),
+                                    hits(v.hits.load(std::memory_order_relaxed)),
+                                    ctime(v.ctime), evictId(v.evictId),
+                                    adopted(v.adopted) {}
   void set(SharedVariant *v, int64_t ttl);
   bool expired() const;
 
@@ -49,6 +59,18 @@ public:
   int32_t sSize; // For file storage, negative means serailized object
   mutable SmallLock lock;
 
+  // For APC.MemoryLimit: the bytes counted against the limit, and what
+  // the eviction policy looks at. Readers bump atime and hits without a
+  // write lock, so they are only approximate; hits is a relaxed atomic so
+  // that concurrent readers don't race on it.
+  mutable int32_t charge;
+  mutable uint32_t atime;
+  mutable std::atomic<uint32_t> hits;
+  mutable uint32_t ctime;
+  mutable uint64_t evictId; // 0 if never eligible for eviction
+  // sAddr points into an adopted snapshot rather than primed file storage
+  bool adopted;
+
   bool inMem() const {
     return var != nullptr;
   }
@@ -104,6 +126,12 @@ public:
   virtual bool constructPrime(CVarRef v, KeyValuePair& item) = 0;
   virtual void primeDone() {}
 
+  // Write every live key to snapshot, or take in the ones from a snapshot
+  // of another process that we don't have yet. Both return the number of
+  // keys, or -1 if the store can't do it.
+  virtual int writeSnapshot(SharedStoreSnapshot& snapshot) { return -1; }
+  virtual int adoptSnapshot(SharedStoreSnapshot& snapshot) { return -1; }
+
   virtual bool check() { return true; }
   static size_t s_lockCount;
   static std::string GetSkeleton(CStrRef key);
@@ -0,0 +1,186 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#include <runtime/base/shared/shared_store_snapshot.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <util/logger.h>
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+static const char kMagic[8] = { 'H', 'H', 'A', 'P', 'C', 'S', 'N', 'P' };
+
+namespace {
+struct Record {
+  int32_t keyLen;
+  int32_t valueLen;
+  int64_t expiry;
+};
+}
+
+static size_t record_size(int32_t keyLen, int32_t valueLen) {
+  size_t size = sizeof(Record) + keyLen + 1 + abs(valueLen) + 1;
+  return (size + 7) & ~7ull;
+}
+
+SharedStoreSnapshot::SharedStoreSnapshot(const std::string& path)
+  : m_path(path), m_out(nullptr), m_base(nullptr), m_pos(nullptr),
+    m_end(nullptr) {
+  memset(&m_header, 0, sizeof(m_header));
+}
+
+SharedStoreSnapshot::~SharedStoreSnapshot() {
+  if (m_out) {
+    // never committed
+    fclose(m_out);
+    unlink((m_path + ".tmp").c_str());
+  }
+}
+
+bool SharedStoreSnapshot::create() {
+  assert(!m_out && !m_base);
+  std::string tmp = m_path + ".tmp";
+  m_out = fopen(tmp.c_str(), "w");
+  if (!m_out) {
+    Logger::Error("Unable to write apc snapshot %s", tmp.c_str());
+    return false;
+  }
+  memcpy(m_header.magic, kMagic, sizeof(kMagic));
+  m_header.version = kVersion;
+  m_header.created = time(nullptr);
+  // a placeholder until commit() knows the count and size
+  fwrite(&m_header, sizeof(m_header), 1, m_out);
+  return true;
+}
+
+void SharedStoreSnapshot::add(const char *key, int32_t keyLen,
+                              const char *value, int32_t valueLen,
+                              bool serializedObj, int64_t expiry) {
+  assert(m_out);
+  static const char zeros[8] = { 0 };
+  Record rec = { keyLen, serializedObj ? -valueLen : valueLen, expiry };
+  size_t size = record_size(keyLen, valueLen);
+  fwrite(&rec, sizeof(rec), 1, m_out);
+  fwrite(key, keyLen, 1, m_out);
+  fwrite(zeros, 1, 1, m_out);
+  fwrite(value, valueLen, 1, m_out);
+  fwrite(zeros, size - sizeof(rec) - keyLen - valueLen - 1, 1, m_out);
+  m_header.count++;
+  m_header.dataSize += size;
+}
+
+bool SharedStoreSnapshot::commit() {
+  assert(m_out);
+  std::string tmp = m_path + ".tmp";
+  fseek(m_out, 0, SEEK_SET);
+  fwrite(&m_header, sizeof(m_header), 1, m_out);
+  bool ok = !ferror(m_out);
+  ok = fclose(m_out) == 0 && ok;
+  m_out = nullptr;
+  if (!ok || rename(tmp.c_str(), m_path.c_str()) != 0) {
+    Logger::Error("Unable to write apc snapshot %s", m_path.c_str());
+    unlink(tmp.c_str());
+    return false;
+  }
+  Logger::Info("Wrote %u keys (%lld bytes) to apc snapshot %s",
+               m_header.count, (long long)m_header.dataSize, m_path.c_str());
+  return true;
+}
+
+bool SharedStoreSnapshot::attach(int maxAge) {
+  assert(!m_out && !m_base);
+  int fd = open(m_path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+    close(fd);
+    Logger::Warning("Ignoring apc snapshot %s: truncated", m_path.c_str());
+    return false;
+  }
+  char *base = (char *)mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED,
+                            fd, 0);
+  close(fd);
+  if (base == (char *)MAP_FAILED) {
+    Logger::Error("Unable to map apc snapshot %s", m_path.c_str());
+    return false;
+  }
+  memcpy(&m_header, base, sizeof(m_header));
+  const char *problem = nullptr;
+  if (memcmp(m_header.magic, kMagic, sizeof(kMagic)) ||
+      m_header.version != kVersion) {
+    problem = "bad header";
+  } else if (m_header.dataSize != st.st_size - (off_t)sizeof(Header)) {
+    problem = "truncated";
+  } else if (time(nullptr) - m_header.created > maxAge) {
+    problem = "too old";
+  }
+  if (problem) {
+    Logger::Warning("Ignoring apc snapshot %s: %s", m_path.c_str(), problem);
+    munmap(base, st.st_size);
+    return false;
+  }
+  // Ours now; don't let anybody else adopt it.
+  unlink(m_path.c_str());
+  m_base = base;
+  m_pos = base + sizeof(Header);
+  m_end = base + st.st_size;
+  return true;
+}
+
+bool SharedStoreSnapshot::next(Entry& entry) {
+  assert(m_base);
+  if (m_pos == m_end) return false;
+  Record rec;
+  if (m_end - m_pos < (ssize_t)sizeof(rec)) {
+    m_pos = m_end;
+    Logger::Warning("apc snapshot %s: truncated record", m_path.c_str());
+    return false;
+  }
+  memcpy(&rec, m_pos, sizeof(rec));
+  int32_t valueLen = abs(rec.valueLen);
+  if (rec.keyLen < 0 || valueLen < 0 ||
+      (int64_t)rec.keyLen + valueLen > m_end - m_pos ||
+      (ssize_t)record_size(rec.keyLen, valueLen) > m_end - m_pos) {
+    m_pos = m_end;
+    Logger::Warning("apc snapshot %s: bad record", m_path.c_str());
+    return false;
+  }
+  char *key = m_pos + sizeof(rec);
+  char *value = key + rec.keyLen + 1;
+  if (key[rec.keyLen] != '\0' || value[valueLen] != '\0') {
+    m_pos = m_end;
+    Logger::Warning("apc snapshot %s: bad record", m_path.c_str());
+    return false;
+  }
+  entry.key = key;
+  entry.keyLen = rec.keyLen;
+  entry.sAddr = value;
+  entry.sSize = rec.valueLen;
+  entry.expiry = rec.expiry;
+  m_pos += record_size(rec.keyLen, valueLen);
+  return true;
+}
+
+time_t SharedStoreSnapshot::created() const {
+  return m_header.created;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}
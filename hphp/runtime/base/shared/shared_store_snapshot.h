@@ -0,0 +1,93 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef __HPHP_SHARED_STORE_SNAPSHOT_H__
+#define __HPHP_SHARED_STORE_SNAPSHOT_H__
+
+#include <stdio.h>
+#include <string>
+
+#include <runtime/base/types.h>
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A snapshot of APC that outlives the process that wrote it, so that the
+ * next server (a takeover or a plain restart) starts with a warm cache.
+ *
+ * It is a single file, normally under /dev/shm so it never leaves memory,
+ * holding a header and then one record per key:
+ *
+ *   int32_t keyLen, valLen; int64_t expiry; key '\0' value '\0'
+ *
+ * padded to 8 bytes. Values are plain serialize() data, with no pointers
+ * into the writing process (APCSerialize has some), so the file can be
+ * mapped anywhere. The adopting process maps it read-only and points each
+ * key's StoreValue at its record, the same way primed file storage works:
+ * nothing is unserialized until the key is fetched. The mapping is never
+ * released, since adopted keys may keep pointing into it.
+ *
+ * The writer builds the file under a temporary name and renames it into
+ * place, and the reader unlinks it once mapped, so a snapshot is adopted
+ * at most once.
+ */
+class SharedStoreSnapshot {
+public:
+  explicit SharedStoreSnapshot(const std::string& path);
+  ~SharedStoreSnapshot();
+
+  // writing
+  bool create();
+  void add(const char *key, int32_t keyLen, const char *value,
+           int32_t valueLen, bool serializedObj, int64_t expiry);
+  bool commit();
+
+  // reading; attach() fails for a snapshot older than maxAge seconds
+  bool attach(int maxAge);
+  struct Entry {
+    const char *key;
+    int32_t keyLen;
+    char *sAddr;
+    int32_t sSize; // negative for a serialized object, as in StoreValue
+    int64_t expiry;
+  };
+  bool next(Entry& entry);
+  time_t created() const;
+
+  static const uint32_t kVersion = 1;
+
+private:
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    int64_t created;
+    int64_t dataSize;
+  };
+
+  std::string m_path;
+  FILE *m_out;
+  Header m_header;
+  char *m_base;
+  char *m_pos;
+  char *m_end;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif // __HPHP_SHARED_STORE_SNAPSHOT_H__
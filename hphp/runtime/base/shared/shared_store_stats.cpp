@@ -244,6 +244,9 @@ std::atomic<int32_t> SharedStoreStats::s_fromFileCount(0);
 std::atomic<int32_t> SharedStoreStats::s_updateCount(0);
 std::atomic<int32_t> SharedStoreStats::s_deleteCount(0);
 std::atomic<int32_t> SharedStoreStats::s_expireCount(0);
+std::atomic<int32_t> SharedStoreStats::s_evictCount(0);
+std::atomic<int64_t> SharedStoreStats::s_evictSize(0);
+int64_t SharedStoreStats::s_memoryUsed = 0;
 
 int32_t SharedStoreStats::s_expireQueueSize = 0;
 std::atomic<int64_t> SharedStoreStats::s_purgingTime(0);
@@ -252,6 +255,7 @@ ReadWriteMutex SharedStoreStats::s_rwlock;
 
 SharedStoreStats::StatsMap SharedStoreStats::s_statsMap,
                            SharedStoreStats::s_detailMap;
+SharedStoreStats::PrefixMap SharedStoreStats::s_prefixMap;
 
 //////////////////////////////////////////////////////////////////////////////
 // Helpers for reporting and global aggregation
@@ -270,6 +274,9 @@ string SharedStoreStats::report_basic() {
   writeEntryInt(out, "Delete_Count", s_deleteCount, false, 1, true);
   writeEntryInt(out, "Expire_Count", s_expireCount, false, 1, true);
   writeEntryInt(out, "Expire_Queue_Size", s_expireQueueSize, false, 1, true);
+  writeEntryInt(out, "Evict_Count", s_evictCount, false, 1, true);
+  writeEntryInt(out, "Evict_Size", s_evictSize, false, 1, true);
+  writeEntryInt(out, "Memory_Used", s_memoryUsed, false, 1, true);
   writeEntryInt(out, "Purging_Time", s_purgingTime, true, 1, true);
   out << "}\n";
   return out.str();
@@ -288,6 +295,9 @@ string SharedStoreStats::report_basic_flat() {
       << ", " << "\"hphp.apc.delete_count\":" << s_deleteCount
       << ", " << "\"hphp.apc.expire_count\":" << s_expireCount
       << ", " << "\"hphp.apc.expire_queue_size\":" << s_expireQueueSize
+      << ", " << "\"hphp.apc.evict_count\":" << s_evictCount
+      << ", " << "\"hphp.apc.evict_size\":" << s_evictSize
+      << ", " << "\"hphp.apc.memory_used\":" << s_memoryUsed
       << ", " << "\"hphp.apc.purging_time\":" << s_purgingTime
       << "}\n";
   return out.str();
@@ -312,6 +322,24 @@ string SharedStoreStats::report_keys() {
   return out.str();
 }
 
+string SharedStoreStats::report_prefixes() {
+  ostringstream out;
+  // Iterating a concurrent_hash_map isn't safe against inserts, which
+  // only happen under a read lock on s_rwlock.
+  WriteLock l(s_rwlock);
+  for (PrefixMap::const_iterator iter = s_prefixMap.begin();
+       iter != s_prefixMap.end(); ++iter) {
+    out << "{";
+    writeEntryStr(out, "Prefix", iter->first.c_str());
+    writeEntryInt(out, "Count", iter->second.count);
+    writeEntryInt(out, "Size", iter->second.size);
+    writeEntryInt(out, "EvictCount", iter->second.evictCount);
+    writeEntryInt(out, "EvictSize", iter->second.evictSize, true);
+    out << "}\n";
+  }
+  return out.str();
+}
+
 bool SharedStoreStats::snapshot(const char *filename, std::string& keySample) {
   std::ofstream out(filename);
   if (out.fail()) {
@@ -398,11 +426,14 @@ void SharedStoreStats::addDirect(int32_t keySize, int32_t dataTotal, bool prime,
   }
 }
 
-void SharedStoreStats::removeDirect(int32_t keySize, int32_t dataTotal, bool exp) {
+void SharedStoreStats::removeDirect(int32_t keySize, int32_t dataTotal, bool exp,
+                                    bool evict /* = false */) {
   s_keyCount.fetch_sub(1, std::memory_order_relaxed);
   s_keySize.fetch_sub(keySize, std::memory_order_relaxed);
   s_dataTotalSize.fetch_sub((int64_t)dataTotal, std::memory_order_relaxed);
-  if (exp) {
+  if (evict) {
+    // counted by onEvict()
+  } else if (exp) {
     s_expireCount.fetch_add(1, std::memory_order_relaxed);
   } else {
     s_deleteCount.fetch_add(1, std::memory_order_relaxed);
@@ -419,6 +450,32 @@ void SharedStoreStats::addPurgingTime(int64_t purgingTime) {
   s_purgingTime.fetch_add(purgingTime, std::memory_order_relaxed);
 }
 
+static std::string key_prefix(const char *key) {
+  const std::string &sep = RuntimeOption::APCSizePrefixSeparator;
+  size_t len = sep.empty() ? 0 : strcspn(key, sep.c_str());
+  if (len == strlen(key)) return "(none)";
+  return std::string(key, std::min(len, (size_t)MAX_KEY_LEN));
+}
+
+void SharedStoreStats::onCharge(const char *key, int64_t delta, int count) {
+  ReadLock l(s_rwlock);
+  PrefixMap::accessor acc;
+  s_prefixMap.insert(acc, key_prefix(key));
+  acc->second.size += delta;
+  acc->second.count += count;
+}
+
+void SharedStoreStats::onEvict(const char *key, int32_t charge) {
+  s_evictCount.fetch_add(1, std::memory_order_relaxed);
+  s_evictSize.fetch_add(charge, std::memory_order_relaxed);
+  if (!RuntimeOption::EnableAPCSizeStats) return;
+  ReadLock l(s_rwlock);
+  PrefixMap::accessor acc;
+  s_prefixMap.insert(acc, key_prefix(key));
+  acc->second.evictCount++;
+  acc->second.evictSize += charge;
+}
+
 void SharedStoreStats::onDelete(const StringData *key, const SharedVariant *var,
                                 bool replace, bool noTTL) {
   char normalizedKey[MAX_KEY_LEN + 1];
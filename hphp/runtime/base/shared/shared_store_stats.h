@@ -102,7 +102,8 @@ public:
   static bool snapshot(const char *filename, std::string& keySample);
 
   static void addDirect(int32_t keySize, int32_t dataTotal, bool prime, bool file);
-  static void removeDirect(int32_t keySize, int32_t dataTotal, bool exp);
+  static void removeDirect(int32_t keySize, int32_t dataTotal, bool exp,
+                           bool evict = false);
   static void updateDirect(int32_t dataTotalOld, int32_t dataTotalNew);
 
   static void setExpireQueueSize(int32_t size) {
@@ -110,6 +111,15 @@ public:
   }
   static void addPurgingTime(int64_t purgingTime);
 
+  // Memory held by the store, as counted for APC.MemoryLimit, overall and
+  // broken down by key prefix (see Stats.APCSize.PrefixSeparator).
+  static void setMemoryUsed(int64_t size) {
+    s_memoryUsed = size;
+  }
+  static void onCharge(const char *key, int64_t delta, int count);
+  static void onEvict(const char *key, int32_t charge);
+  static std::string report_prefixes();
+
 protected:
   static ReadWriteMutex s_rwlock;
 
@@ -128,6 +138,9 @@ protected:
   static std::atomic<int32_t> s_updateCount;
   static std::atomic<int32_t> s_deleteCount;
   static std::atomic<int32_t> s_expireCount;
+  static std::atomic<int32_t> s_evictCount;
+  static std::atomic<int64_t> s_evictSize;
+  static int64_t s_memoryUsed;
 
   static int32_t s_expireQueueSize;
   static std::atomic<int64_t> s_purgingTime;
@@ -150,6 +163,16 @@ protected:
                                    charHashCompare> StatsMap;
 
   static StatsMap s_statsMap, s_detailMap;
+
+  struct PrefixStats {
+    PrefixStats() : size(0), count(0), evictCount(0), evictSize(0) {}
+    int64_t size;
+    int64_t count;
+    int64_t evictCount;
+    int64_t evictSize;
+  };
+  typedef tbb::concurrent_hash_map<std::string, PrefixStats> PrefixMap;
+  static PrefixMap s_prefixMap;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -18,6 +18,7 @@
 #include <runtime/ext/ext_variable.h>
 #include <runtime/ext/ext_apc.h>
 #include <runtime/base/shared/shared_map.h>
+#include <runtime/base/shared/compact_serializer.h>
 #include <runtime/base/runtime_option.h>
 
 namespace HPHP {
@@ -105,7 +106,11 @@ SharedVariant::SharedVariant(CVarRef source, bool serialized,
         m_data.obj = obj;
         setIsObj();
       } else {
-        String s = apc_serialize(source);
+        String s;
+        if (RuntimeOption::ApcCompactSerialize) {
+          s = CompactSerializer::Serialize(source);
+        }
+        if (s.isNull()) s = apc_serialize(source);
         m_data.str = new StringData(s.data(), s.size(), CopyMalloc);
       }
       break;
@@ -198,8 +203,17 @@ void SharedVariant::dump(std::string &out) {
     out += "null";
     break;
   default:
-    out += "object: ";
-    out += m_data.str->data();
+    if (getIsObj()) {
+      out += "object";
+    } else if (CompactSerializer::IsCompact(m_data.str->data(),
+                                            m_data.str->size())) {
+      out += "compact object(";
+      out += boost::lexical_cast<string>(m_data.str->size());
+      out += ")";
+    } else {
+      out += "object: ";
+      out += m_data.str->data();
+    }
     break;
   }
   out += "\n";
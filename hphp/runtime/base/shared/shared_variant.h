@@ -104,6 +104,12 @@ public:
     return m_data.map->size();
   }
 
+  // keys are 0..arrSize()-1, in order
+  bool arrIsVector() const {
+    assert(is(KindOfArray));
+    return getIsVector();
+  }
+
   size_t arrCap() const {
     assert(is(KindOfArray));
     if (getIsVector()) return m_data.vec->m_size;
@@ -133,6 +139,16 @@ public:
 
   SharedVariant *convertObj(CVarRef var);
   bool isUnserializedObj() { return getIsObj(); }
+
+  // Objects, and arrays with internal references, are kept apc_serialize()d
+  bool isSerialized() const {
+    return is(KindOfObject) ? !getIsObj() :
+      is(KindOfArray) && getSerializedArray();
+  }
+  StringData *getSerialized() const {
+    assert(isSerialized());
+    return m_data.str;
+  }
   bool shouldCache() const { return m_shouldCache; }
 
   int countReachable() const;
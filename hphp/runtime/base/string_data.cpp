@@ -255,15 +255,31 @@ void StringData::releaseData() {
   }
 }
 
-char* smart_concat(const char* s1, uint32_t len1, const char* s2, uint32_t len2) {
+char* smart_concat(const char* s1, uint32_t len1, const char* s2, uint32_t len2,
+                   uint32_t cap) {
   uint32_t len = len1 + len2;
-  char* s = (char*)smart_malloc(len + 1);
+  assert(cap >= len);
+  char* s = (char*)smart_malloc(cap + 1);
   memcpy(s, s1, len1);
   memcpy(s + len1, s2, len2);
   s[len] = 0;
   return s;
 }
 
+char* smart_concat(const char* s1, uint32_t len1, const char* s2, uint32_t len2) {
+  return smart_concat(s1, len1, s2, len2, len1 + len2);
+}
+
+/*
+ * Capacity for a buffer that has to grow to hold len bytes. Whoever appends
+ * once is likely in a concat loop ($out .= ...), so leave a quarter again
+ * as much room; that keeps the copying per appended byte constant.
+ */
+static uint32_t grow_cap(uint32_t len) {
+  uint64_t cap = len + (len >> 2);
+  return cap > StringData::MaxSize ? StringData::MaxSize : cap;
+}
+
 void StringData::initConcat(StringSlice r1, StringSlice r2) {
   m_hash = 0;
   _count = 0;
@@ -317,29 +333,30 @@ void StringData::append(const char *s, int len) {
                               size_t(len) + size_t(m_len));
   }
   uint32_t newlen = m_len + len;
-  // TODO: t1122987: in any of the cases below where we need a bigger buffer,
-  // we can probably assume we're in a concat-loop and pick a good buffer
-  // size to avoid O(N^2) copying cost.
+  // Wherever we need a bigger buffer below, we assume we're in a concat
+  // loop and leave room to grow (see grow_cap) to avoid O(N^2) copying.
   if (isShared() || isLiteral()) {
     // buffer is immutable, don't modify it.
     StringSlice r = slice();
-    char* newdata = smart_concat(r.ptr, r.len, s, len);
+    uint32_t cap = grow_cap(newlen);
+    char* newdata = smart_concat(r.ptr, r.len, s, len, cap);
     if (isShared()) {
       m_big.shared->decRef();
       delist();
     }
     m_len = newlen;
     m_data = newdata;
-    m_big.cap = newlen | IsSmart;
+    m_big.cap = cap | IsSmart;
     m_hash = 0;
   } else if (rawdata() == s) {
     // appending ourself to ourself, be conservative.
     StringSlice r = slice();
-    char *newdata = smart_concat(r.ptr, r.len, s, len);
+    uint32_t cap = grow_cap(newlen);
+    char *newdata = smart_concat(r.ptr, r.len, s, len, cap);
     releaseData();
     m_len = newlen;
     m_data = newdata;
-    m_big.cap = newlen | IsSmart;
+    m_big.cap = cap | IsSmart;
     m_hash = 0;
   } else if (isSmall()) {
     // we're currently small but might not be after append.
@@ -355,10 +372,11 @@ void StringData::append(const char *s, int len) {
       m_hash = 0;
     } else {
       // small->big string transition.
-      char *newdata = smart_concat(m_small, oldlen, s, len);
+      uint32_t cap = grow_cap(newlen);
+      char *newdata = smart_concat(m_small, oldlen, s, len, cap);
       m_len = newlen;
       m_data = newdata;
-      m_big.cap = newlen | IsSmart;
+      m_big.cap = cap | IsSmart;
       m_hash = 0;
     }
   } else if (format() == IsSmart) {
@@ -372,9 +390,9 @@ void StringData::append(const char *s, int len) {
     if ((int)newlen <= capacity()) {
       newdata = oldp;
     } else {
-      uint32_t nlen = newlen + (newlen >> 2);
-      newdata = (char*) smart_realloc(oldp, nlen + 1);
-      m_big.cap = nlen | IsSmart;
+      uint32_t cap = grow_cap(newlen);
+      newdata = (char*) smart_realloc(oldp, cap + 1);
+      m_big.cap = cap | IsSmart;
     }
     memcpy(newdata + oldlen, s, len);
     newdata[newlen] = 0;
@@ -388,12 +406,18 @@ void StringData::append(const char *s, int len) {
     assert((oldp > s && oldp - s > len) ||
            (oldp < s && s - oldp > oldlen)); // no overlapping
     newlen = oldlen + len;
-    char* newdata = (char*) realloc(oldp, newlen + 1);
+    char* newdata;
+    if ((int)newlen <= capacity()) {
+      newdata = oldp;
+    } else {
+      uint32_t cap = grow_cap(newlen);
+      newdata = (char*) realloc(oldp, cap + 1);
+      m_big.cap = cap | IsMalloc;
+    }
     memcpy(newdata + oldlen, s, len);
     newdata[newlen] = 0;
     m_len = newlen;
     m_data = newdata;
-    m_big.cap = newlen | IsMalloc;
     m_hash = 0;
   }
   assert(newlen <= MaxSize);
@@ -747,6 +747,11 @@ Array Array::keys(CVarRef search_value /* = null_variant */,
 }
 
 Array Array::values() const {
+  if (m_px && m_px->isSharedMap()) {
+    if (SharedMap *values = static_cast<SharedMap*>(m_px)->sharedValues()) {
+      return values;
+    }
+  }
   ArrayInit ai(size(), ArrayInit::vectorInit);
   for (ArrayIter iter(*this); iter; ++iter) {
     ai.set(iter.secondRef());
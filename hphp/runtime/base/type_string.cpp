@@ -23,6 +23,7 @@
 #include <runtime/base/zend/zend_functions.h>
 #include <runtime/base/zend/zend_string.h>
 #include <runtime/base/zend/zend_printf.h>
+#include <runtime/base/util/request_string_table.h>
 
 namespace HPHP {
 
@@ -688,7 +689,8 @@ void String::serialize(VariableSerializer *serializer) const {
 
 void String::unserialize(VariableUnserializer *uns,
                          char delimiter0 /* = '"' */,
-                         char delimiter1 /* = '"' */) {
+                         char delimiter1 /* = '"' */,
+                         bool intern /* = false */) {
   int64_t size = uns->readInt();
   if (size >= RuntimeOption::MaxSerializedStringSize) {
     throw Exception("Size of serialized string (%d) exceeds max", int(size));
@@ -706,14 +708,24 @@ void String::unserialize(VariableUnserializer *uns,
   if (ch != delimiter0) {
     throw Exception("Expected '%c' but got '%c'", delimiter0, ch);
   }
-  StringData *px = NEW(StringData)(int(size));
-  MutableSlice buf = px->mutableSlice();
-  assert(size <= buf.len);
-  uns->read(buf.ptr, size);
-  px->setSize(size);
+  StringData *px = nullptr;
+  if (intern && uns->remaining() >= size) {
+    px = RequestStringTable::Intern(uns->head(), size);
+    if (px) {
+      uns->skip(size);
+      px->incRefCount();
+    }
+  }
+  if (!px) {
+    px = NEW(StringData)(int(size));
+    MutableSlice buf = px->mutableSlice();
+    assert(size <= buf.len);
+    uns->read(buf.ptr, size);
+    px->setSize(size);
+    px->setRefCount(1);
+  }
   if (m_px) decRefStr(m_px);
   m_px = px;
-  px->setRefCount(1);
 
   ch = uns->readChar();
   if (ch != delimiter1) {
@@ -24,6 +24,7 @@
 #include <runtime/base/runtime_option.h>
 #include <runtime/base/zend/zend_string.h>
 #include <runtime/base/array/array_iterator.h>
+#include <runtime/base/shared/shared_map.h>
 #include <util/parser/hphp.tab.hpp>
 #include <runtime/vm/translator/translator-x64.h>
 #include <runtime/vm/runtime.h>
@@ -508,11 +509,20 @@ void Variant::prepend(CVarRef v) {
   }
 }
 
+/*
+ * Moving the internal pointer of an array someone else can see needs a
+ * copy, but not of the elements; a SharedMap can share them.
+ */
+static ArrayData* copyForIteration(ArrayData* arr) {
+  if (arr->isSharedMap()) return static_cast<SharedMap*>(arr)->copyShared();
+  return arr->copy();
+}
+
 Variant Variant::array_iter_reset() {
   if (is(KindOfArray)) {
     ArrayData *arr = getArrayData();
     if (arr->getCount() > 1 && !arr->isHead() && !arr->noCopyOnWrite()) {
-      arr = arr->copy();
+      arr = copyForIteration(arr);
       set(arr);
       assert(arr == getArrayData());
     }
@@ -526,7 +536,7 @@ Variant Variant::array_iter_prev() {
   if (is(KindOfArray)) {
     ArrayData *arr = getArrayData();
     if (arr->getCount() > 1 && !arr->isInvalid() && !arr->noCopyOnWrite()) {
-      arr = arr->copy();
+      arr = copyForIteration(arr);
       set(arr);
       assert(arr == getArrayData());
     }
@@ -563,7 +573,7 @@ Variant Variant::array_iter_next() {
   if (is(KindOfArray)) {
     ArrayData *arr = getArrayData();
     if (arr->getCount() > 1 && !arr->isInvalid() && !arr->noCopyOnWrite()) {
-      arr = arr->copy();
+      arr = copyForIteration(arr);
       set(arr);
       assert(arr == getArrayData());
     }
@@ -577,7 +587,7 @@ Variant Variant::array_iter_end() {
   if (is(KindOfArray)) {
     ArrayData *arr = getArrayData();
     if (arr->getCount() > 1 && !arr->isTail() && !arr->noCopyOnWrite()) {
-      arr = arr->copy();
+      arr = copyForIteration(arr);
       set(arr);
       assert(arr == getArrayData());
     }
@@ -599,7 +609,7 @@ Variant Variant::array_iter_each() {
   if (is(KindOfArray)) {
     ArrayData *arr = getArrayData();
     if (arr->getCount() > 1 && !arr->isInvalid() && !arr->noCopyOnWrite()) {
-      arr = arr->copy();
+      arr = copyForIteration(arr);
       set(arr);
       assert(arr == getArrayData());
     }
@@ -3042,7 +3052,8 @@ void Variant::unserialize(VariableUnserializer *uns,
   case 's':
     {
       String v;
-      v.unserialize(uns);
+      // array keys and property names
+      v.unserialize(uns, '"', '"', mode == Uns::KeyMode);
       operator=(v);
     }
     break;
@@ -0,0 +1,79 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#include <runtime/base/util/request_string_table.h>
+#include <runtime/base/complex_types.h>
+#include <runtime/base/runtime_option.h>
+#include <util/hash.h>
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+IMPLEMENT_STATIC_REQUEST_LOCAL(RequestStringTable, s_requestStrings);
+
+RequestStringTable::RequestStringTable() : m_slots(nullptr), m_count(0) {
+}
+
+RequestStringTable::~RequestStringTable() {
+  free(m_slots);
+}
+
+void RequestStringTable::requestInit() {
+  assert(m_count == 0);
+}
+
+void RequestStringTable::requestShutdown() {
+  if (!m_count) return;
+  for (int i = 0; i < kCapacity; i++) {
+    if (m_slots[i].str) decRefStr(m_slots[i].str);
+  }
+  memset(m_slots, 0, sizeof(Slot) * kCapacity);
+  m_count = 0;
+}
+
+StringData *RequestStringTable::Intern(const char *s, int len) {
+  if (!len || len > (int)RuntimeOption::EvalRequestInternMaxLength) {
+    return nullptr;
+  }
+  return s_requestStrings->intern(s, len);
+}
+
+StringData *RequestStringTable::intern(const char *s, int len) {
+  if (UNLIKELY(!m_slots)) {
+    m_slots = (Slot*)calloc(kCapacity, sizeof(Slot));
+  }
+  strhash_t h = hash_string_inline(s, len);
+  for (int i = h & (kCapacity - 1); ; i = (i + 1) & (kCapacity - 1)) {
+    Slot &slot = m_slots[i];
+    if (!slot.str) {
+      if (m_count >= kCapacity / 2) return nullptr;
+      StringData *str = NEW(StringData)(s, len, CopyString);
+      str->setRefCount(1); // ours
+      str->hash();         // cached for every array it ends up keying
+      slot.str = str;
+      slot.hash = h;
+      m_count++;
+      return str;
+    }
+    if (slot.hash == h && slot.str->size() == len &&
+        !memcmp(slot.str->data(), s, len)) {
+      return slot.str;
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,68 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef __HPHP_REQUEST_STRING_TABLE_H__
+#define __HPHP_REQUEST_STRING_TABLE_H__
+
+#include <runtime/base/util/request_local.h>
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Short strings that a request builds over and over as array keys, like
+ * column names on every row of a query result or the keys of every object
+ * in a JSON list. Interning them for the rest of the request means one
+ * StringData, with its hash computed once, instead of one per row, and
+ * HphpArray lookups with such a key match on the pointer.
+ *
+ * The table is a fixed-size open-addressed array that stops taking new
+ * strings when half full, so a request with many distinct keys pays a
+ * probe and nothing more. Interning is off when Eval.RequestInternMaxLength
+ * is 0.
+ */
+class RequestStringTable : public RequestEventHandler {
+public:
+  RequestStringTable();
+  ~RequestStringTable();
+
+  /**
+   * The request's shared copy of s, or null if s is too long to intern
+   * or the table is full. The table keeps its own reference.
+   */
+  static StringData *Intern(const char *s, int len);
+
+  virtual void requestInit();
+  virtual void requestShutdown();
+
+  static const int kCapacity = 4096;
+
+private:
+  struct Slot {
+    StringData *str;
+    strhash_t hash;
+  };
+
+  StringData *intern(const char *s, int len);
+
+  Slot *m_slots;
+  int m_count;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif // __HPHP_REQUEST_STRING_TABLE_H__
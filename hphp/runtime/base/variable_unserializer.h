@@ -99,6 +99,11 @@ public:
     return *m_buf;
   }
   const char *head() { return m_buf; }
+  size_t remaining() const { return m_end - m_buf; }
+  void skip(size_t n) {
+    assert(n <= remaining());
+    m_buf += n;
+  }
   Variant &addVar();
 
  private:
@@ -20,6 +20,7 @@
 #include <runtime/base/zend/zend_math.h>
 
 #include <util/lock.h>
+#include <util/string_scan.h>
 #include <math.h>
 #include <monetary.h>
 
@@ -290,7 +291,30 @@ char *string_to_case(const char *s, int len, int (*tocase)(int)) {
   assert(s);
   assert(tocase);
   char *ret = (char *)malloc(len + 1);
-  for (int i = 0; i < len; i++) {
+  int i = 0;
+#ifdef __x86_64__
+  // Convert blocks of plain ASCII 16 bytes at a time, as long as the
+  // locale maps ASCII letters the usual way (Turkish ones don't map I/i).
+  bool lower = tocase == tolower && tolower('I') == 'i';
+  bool upper = tocase == toupper && toupper('i') == 'I';
+  if (lower || upper) {
+    char first = lower ? 'A' : 'a';
+    __m128i flip = _mm_set1_epi8(0x20);
+    for (; i + 16 <= len; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+      if (_mm_movemask_epi8(v)) {
+        for (int j = i; j < i + 16; j++) {
+          ret[j] = tocase(s[j]);
+        }
+        continue;
+      }
+      __m128i letters = byte_range(v, first, first + 25);
+      v = _mm_xor_si128(v, _mm_and_si128(letters, flip));
+      _mm_storeu_si128((__m128i *)(ret + i), v);
+    }
+  }
+#endif
+  for (; i < len; i++) {
     ret[i] = tocase(s[i]);
   }
   ret[len] = '\0';
@@ -534,6 +558,29 @@ const char *string_memnstr(const char *haystack, const char *needle,
   const char *p = haystack;
   char ne = needle[needle_len-1];
 
+#ifdef __x86_64__
+  // Try 16 positions at a time, and only compare the whole needle where
+  // both its first and last bytes match.
+  if (needle_len > 1) {
+    __m128i first = _mm_set1_epi8(*needle);
+    __m128i last = _mm_set1_epi8(ne);
+    while (end - p >= needle_len - 1 + 16) {
+      __m128i a = _mm_loadu_si128((const __m128i *)p);
+      __m128i b = _mm_loadu_si128((const __m128i *)(p + needle_len - 1));
+      int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first),
+                                                 _mm_cmpeq_epi8(b, last)));
+      while (mask) {
+        const char *q = p + __builtin_ctz(mask);
+        if (!memcmp(q + 1, needle + 1, needle_len - 2)) {
+          return q;
+        }
+        mask &= mask - 1;
+      }
+      p += 16;
+    }
+  }
+#endif
+
   end -= needle_len;
   while (p <= end) {
     if ((p = (char *)memchr(p, *needle, (end-p+1))) && ne == p[needle_len-1]) {
@@ -1312,6 +1359,13 @@ char *string_addslashes(const char *str, int &length) {
   char *target = new_str;
 
   while (source < end) {
+    const char *run = scan_for<AnyOf<'\0', '\'', '\"', '\\'> >(source, end);
+    if (run != source) {
+      memcpy(target, source, run - source);
+      target += run - source;
+      source = run;
+      if (source == end) break;
+    }
     switch (*source) {
     case '\0':
       *target++ = '\\';
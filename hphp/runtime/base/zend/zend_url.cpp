@@ -17,6 +17,7 @@
 
 #include <runtime/base/zend/zend_url.h>
 #include <runtime/base/zend/zend_string.h>
+#include <util/string_scan.h>
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
@@ -310,6 +311,26 @@ static int php_htoi(char *s) {
 
 static unsigned char hexchars[] = "0123456789ABCDEF";
 
+/*
+ * Bytes that are not alphanumeric or one of "-_.".
+ */
+struct UrlUnsafe {
+  static bool match(unsigned char c) {
+    return (c < '0' && c != '-' && c != '.') ||
+      (c < 'A' && c > '9') ||
+      (c > 'Z' && c < 'a' && c != '_') ||
+      (c > 'z');
+  }
+#ifdef __x86_64__
+  static __m128i match(__m128i v) {
+    __m128i safe = _mm_or_si128(
+      _mm_or_si128(byte_range(v, '0', '9'), byte_range(v, 'A', 'Z')),
+      _mm_or_si128(byte_range(v, 'a', 'z'), AnyOf<'-', '.', '_'>::match(v)));
+    return _mm_xor_si128(safe, _mm_set1_epi8(-1));
+  }
+#endif
+};
+
 char *url_encode(const char *s, int &len) {
   register unsigned char c;
   unsigned char *to, *start;
@@ -320,6 +341,14 @@ char *url_encode(const char *s, int &len) {
   start = to = (unsigned char *)malloc(3 * len + 1);
 
   while (from < end) {
+    const char *run = scan_for<UrlUnsafe>((const char *)from,
+                                          (const char *)end);
+    if (run != (const char *)from) {
+      memcpy(to, from, run - (const char *)from);
+      to += run - (const char *)from;
+      from = (unsigned char const *)run;
+      if (from == end) break;
+    }
     c = *from++;
 
     if (c == ' ') {
@@ -420,24 +449,25 @@ int url_decode_ex(char *value, int len) {
 }
 
 char *url_raw_encode(const char *s, int &len) {
-  register int x, y;
-  unsigned char *str;
-
-  str = (unsigned char *)malloc(3 * len + 1);
-  for (x = 0, y = 0; len--; x++, y++) {
-    str[y] = (unsigned char) s[x];
-    if ((str[y] < '0' && str[y] != '-' && str[y] != '.') ||
-      (str[y] < 'A' && str[y] > '9') ||
-        (str[y] > 'Z' && str[y] < 'a' && str[y] != '_') ||
-      (str[y] > 'z')) {
-      str[y++] = '%';
-      str[y++] = hexchars[(unsigned char) s[x] >> 4];
-      str[y] = hexchars[(unsigned char) s[x] & 15];
-    }
+  const char *end = s + len;
+  char *start = (char *)malloc(3 * len + 1);
+  char *to = start;
+
+  while (s < end) {
+    const char *run = scan_for<UrlUnsafe>(s, end);
+    memcpy(to, s, run - s);
+    to += run - s;
+    s = run;
+    if (s == end) break;
+    unsigned char c = *s++;
+    to[0] = '%';
+    to[1] = hexchars[c >> 4];
+    to[2] = hexchars[c & 15];
+    to += 3;
   }
-  str[y] = '\0';
-  len = y;
-  return ((char *)str);
+  *to = 0;
+  len = to - start;
+  return start;
 }
 
 char *url_raw_decode(const char *s, int &len) {
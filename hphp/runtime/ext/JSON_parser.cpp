@@ -32,6 +32,7 @@ SOFTWARE.
 #include <runtime/base/complex_types.h>
 #include <runtime/base/type_conversions.h>
 #include <runtime/base/builtin_functions.h>
+#include <runtime/base/util/request_string_table.h>
 #include <runtime/base/zend/utf8_decode.h>
 
 #include <system/lib/systemlib.h>
@@ -430,9 +431,18 @@ static void utf16_to_utf8(StringBuffer &buf, unsigned short utf16) {
   }
 }
 
+// Lists of objects repeat the same keys; share them and keep the buffer.
+static String json_key(StringBuffer &key) {
+  if (StringData *data = RequestStringTable::Intern(key.data(), key.size())) {
+    key.clear();
+    return data;
+  }
+  return key.detach();
+}
+
 static void object_set(Variant &var, StringBuffer &key, CVarRef value,
                        int assoc) {
-  String data = key.detach();
+  String data = json_key(key);
   if (!assoc) {
     // We know it is stdClass, and everything is public (and dynamic).
     if (data.empty()) {
@@ -447,7 +457,7 @@ static void object_set(Variant &var, StringBuffer &key, CVarRef value,
 
 static void object_set(Variant &var, StringBuffer &key, RefResult value,
                        int assoc) {
-  String data = key.detach();
+  String data = json_key(key);
   if (!assoc) {
     // We know it is stdClass, and everything is public (and dynamic).
     if (data.empty()) {
@@ -21,12 +21,15 @@
 #include <runtime/base/runtime_option.h>
 #include <util/async_job.h>
 #include <util/timer.h>
+#include <util/logger.h>
 #include <dlfcn.h>
 #include <runtime/base/program_functions.h>
 #include <runtime/base/builtin_functions.h>
 #include <runtime/base/variable_serializer.h>
 #include <util/alloc.h>
 #include <runtime/base/ini_setting.h>
+#include <runtime/base/shared/shared_store_snapshot.h>
+#include <runtime/base/shared/compact_serializer.h>
 
 using HPHP::Util::ScopedMem;
 
@@ -1127,6 +1130,9 @@ String apc_serialize(CVarRef value) {
 }
 
 Variant apc_unserialize(CStrRef str) {
+  if (CompactSerializer::IsCompact(str.data(), str.size())) {
+    return CompactSerializer::Unserialize(str.data(), str.size());
+  }
   VariableUnserializer::Type sType =
     RuntimeOption::EnableApcSerialize ?
       VariableUnserializer::APCSerialize :
@@ -1134,7 +1140,15 @@ Variant apc_unserialize(CStrRef str) {
   return unserialize_ex(str, sType);
 }
 
-void reserialize(VariableUnserializer *uns, StringBuffer &buf) {
+/*
+ * Copy one value from uns to buf, converting between serialize() and
+ * APCSerialize without needing any class definitions. APCSerialize writes
+ * static strings as pointers; normally we turn static strings into those,
+ * but with portable set we turn them back into plain strings instead, so
+ * the result means the same thing in another process.
+ */
+static void reserialize(VariableUnserializer *uns, StringBuffer &buf,
+                        bool portable = false) {
 
   char type = uns->readChar();
   char sep = uns->readChar();
@@ -1164,11 +1178,25 @@ void reserialize(VariableUnserializer *uns, StringBuffer &buf) {
   case 'S':
   case 'A':
     {
+      char pointer[8];
+      uns->read(pointer, 8);
+      if (portable) {
+        if (type == 'A') throw Exception("Can't make 'A' portable");
+        union {
+          char pointer[8];
+          StringData *sd;
+        } u;
+        memcpy(u.pointer, pointer, 8);
+        buf.append("s:");
+        buf.append(u.sd->size());
+        buf.append(":\"");
+        buf.append(u.sd->data(), u.sd->size());
+        buf.append("\"");
+        break;
+      }
       // shouldn't happen, but keep the code here anyway.
       buf.append(type);
       buf.append(sep);
-      char pointer[8];
-      uns->read(pointer, 8);
       buf.append(pointer, 8);
     }
     break;
@@ -1177,7 +1205,7 @@ void reserialize(VariableUnserializer *uns, StringBuffer &buf) {
       String v;
       v.unserialize(uns);
       assert(!v.isNull());
-      if (v->isStatic()) {
+      if (v->isStatic() && !portable) {
         union {
           char pointer[8];
           StringData *sd;
@@ -1207,8 +1235,8 @@ void reserialize(VariableUnserializer *uns, StringBuffer &buf) {
       sep2 = uns->readChar();
       buf.append(sep2);
       for (int64_t i = 0; i < size; i++) {
-        reserialize(uns, buf); // key
-        reserialize(uns, buf); // value
+        reserialize(uns, buf, portable); // key
+        reserialize(uns, buf, portable); // value
       }
       sep2 = uns->readChar(); // '}'
       buf.append(sep2);
@@ -1237,8 +1265,8 @@ void reserialize(VariableUnserializer *uns, StringBuffer &buf) {
       sep2 = uns->readChar(); // '{'
       buf.append(sep2);
       for (int64_t i = 0; i < size; i++) {
-        reserialize(uns, buf); // property name
-        reserialize(uns, buf); // property value
+        reserialize(uns, buf, portable); // property name
+        reserialize(uns, buf, portable); // property value
       }
       sep2 = uns->readChar(); // '}'
       buf.append(sep2);
@@ -1287,6 +1315,116 @@ String apc_reserialize(CStrRef str) {
   return buf.detach();
 }
 
+static void portable_reserialize(StringData *str, StringBuffer &buf) {
+  if (CompactSerializer::IsCompact(str->data(), str->size())) {
+    CompactSerializer::ToSerialized(str->data(), str->size(), buf);
+    return;
+  }
+  if (!RuntimeOption::EnableApcSerialize) {
+    buf.append(str->data(), str->size());
+    return;
+  }
+  VariableUnserializer uns(str->data(), str->size(),
+                           VariableUnserializer::APCSerialize);
+  reserialize(&uns, buf, true);
+}
+
+/*
+ * serialize() a SharedVariant without unserializing any objects in it,
+ * since we may not have their classes.
+ */
+static bool portable_serialize(SharedVariant *sv, StringBuffer &buf) {
+  if (sv->isSerialized()) {
+    portable_reserialize(sv->getSerialized(), buf);
+    return true;
+  }
+  switch (sv->getType()) {
+  case KindOfObject:
+    // converted by ApcAllowObj, and we'd need its class to write it out
+    return false;
+  case KindOfArray:
+    {
+      VariableSerializer vs(VariableSerializer::Serialize);
+      buf.append("a:");
+      buf.append((int64_t)sv->arrSize());
+      buf.append(":{");
+      for (size_t i = 0; i < sv->arrSize(); i++) {
+        buf.append(vs.serialize(sv->getKey(i), true));
+        if (!portable_serialize(sv->getValue(i), buf)) return false;
+      }
+      buf.append('}');
+      return true;
+    }
+  default:
+    {
+      VariableSerializer vs(VariableSerializer::Serialize);
+      buf.append(vs.serialize(sv->toLocal(), true));
+      return true;
+    }
+  }
+}
+
+bool apc_portable_serialize(SharedVariant *sv, String &out,
+                            bool &serializedObj) {
+  try {
+    StringBuffer buf;
+    if (!portable_serialize(sv, buf)) return false;
+    serializedObj = sv->is(KindOfObject);
+    if (serializedObj) {
+      // The store unserializes this to the serialized object, like
+      // primed objects.
+      VariableSerializer vs(VariableSerializer::Serialize);
+      out = vs.serialize(buf.detach(), true);
+    } else {
+      out = buf.detach();
+    }
+    return true;
+  } catch (Exception &e) {
+    return false;
+  }
+}
+
+String apc_portable_reserialize(CStrRef str) {
+  StringBuffer buf;
+  portable_reserialize(str.get(), buf);
+  return buf.detach();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// snapshots
+
+bool apc_save_snapshot() {
+  if (RuntimeOption::ApcSnapshotPath.empty() || !RuntimeOption::EnableApc) {
+    return false;
+  }
+  Timer timer(Timer::WallTime, "writing apc snapshot");
+  SharedStoreSnapshot snapshot(RuntimeOption::ApcSnapshotPath);
+  if (!snapshot.create()) return false;
+  if (s_apc_store[0].writeSnapshot(snapshot) < 0) {
+    Logger::Warning("This apc table type can't write snapshots");
+    return false;
+  }
+  return snapshot.commit();
+}
+
+bool apc_adopt_snapshot() {
+  if (RuntimeOption::ApcSnapshotPath.empty() || !RuntimeOption::EnableApc) {
+    return false;
+  }
+  SharedStoreSnapshot snapshot(RuntimeOption::ApcSnapshotPath);
+  if (!snapshot.attach(RuntimeOption::ApcSnapshotMaxAge)) return false;
+  Timer timer(Timer::WallTime, "adopting apc snapshot");
+  int count = s_apc_store[0].adoptSnapshot(snapshot);
+  if (count < 0) {
+    Logger::Warning("This apc table type can't adopt snapshots");
+    return false;
+  }
+  Logger::Info("Adopted %d keys from apc snapshot %s, %ds old", count,
+               RuntimeOption::ApcSnapshotPath.c_str(),
+               (int)(time(nullptr) - snapshot.created()));
+  return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // debugging support
 
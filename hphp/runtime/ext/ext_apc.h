@@ -119,6 +119,16 @@ static_assert(sizeof(int64_t) == sizeof(long long),
 String apc_serialize(CVarRef value);
 Variant apc_unserialize(CStrRef str);
 String apc_reserialize(CStrRef str);
+// serialize() data that means the same thing in another process
+bool apc_portable_serialize(SharedVariant *sv, String &out,
+                            bool &serializedObj);
+String apc_portable_reserialize(CStrRef str);
+
+///////////////////////////////////////////////////////////////////////////////
+// snapshots to carry APC over a restart (see APC.Snapshot)
+
+bool apc_save_snapshot();
+bool apc_adopt_snapshot();
 
 ///////////////////////////////////////////////////////////////////////////////
 // debugging support
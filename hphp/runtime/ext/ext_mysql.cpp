@@ -23,6 +23,7 @@
 #include <runtime/base/runtime_option.h>
 #include <runtime/base/server/server_stats.h>
 #include <runtime/base/util/request_local.h>
+#include <runtime/base/util/request_string_table.h>
 #include <runtime/base/util/extended_logger.h>
 #include <util/timer.h>
 #include <util/db_mysql.h>
@@ -1190,6 +1191,15 @@ bool f_mysql_data_seek(CVarRef result, int row) {
 #define MYSQL_NUM    1 << 1
 #define MYSQL_BOTH   (MYSQL_ASSOC|MYSQL_NUM)
 
+// Every row of a result has the same column names.
+static String php_mysql_field_name(const MYSQL_FIELD *field) {
+  if (StringData *name =
+      RequestStringTable::Intern(field->name, field->name_length)) {
+    return name;
+  }
+  return String(field->name, field->name_length, CopyString);
+}
+
 static Variant php_mysql_fetch_hash(CVarRef result, int result_type) {
   if ((result_type & MYSQL_BOTH) == 0) {
     throw_invalid_argument("result_type: %d", result_type);
@@ -1240,7 +1250,7 @@ static Variant php_mysql_fetch_hash(CVarRef result, int result_type) {
       ret.set(i, data);
     }
     if (result_type & MYSQL_ASSOC) {
-      ret.set(String(mysql_field->name, CopyString), data);
+      ret.set(php_mysql_field_name(mysql_field), data);
     }
   }
   return ret;
@@ -1414,7 +1424,7 @@ Variant f_mysql_async_fetch_array(CVarRef result, int result_type /* = 1 */) {
       ret.set(i, data);
     }
     if (result_type & MYSQL_ASSOC) {
-      ret.set(String(mysql_field->name, CopyString), data);
+      ret.set(php_mysql_field_name(mysql_field), data);
     }
   }
 
@@ -1826,7 +1836,7 @@ void MySQLResult::setFieldCount(int64_t fields) {
 
 void MySQLResult::setFieldInfo(int64_t f, MYSQL_FIELD *field) {
   MySQLFieldInfo &info = m_fields[f];
-  info.name = NEW(Variant)(String(field->name, CopyString));
+  info.name = NEW(Variant)(php_mysql_field_name(field));
   info.table = NEW(Variant)(String(field->table, CopyString));
   info.def = NEW(Variant)(String(field->def, CopyString));
   info.max_length = (int64_t)field->max_length;
@@ -69,6 +69,7 @@
 #include "runtime/vm/name_value_table_wrapper.h"
 #include "runtime/vm/request_arena.h"
 #include "util/arena.h"
+#include "util/maphuge.h"
 
 using std::string;
 
@@ -523,6 +524,11 @@ class StackElms {
         throw std::runtime_error(
           std::string("VM stack initialization failed: ") + strerror(errno));
       }
+      // Leave the bottom huge page alone; protecting the surprise page
+      // would just split it again.
+      if (RuntimeOption::EvalMapStacksHuge && algnSz > kHugePageSize) {
+        hintHuge((char*)m_elms + kHugePageSize, algnSz - kHugePageSize);
+      }
     }
     return m_elms;
   }
@@ -3907,7 +3913,13 @@ inline void OPTBLD_INLINE VMExecutionContext::iopConcat(PC& pc) {
   Cell* c1 = m_stack.topC();
   Cell* c2 = m_stack.indC(1);
   if (IS_STRING_TYPE(c1->m_type) && IS_STRING_TYPE(c2->m_type)) {
-    tvCellAsVariant(c2) = concat(tvCellAsVariant(c2), tvCellAsCVarRef(c1));
+    StringData* s2 = c2->m_data.pstr;
+    if (s2->getCount() == 1) {
+      // The left side is a temporary, as in $a . $b . $c; append to it.
+      s2->append(c1->m_data.pstr->slice());
+    } else {
+      tvCellAsVariant(c2) = concat(tvCellAsVariant(c2), tvCellAsCVarRef(c1));
+    }
   } else {
     tvCellAsVariant(c2) = concat(tvCellAsVariant(c2).toString(),
                                  tvCellAsCVarRef(c1).toString());
@@ -184,8 +184,13 @@ concat_si(StringData* v1, int64_t v2) {
     int is_negative;
     intstart = conv_10(v2, &is_negative, intbuf + sizeof(intbuf), &len2);
   }
-  StringSlice s1 = v1->slice();
   StringSlice s2(intstart, len2);
+  if (v1->getCount() == 1) {
+    // As in concat_ss: nobody else can see v1, so grow it in place.
+    v1->append(s2);
+    return v1;
+  }
+  StringSlice s1 = v1->slice();
   StringData* ret = NEW(StringData)(s1, s2);
   ret->incRefCount();
   decRefStr(v1);
@@ -213,6 +213,13 @@ const int kNumServiceReqArgRegs =
    */ \
   REQ(RETRANSLATE_NO_IR) \
   \
+  /*
+   * A tracelet in the cold part of the TC has been entered
+   * Eval.JitHotTraceletThreshold times. Throw away its translations and
+   * redo them in ahot.
+   */ \
+  REQ(RETRANSLATE_HOT) \
+  \
   /*
    * Resume restarts execution at the current PC.  This is used after
    * an interpOne of an instruction that changes the PC, and in some
@@ -23,9 +23,12 @@
 #include <strings.h>
 #include <string>
 #include <queue>
+#include <atomic>
 
 #include "util/trace.h"
 #include "util/debug.h"
+#include "util/logger.h"
+#include "util/compatibility.h"
 #include "runtime/eval/runtime/file_repository.h"
 #include "system/lib/systemlib.h"
 #include "runtime/vm/treadmill.h"
@@ -155,6 +158,57 @@ bool TranslatorX64::replace() {
   return true;
 }
 
+/*
+ * Translations can't be freed or moved individually: other translations,
+ * Func prologue tables, fixup and unwind info all point into the middle
+ * of the TC. Instead we reclaim the space all at once, by switching new
+ * requests to an empty translator and letting the treadmill free the old
+ * one. Live code gets retranslated on demand, which compacts it as a
+ * side effect.
+ */
+static std::atomic<int64_t> s_nextReplaceCheckMs(0);
+
+bool TranslatorX64::maybeReplace() {
+  const uint32_t fullPercent = RuntimeOption::EvalJitTCReplaceFullPercent;
+  const uint32_t deadPercent = RuntimeOption::EvalJitTCReplaceDeadPercent;
+  if ((!fullPercent && !deadPercent) || s_replaceInFlight ||
+      this != nextTx64) {
+    return false;
+  }
+
+  // This runs at every requestExit; only one request per
+  // Eval.JitTCReplaceCheckMs gets to look at the TC.
+  timespec ts;
+  gettime(CLOCK_MONOTONIC, &ts);
+  int64_t now = int64_t(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+  int64_t next = s_nextReplaceCheckMs.load(std::memory_order_relaxed);
+  if (now < next ||
+      !s_nextReplaceCheckMs.compare_exchange_strong(
+        next, now + RuntimeOption::EvalJitTCReplaceCheckMs,
+        std::memory_order_relaxed)) {
+    return false;
+  }
+
+  auto percentUsed = [](const Asm& as) {
+    return 100 * size_t(as.code.frontier - as.code.base) / as.code.size;
+  };
+  size_t used = percentUsed(a) > percentUsed(astubs) ?
+    percentUsed(a) : percentUsed(astubs);
+  size_t codeBytes = (a.code.frontier - a.code.base) +
+    (ahot.code.frontier - ahot.code.base) +
+    (astubs.code.frontier - astubs.code.base);
+  size_t dead = codeBytes ? 100 * m_deadCodeBytes / codeBytes : 0;
+
+  if (fullPercent && (used >= fullPercent || isCodeFull())) {
+    Logger::Info("Replacing translation cache: %zu%% full", used);
+  } else if (deadPercent && dead >= deadPercent) {
+    Logger::Info("Replacing translation cache: %zu%% unreachable", dead);
+  } else {
+    return false;
+  }
+  return replace();
+}
+
 struct Tx64Annihilator {
   ~Tx64Annihilator() {
     if (nextTx64) {
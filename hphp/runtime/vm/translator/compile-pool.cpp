@@ -0,0 +1,140 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#include <algorithm>
+#include <set>
+
+#include "util/job_queue.h"
+#include "util/lock.h"
+#include "util/logger.h"
+#include "util/trace.h"
+#include "runtime/base/runtime_option.h"
+#include "runtime/base/thread_init_fini.h"
+#include "runtime/vm/translator/translator.h"
+#include "runtime/vm/translator/translator-x64.h"
+#include "runtime/vm/translator/compile-pool.h"
+
+namespace HPHP { namespace VM { namespace Transl {
+
+TRACE_SET_MOD(txlease);
+
+namespace CompilePool {
+
+struct PrologueJob {
+  Func* func;
+  int nPassed;
+};
+
+typedef std::pair<const Func*, int> PrologueKey;
+
+class CompileWorker : public JobQueueWorker<PrologueJob> {
+public:
+  virtual void doJob(PrologueJob job);
+  virtual void onThreadEnter() { init_thread_locals(); }
+  virtual void onThreadExit() { finish_thread_locals(); }
+};
+
+typedef JobQueueDispatcher<PrologueJob, CompileWorker> Dispatcher;
+
+// s_dispatcher is created on first use, since the pool size comes from
+// RuntimeOption. s_pending holds prologues that are queued but not yet
+// emitted, so a hot callee doesn't pile up duplicate jobs.
+static SimpleMutex s_lock;
+static Dispatcher* s_dispatcher;
+static std::set<PrologueKey> s_pending;
+static uint64_t s_numQueued;
+static uint64_t s_numCompiled;
+
+bool enabled() {
+  return RuntimeOption::EvalJitCompileThreads > 0 &&
+    RuntimeOption::RepoAuthoritative &&
+    RuntimeOption::EvalJit;
+}
+
+void CompileWorker::doJob(PrologueJob job) {
+  Lease& lease = Translator::WriteLease();
+  TCA start = nullptr;
+  if (lease.acquire(true)) {
+    // We aren't a request, so nothing keeps an old translator alive for
+    // us: use whichever one is current while we hold the lease, and
+    // don't leave tx64 pointing at it afterwards. Mid-replace, the
+    // prologue tables belong to neither, so drop the job; the next call
+    // will queue it again.
+    if (!Translator::ReplaceInFlight()) {
+      tx64 = nextTx64;
+      start = Translator::Get()->funcPrologue(job.func, job.nPassed);
+    }
+    // Drop without a hint: the request threads are the ones we want
+    // picking the lease up next, and we may be back for it in a moment.
+    lease.drop();
+    // Only clear tx64 once the lease is gone: drop() itself may call
+    // Translator::Get(), which would cache the translator in tx64 again.
+    tx64 = nullptr;
+  }
+  TRACE(2, "compile pool: prologue %s(%d) -> %p\n",
+        job.func->fullName()->data(), job.nPassed, start);
+
+  SimpleLock lock(s_lock);
+  s_pending.erase(PrologueKey(job.func, job.nPassed));
+  if (start) s_numCompiled++;
+}
+
+bool deferPrologue(Func* func, int nPassed) {
+  if (!enabled() || Translator::WriteLease().amOwner() ||
+      Translator::ReplaceInFlight()) {
+    return false;
+  }
+  // Prologues past numParams are all the same one, so fold their keys.
+  int paramIndex = std::min(nPassed, func->numParams() + 1);
+
+  SimpleLock lock(s_lock);
+  if (!s_pending.insert(PrologueKey(func, paramIndex)).second) return true;
+  if (!s_dispatcher) {
+    s_dispatcher = new Dispatcher(RuntimeOption::EvalJitCompileThreads,
+                                  true, 0, false, nullptr);
+    s_dispatcher->start();
+    Logger::Info("jit compile pool started with %d threads",
+                 (int)RuntimeOption::EvalJitCompileThreads);
+  }
+  PrologueJob job = { func, paramIndex };
+  s_dispatcher->enqueue(job);
+  s_numQueued++;
+  return true;
+}
+
+Stats getStats() {
+  SimpleLock lock(s_lock);
+  Stats stats = { s_numQueued, s_numCompiled, s_pending.size() };
+  return stats;
+}
+
+static void stopAtExit() {
+  Dispatcher* dispatcher;
+  {
+    SimpleLock lock(s_lock);
+    dispatcher = s_dispatcher;
+    s_dispatcher = nullptr;
+  }
+  if (dispatcher) {
+    dispatcher->stop();
+    delete dispatcher;
+  }
+}
+
+static InitFiniNode s_stopAtExit(stopAtExit, InitFiniNode::ProcessExit);
+
+}
+
+} } }
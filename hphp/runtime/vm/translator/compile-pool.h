@@ -0,0 +1,61 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#ifndef incl_RUNTIME_VM_TRANSLATOR_COMPILE_POOL_H_
+#define incl_RUNTIME_VM_TRANSLATOR_COMPILE_POOL_H_
+
+#include "runtime/vm/func.h"
+
+namespace HPHP { namespace VM { namespace Transl {
+
+/*
+ * The compile pool moves translation work off of request threads. When
+ * Eval.JitCompileThreads is nonzero, a request that needs a func
+ * prologue which hasn't been emitted yet queues it to the pool and
+ * keeps going through the interpreter, instead of waiting on the write
+ * lease and paying for the codegen itself. A pool thread takes the
+ * write lease, emits the prologue, and publishes it in the Func's
+ * prologue table, where the next call through fcallHelper or a bind-call
+ * stub picks it up.
+ *
+ * Only prologues can be compiled this way: tracelet translations guard
+ * on the types live in the frame that reaches them, and a pool thread
+ * has no frame to look at. The pool is only enabled in RepoAuthoritative
+ * mode, where Funcs are never freed out from under a queued job.
+ */
+namespace CompilePool {
+
+bool enabled();
+
+/*
+ * Hand the prologue for func called with nPassed arguments to the pool.
+ * Returns false if the caller should emit it synchronously: the pool is
+ * off, or the caller already owns the write lease. Queueing the same
+ * prologue twice is harmless.
+ */
+bool deferPrologue(Func* func, int nPassed);
+
+struct Stats {
+  uint64_t queued;
+  uint64_t compiled;
+  uint64_t pending;
+};
+Stats getStats();
+
+}
+
+} } }
+
+#endif
@@ -2049,10 +2049,9 @@ void CodeGenerator::cgLdObjMethod(IRInstruction *inst) {
   auto name      = inst->getSrc(1);
   auto actRec    = inst->getSrc(2);
   auto actRecReg = actRec->getReg();
-  CacheHandle handle = Transl::TargetCache::MethodCache::alloc();
+  CacheHandle handle = Transl::TargetCache::MethodCache::alloc(
+    getCurFunc(), name->getValStr());
 
-  // lookup in the targetcache
-  assert(MethodCache::kNumLines == 1);
   if (debug) {
     MethodCache::Pair p;
     static_assert(sizeof(p.m_value) == 8,
@@ -2061,21 +2060,39 @@ void CodeGenerator::cgLdObjMethod(IRInstruction *inst) {
                   "MethodCache::Pair::m_key assumed to be 8 bytes");
   }
 
-  // preload handle->m_value
-  m_as.loadq(rVmTl[handle + offsetof(MethodCache::Pair, m_value)], rScratch);
-  m_as.cmpq (rVmTl[handle + offsetof(MethodCache::Pair, m_key)], clsReg);
-  ifThenElse(CC_E, // if handle->key == cls
-             [&] { // then actReg->m_func = handle->value
-               m_as.storeq(rScratch, actRecReg[AROFF(m_func)]);
-             },
-             [&] { // else call slow path helper
-               cgCallHelper(m_as, (TCA)methodCacheSlowPath, InvalidReg,
-                            kSyncPoint,
-                            ArgGroup().addr(rVmTl, handle)
-                                      .ssa(actRec)
-                                      .ssa(name)
-                                      .ssa(cls));
-             });
+  // Check each entry of the targetcache in turn, preloading its
+  // m_value so a hit can store it straight into the ActRec. With stats on,
+  // each entry gets its own hit block so we can count the first entry as
+  // an inline hit and the others as pic hits, the same way
+  // MethodCache::lookup does for tx64.
+  auto* stats = Transl::TargetCache::methodCacheSiteStats(handle);
+  int const numHitBlocks = stats ? MethodCache::kNumEntries : 1;
+  Label hit[MethodCache::kNumEntries], done;
+  for (int i = 0; i < MethodCache::kNumEntries; ++i) {
+    auto const pairOff = handle + i * sizeof(MethodCache::Pair);
+    m_as.loadq(rVmTl[pairOff + offsetof(MethodCache::Pair, m_value)],
+               rScratch);
+    m_as.cmpq (rVmTl[pairOff + offsetof(MethodCache::Pair, m_key)], clsReg);
+    m_as.jcc  (CC_E, hit[stats ? i : 0]);
+  }
+  cgCallHelper(m_as, (TCA)methodCacheSlowPath, InvalidReg,
+               kSyncPoint,
+               ArgGroup().addr(rVmTl, handle)
+                         .ssa(actRec)
+                         .ssa(name)
+                         .ssa(cls));
+  m_as.jmp(done);
+  for (int i = 0; i < numHitBlocks; ++i) {
+asm_label(m_as, hit[i]);
+    m_as.storeq(rScratch, actRecReg[AROFF(m_func)]);
+    if (stats) {
+      m_as.movq(i == 0 ? &stats->inlineHits : &stats->picHits, rScratch);
+      m_as.lock();
+      m_as.incq(*rScratch);
+      if (i + 1 < numHitBlocks) m_as.jmp(done);
+    }
+  }
+asm_label(m_as, done);
 }
 
 void CodeGenerator::cgRetVal(IRInstruction* inst) {
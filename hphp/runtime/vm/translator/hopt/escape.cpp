@@ -0,0 +1,238 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "util/trace.h"
+#include "runtime/vm/translator/hopt/ir.h"
+#include "runtime/vm/translator/hopt/opt.h"
+#include "runtime/vm/translator/hopt/irfactory.h"
+
+namespace HPHP {
+namespace VM {
+namespace JIT {
+namespace {
+
+static const HPHP::Trace::Module TRACEMOD = HPHP::Trace::hhir;
+
+struct Use {
+  IRInstruction* inst;
+  unsigned srcNo;
+};
+
+typedef std::unordered_map<const SSATmp*, std::vector<Use>> UseMap;
+typedef std::unordered_set<const IRInstruction*> InstSet;
+
+/*
+ * Instructions that hand back a new reference to a value nobody else can
+ * see yet, built only from their consumed sources. If such a value never
+ * escapes, neither creating it nor counting references to it has any
+ * effect we need to keep.
+ *
+ * The AddElem family return their input array (or a copy of it), so they
+ * only count when that input is itself one of these; see canEliminate().
+ * Concat is limited to the cases with a specialized helper, which can't
+ * raise or call __toString.
+ */
+bool isAllocation(const IRInstruction* inst) {
+  switch (inst->getOpcode()) {
+    case NewArray:
+    case AddElemIntKey:
+    case AddNewElem:
+      return true;
+    case AddElemStrKey:
+      // The helper doesn't decref the key, so only take constant ones.
+      return inst->getSrc(1)->isConst();
+    case Concat: {
+      Type l = inst->getSrc(0)->getType();
+      Type r = inst->getSrc(1)->getType();
+      return (l.isString() && (r.isString() || r == Type::Int)) ||
+        (l == Type::Int && r.isString());
+    }
+    default:
+      return false;
+  }
+}
+
+/*
+ * The sources whose references an allocation takes over.
+ */
+std::vector<unsigned> consumedSrcs(const IRInstruction* inst) {
+  switch (inst->getOpcode()) {
+    case NewArray:      return {};
+    case AddElemIntKey:
+    case AddElemStrKey: return {0, 2};
+    case AddNewElem:
+    case Concat:        return {0, 1};
+    default:            not_reached();
+  }
+}
+
+bool isCopy(const IRInstruction* inst) {
+  return inst->getOpcode() == IncRef || inst->getOpcode() == Mov;
+}
+
+/*
+ * Follow IncRef and Mov back to the instruction that really produced tmp.
+ */
+IRInstruction* rootDef(const SSATmp* tmp) {
+  IRInstruction* def = tmp->getInstruction();
+  while (isCopy(def)) def = def->getSrc(0)->getInstruction();
+  return def;
+}
+
+/*
+ * Everything one allocation's result flows into: the copies made of it,
+ * the refcount operations applied to it, and the allocations that consume
+ * it. If anything else touches the value, it escapes and we leave it alone.
+ */
+struct Cluster {
+  std::vector<IRInstruction*> copies;
+  std::vector<IRInstruction*> refOps;
+  std::vector<IRInstruction*> consumers;
+  bool escapes;
+};
+
+Cluster findUses(IRInstruction* alloc, const UseMap& uses) {
+  Cluster c;
+  c.escapes = false;
+  std::vector<const SSATmp*> work(1, alloc->getDst());
+  while (!work.empty() && !c.escapes) {
+    const SSATmp* tmp = work.back();
+    work.pop_back();
+    auto it = uses.find(tmp);
+    if (it == uses.end()) continue;
+    for (const Use& use : it->second) {
+      IRInstruction* inst = use.inst;
+      switch (inst->getOpcode()) {
+        case IncRef:
+        case Mov:
+          c.copies.push_back(inst);
+          work.push_back(inst->getDst());
+          continue;
+        case DecRefNZ:
+          c.refOps.push_back(inst);
+          continue;
+        case DecRef:
+          // A DecRef that branches on zero is doing more than counting.
+          if (inst->isControlFlowInstruction()) break;
+          c.refOps.push_back(inst);
+          continue;
+        default:
+          if (isAllocation(inst)) {
+            auto srcs = consumedSrcs(inst);
+            if (std::find(srcs.begin(), srcs.end(), use.srcNo) != srcs.end()) {
+              c.consumers.push_back(inst);
+              continue;
+            }
+          }
+          break;
+      }
+      c.escapes = true;
+      break;
+    }
+  }
+  return c;
+}
+
+/*
+ * An allocation can go if its result doesn't escape, everything consuming
+ * it can go too, and dropping it doesn't change when a destructor runs.
+ * Its consumed sources get released at the allocation instead of when the
+ * result dies; that's only unobservable for types without destructors,
+ * unless the source is itself an allocation we're removing.
+ */
+bool canEliminate(const IRInstruction* alloc, const Cluster& c,
+                  const InstSet& live) {
+  if (c.escapes) return false;
+  for (const IRInstruction* consumer : c.consumers) {
+    if (!live.count(consumer)) return false;
+  }
+  for (unsigned i : consumedSrcs(alloc)) {
+    const SSATmp* src = alloc->getSrc(i);
+    if (live.count(rootDef(src))) continue;
+    if (src->getType().canRunDtor()) return false;
+  }
+  return true;
+}
+
+void erase(IRInstruction* inst) {
+  Block* block = inst->getBlock();
+  block->erase(block->iteratorTo(inst));
+}
+
+}
+
+void eliminateUnusedAllocations(Trace* trace, IRFactory* irFactory) {
+  UseMap uses;
+  std::vector<IRInstruction*> allocs;
+  forEachTraceInst(trace, [&](IRInstruction* inst) {
+    for (unsigned i = 0, n = inst->getNumSrcs(); i < n; ++i) {
+      uses[inst->getSrc(i)].push_back(Use{inst, i});
+    }
+    if (isAllocation(inst)) allocs.push_back(inst);
+  });
+  if (allocs.empty()) return;
+
+  std::unordered_map<const IRInstruction*, Cluster> clusters;
+  InstSet candidates;
+  for (IRInstruction* alloc : allocs) {
+    Cluster c = findUses(alloc, uses);
+    if (c.escapes) continue;
+    candidates.insert(alloc);
+    clusters[alloc] = std::move(c);
+  }
+
+  // Keeping one allocation can force us to keep the ones feeding it and
+  // the ones it feeds, so shrink the set until it stops changing.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (IRInstruction* alloc : allocs) {
+      if (!candidates.count(alloc)) continue;
+      if (!canEliminate(alloc, clusters[alloc], candidates)) {
+        candidates.erase(alloc);
+        changed = true;
+      }
+    }
+  }
+  if (candidates.empty()) return;
+
+  for (IRInstruction* alloc : allocs) {
+    if (!candidates.count(alloc)) continue;
+    FTRACE(3, "escape: removing {}\n", alloc->toString());
+    // Release the consumed sources that came from outside the cluster.
+    Block* block = alloc->getBlock();
+    auto pos = block->iteratorTo(alloc);
+    for (unsigned i : consumedSrcs(alloc)) {
+      SSATmp* src = alloc->getSrc(i);
+      if (candidates.count(rootDef(src)) || !src->getType().maybeCounted()) {
+        continue;
+      }
+      block->insert(pos, irFactory->gen(DecRef, src));
+    }
+    const Cluster& c = clusters[alloc];
+    for (IRInstruction* inst : c.refOps) erase(inst);
+    for (IRInstruction* inst : c.copies) erase(inst);
+    erase(alloc);
+  }
+  FTRACE(1, "escape: removed {} allocations\n", candidates.size());
+}
+
+} } }
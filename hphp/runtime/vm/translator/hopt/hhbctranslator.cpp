@@ -23,6 +23,7 @@
 #include "runtime/vm/stats.h"
 #include "runtime/vm/unit.h"
 #include "runtime/vm/runtime.h"
+#include "runtime/vm/debugger_hook.h"
 #include "runtime/vm/translator/hopt/irfactory.h"
 
 // Include last to localize effects to this file
@@ -1263,6 +1264,8 @@ void HhbcTranslator::emitFPushActRec(SSATmp* func,
   SSATmp* actRec = m_tb->genDefActRec(func, objOrClass, numArgs, invName);
   m_evalStack.push(actRec);
   spillStack(); // TODO(#2036900)
+  FpiInfo fpi = { logicalStackDepth(), objOrClass, invName };
+  m_fpiStack.push_back(fpi);
 }
 
 void HhbcTranslator::emitFPushCtor(int32_t numParams) {
@@ -1545,9 +1548,177 @@ void HhbcTranslator::emitFCallArray() {
   PUNT(FCallArray); // can't interpret one because of control flow
 }
 
+/*
+ * If the vector at pc is exactly <H PT:"name">, and name is a declared
+ * property that callee's class can see, returns the property's offset in
+ * $this. Subclasses keep a declared property at the same offset, so the
+ * offset is good for any $this callee can be called on. Returns -1
+ * otherwise.
+ */
+static int trivialThisPropOffset(const Func* callee, PC pc) {
+  Class* cls = callee->cls();
+  if (!cls || (callee->attrs() & AttrStatic)) return -1;
+  ImmVector vec = getImmVector(pc);
+  if (vec.numStackValues() != 0) return -1;
+  const uint8_t* p = vec.vec();
+  const uint8_t* end = p + vec.size();
+  if (end - p < 2 ||
+      LocationCode(*p++) != LH ||
+      MemberCode(*p++) != MPT) {
+    return -1;
+  }
+  int64_t strId = decodeMemberCodeImm(&p, MPT);
+  if (p != end) return -1;
+  const StringData* name = callee->unit()->lookupLitstrId(strId);
+  bool accessible;
+  Slot idx = cls->getDeclPropIndex(cls, name, accessible);
+  if (idx == kInvalidSlot || !accessible) return -1;
+  return cls->declPropOffset(idx);
+}
+
+/*
+ * A callee whose entire body is "return <literal>", "return $param",
+ * "return $this->prop" or "$this->prop = $param" doesn't need a frame:
+ * we can drop its ActRec and push the result directly. This only fires
+ * when dropping the arguments and the ActRec can't run a destructor,
+ * since there'd be no frame for the unwinder to find if one threw; in
+ * practice that means the ActRec's context is a class, null, or the
+ * caller's own $this. Getters and setters need the caller's $this, and
+ * fall back to the real call if the property is unset or a reference, or
+ * if a setter would overwrite a refcounted value.
+ */
+bool HhbcTranslator::tryInlineTrivialCall(uint32_t numParams,
+                                          const Func* callee,
+                                          const FpiInfo& fpi) {
+  if (!RuntimeOption::EvalHHIRInlineTrivialCalls) return false;
+  if (callee->numParams() != int(numParams) ||
+      callee->isGenerator() ||
+      callee->isClosureBody() ||
+      fpi.invName ||
+      m_evalStack.numCells() > numParams) {
+    return false;
+  }
+  // Anything that could intercept the callee's prologue, or stop at a
+  // breakpoint in its body, needs the real call.
+  if (callee->maybeIntercepted() ||
+      RuntimeOption::EvalJitEnableRenameFunction ||
+      (callee->attrs() & AttrDynamicInvoke) ||
+      isDebuggerAttachedProcess()) {
+    return false;
+  }
+
+  SSATmp* ctx = fpi.objOrClass;
+  if (ctx->getType().maybeCounted()) {
+    IRInstruction* def = ctx->getInstruction();
+    if (def->getOpcode() == IncRef) def = def->getSrc(0)->getInstruction();
+    if (def->getOpcode() != LdThis) return false;
+  }
+
+  const Unit* unit = callee->unit();
+  PC pc = unit->at(callee->base());
+  PC next = pc + instrLen(pc);
+
+  SSATmp* retVal = nullptr;
+  int32_t retParam = -1;   // the callee returns this parameter...
+  int32_t setParam = -1;   // ...or stores this one in $this->prop...
+  int propOffset = -1;     // ...or returns $this->prop
+  switch (Op(*pc)) {
+    case OpNull:   retVal = m_tb->genDefInitNull(); break;
+    case OpTrue:   retVal = m_tb->genDefConst(true); break;
+    case OpFalse:  retVal = m_tb->genDefConst(false); break;
+    case OpInt:    retVal = m_tb->genDefConst(getImm(pc, 0).u_I64A); break;
+    case OpDouble: retVal = m_tb->genDefConst(getImm(pc, 0).u_DA); break;
+    case OpString:
+      retVal = m_tb->genDefConst(unit->lookupLitstrId(getImm(pc, 0).u_SA));
+      break;
+    case OpCGetL:
+      if (Op(*next) == OpSetM) {
+        // CGetL $param; SetM <H PT:"prop">; PopC; Null; RetC
+        setParam = getImm(pc, 0).u_HA;
+        if (setParam >= int32_t(numParams)) return false;
+        propOffset = trivialThisPropOffset(callee, next);
+        if (propOffset == -1) return false;
+        next += instrLen(next);
+        if (Op(*next) != OpPopC) return false;
+        next += instrLen(next);
+        if (Op(*next) != OpNull) return false;
+        next += instrLen(next);
+        retVal = m_tb->genDefInitNull();
+        break;
+      }
+      retParam = getImm(pc, 0).u_HA;
+      if (retParam >= int32_t(numParams)) return false;
+      break;
+    case OpCGetM:
+      propOffset = trivialThisPropOffset(callee, pc);
+      if (propOffset == -1) return false;
+      break;
+    default:
+      return false;
+  }
+  if (Op(*next) != OpRetC) return false;
+  if (propOffset != -1 && !ctx->isA(Type::Obj)) return false;
+
+  for (uint32_t i = 0; i < numParams; ++i) {
+    if (callee->byRef(i)) return false;
+    Type type = top(Type::Gen, numParams - i - 1)->getType();
+    bool kept = int32_t(i) == retParam || int32_t(i) == setParam;
+    if (kept ? !type.subtypeOf(Type::Cell) : type.maybeCounted()) {
+      return false;
+    }
+  }
+
+  TRACE(2, "%u: inlining trivial call to %s\n", m_bcOff,
+        callee->fullName()->data());
+  // Event hooks (setprofile, the profilers) and timeouts are only noticed
+  // at runtime, through the surprise flags the callee's prologue would
+  // check. If any are set, let the interpreter make the call.
+  m_tb->genExitWhenSurprised(getExitSlowTrace());
+  SSATmp* propVal = nullptr;
+  if (propOffset != -1) {
+    // An unset property means __get/__set or a notice, and a reference
+    // would need unboxing; leave those to the real call. So does
+    // overwriting a refcounted value, since its destructor could run.
+    Block* exit = getExitSlowTrace()->front();
+    SSATmp* propAddr = m_tb->genLdPropAddr(ctx, cns(propOffset));
+    if (setParam >= 0) {
+      m_tb->gen(LdMem, Type::UncountedInit, exit, propAddr, cns(0));
+    } else {
+      m_tb->gen(CheckInitMem, exit, propAddr, cns(0));
+      propVal = m_tb->gen(LdMem, Type::Cell, exit, propAddr, cns(0));
+    }
+  }
+  SSATmp* params[numParams];
+  for (uint32_t i = 0; i < numParams; i++) {
+    params[numParams - i - 1] = popF();
+  }
+  if (setParam >= 0) {
+    // The property takes over the argument's reference.
+    m_tb->gen(StProp, ctx, cns(propOffset), params[setParam]);
+  } else if (propVal) {
+    retVal = m_tb->genIncRef(propVal);
+  }
+  // The ActRec has been in memory since its FPush; forget about it.
+  m_stackDeficit += kNumActRecCells;
+  if (ctx->getType().maybeCounted()) m_tb->genDecRef(ctx);
+  push(retParam >= 0 ? params[retParam] : retVal);
+  return true;
+}
+
 void HhbcTranslator::emitFCall(uint32_t numParams,
                                Offset returnBcOffset,
                                const Func* callee) {
+  // Find the matching FPush, if it was in this trace.
+  int32_t arDepth = logicalStackDepth() - numParams;
+  while (!m_fpiStack.empty() && m_fpiStack.back().stackDepth > arDepth) {
+    m_fpiStack.pop_back();
+  }
+  if (!m_fpiStack.empty() && m_fpiStack.back().stackDepth == arDepth) {
+    FpiInfo fpi = m_fpiStack.back();
+    m_fpiStack.pop_back();
+    if (callee && tryInlineTrivialCall(numParams, callee, fpi)) return;
+  }
+
   // pop the incoming parameters to the call
   SSATmp* params[numParams];
   for (uint32_t i = 0; i < numParams; i++) {
@@ -541,6 +541,19 @@ private:
   template<class Lambda>
   SSATmp* emitIterInitCommon(int offset, Lambda genFunc);
 
+  /*
+   * An ActRec pushed by this trace whose FCall we haven't seen yet.
+   * stackDepth is the logical stack depth just above the ActRec, which
+   * is how FCall matches itself up with the push.
+   */
+  struct FpiInfo {
+    int32_t stackDepth;
+    SSATmp* objOrClass;
+    const StringData* invName;
+  };
+  bool tryInlineTrivialCall(uint32_t numParams, const Func* callee,
+                            const FpiInfo& fpi);
+
   /*
    * Accessors for the current function being compiled and its
    * class and unit.
@@ -582,6 +595,9 @@ private:
   std::vector<SSATmp*> getSpillValues() const;
   SSATmp* spillStack();
   SSATmp* loadStackAddr(int32_t offset);
+  int32_t logicalStackDepth() {
+    return m_tb->getSpOffset() + m_evalStack.numCells() - m_stackDeficit;
+  }
   SSATmp* top(Type type, uint32_t index = 0);
   void    extendStack(uint32_t index, Type type);
   void    replace(uint32_t index, SSATmp* tmp);
@@ -613,6 +629,7 @@ private:
    */
   uint32_t          m_stackDeficit;
   EvalStack         m_evalStack;
+  std::vector<FpiInfo> m_fpiStack;
 
   vector<TypeGuard> m_typeGuards;
   Trace* const      m_exitGuardFailureTrace;
@@ -1553,6 +1553,9 @@ TranslatorX64::irTranslateTracelet(Tracelet&               t,
                             TOO_MANY_TRANSLATIONS);
 
     irEmitResolvedDeps(t.m_resolvedDeps);
+    // The entry counter is plain asm ahead of the trace; the guards and
+    // body that follow go through the IR and are emitted at codegen.
+    emitHotTraceletCounter(a, sk, srcRec);
     emitGuardChecks(a, sk, t.m_dependencies, t.m_refDeps, srcRec);
 
     dumpTranslationInfo(t, a.code.frontier);
@@ -107,6 +107,10 @@ void optimizeTrace(Trace* trace, TraceBuilder* traceBuilder) {
     optimizeMemoryAccesses(trace, irFactory);
     finishPass("after MemeLim");
   }
+  if (RuntimeOption::EvalHHIREscapeOpt) {
+    eliminateUnusedAllocations(trace, irFactory);
+    finishPass("after escape opt");
+  }
   if (RuntimeOption::EvalHHIRDeadCodeElim) {
     eliminateDeadCode(trace, irFactory);
     finishPass("after DCE");
@@ -27,6 +27,7 @@ class IRInstruction;
  * The main optimization passes, in the order they run.
  */
 void optimizeMemoryAccesses(Trace*, IRFactory*);
+void eliminateUnusedAllocations(Trace*, IRFactory*);
 void eliminateDeadCode(Trace*, IRFactory*);
 void optimizeJumps(Trace*, IRFactory*);
 
@@ -76,7 +76,8 @@ void SrcRec::emitFallbackJump(Asm &a, TCA from, int cc /* = -1 */) {
   m_inProgressTailJumps.push_back(incoming);
 }
 
-void SrcRec::newTranslation(Asm& a, Asm &astubs, TCA newStart) {
+void SrcRec::newTranslation(Asm& a, Asm &astubs, TCA newStart,
+                            size_t codeBytes) {
   // When translation punts due to hitting limit, will generate one
   // more translation that will call the interpreter.
   assert(m_translations.size() <= kMaxTranslations);
@@ -84,6 +85,7 @@ void SrcRec::newTranslation(Asm& a, Asm &astubs, TCA newStart) {
   TRACE(1, "SrcRec(%p)::newTranslation @%p, ", this, newStart);
 
   m_translations.push_back(newStart);
+  m_codeBytes += codeBytes;
   if (!m_topTranslation) {
     atomic_release_store(&m_topTranslation, newStart);
     patchIncomingBranches(a, astubs, newStart);
@@ -151,13 +153,16 @@ void SrcRec::patchIncomingBranches(Asm& a, Asm &astubs, TCA newStart) {
   }
 }
 
-void SrcRec::replaceOldTranslations(Asm& a, Asm& astubs) {
+size_t SrcRec::replaceOldTranslations(Asm& a, Asm& astubs) {
   // Everyone needs to give up on old translations; send them to the anchor,
   // which is a REQ_RETRANSLATE
   m_translations.clear();
   m_tailFallbackJumps.clear();
   atomic_release_store(&m_topTranslation, static_cast<TCA>(0));
   patchIncomingBranches(a, astubs, m_anchorTranslation);
+  size_t deadBytes = m_codeBytes;
+  m_codeBytes = 0;
+  return deadBytes;
 }
 
 void SrcRec::patch(Asm* a, IncomingBranch branch, TCA dest) {
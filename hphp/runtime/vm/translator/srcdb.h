@@ -59,6 +59,8 @@ struct SrcRec {
     : m_topTranslation(nullptr)
     , m_anchorTranslation(0)
     , m_dbgBranchGuardSrc(nullptr)
+    , m_codeBytes(0)
+    , m_hot(false)
   {}
 
   /*
@@ -81,11 +83,16 @@ struct SrcRec {
   void setFuncInfo(const Func* f);
   void chainFrom(Asm& a, IncomingBranch br);
   void emitFallbackJump(Asm &a, TCA from, int cc = -1);
-  void newTranslation(Asm& a, Asm &astubs, TCA newStart);
-  void replaceOldTranslations(Asm& a, Asm& astubs);
+  void newTranslation(Asm& a, Asm &astubs, TCA newStart,
+                      size_t codeBytes);
+  // Returns the number of bytes of code made unreachable.
+  size_t replaceOldTranslations(Asm& a, Asm& astubs);
   void addDebuggerGuard(Asm& a, Asm &astubs, TCA dbgGuard,
                         TCA m_dbgBranchGuardSrc);
   bool hasDebuggerGuard() const { return m_dbgBranchGuardSrc != nullptr; }
+  // Hot SrcRecs get their translations emitted in ahot.
+  bool isHot() const { return m_hot; }
+  void setHot() { m_hot = true; }
   const MD5& unitMd5() const { return m_unitMd5; }
 
   const vector<TCA>& translations() const {
@@ -138,6 +145,9 @@ private:
   MD5 m_unitMd5;
   // The branch src for the debug guard, if this has one.
   TCA m_dbgBranchGuardSrc;
+  // Bytes of code, in a and astubs, belonging to m_translations.
+  size_t m_codeBytes;
+  bool m_hot;
 };
 
 /*
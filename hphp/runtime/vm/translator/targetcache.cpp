@@ -13,12 +13,19 @@
    | license@php.net so we can mail you a copy immediately.               |
    +----------------------------------------------------------------------+
 */
+#include <algorithm>
+#include <sstream>
 #include <string>
 #include <stdio.h>
 #include <sys/mman.h>
 
+#include "folly/Format.h"
+
 #include <util/trace.h>
+#include <util/atomic.h>
 #include <util/base.h>
+#include <util/hash.h>
+#include <util/lock.h>
 #include <util/maphuge.h>
 #include <runtime/base/complex_types.h>
 #include <runtime/base/execution_context.h>
@@ -308,6 +315,8 @@ invalidateForRename(const StringData* name) {
   }
 }
 
+static void initMethodCacheStats();
+
 void initPersistentCache() {
   Lock l(s_handleMutex);
   if (s_tc_fd) return;
@@ -320,6 +329,7 @@ void initPersistentCache() {
   ftruncate(s_tc_fd,
             RuntimeOption::EvalJitTargetCacheSize - s_persistent_start);
   s_persistent_frontier = s_persistent_start;
+  initMethodCacheStats();
 }
 
 void threadInit() {
@@ -438,11 +448,103 @@ const Func* FixedFuncCache::lookupUnknownFunc(StringData* name) {
 //=============================================================================
 // MethodCache
 
-template<>
-inline int
-MethodCache::hashKey(uintptr_t c) {
-  pointer_hash<Class> h;
-  return h(reinterpret_cast<const Class*>(c));
+// Site stats, indexed by handle / sizeof(MethodCache) so the lookup and
+// slow paths find a site's counters without searching. The index is
+// allocated once, in initPersistentCache; sites are only ever added, by
+// the translator with the write lease held, and the records are never
+// freed.
+static MethodCacheSiteStats** s_methodCacheSites;
+static std::vector<MethodCacheSiteStats*> s_methodCacheSiteList;
+static Mutex s_methodCacheSiteLock;
+
+static void initMethodCacheStats() {
+  if (!RuntimeOption::EvalJitMethodCacheStats) return;
+  s_methodCacheSites = (MethodCacheSiteStats**)calloc(
+    RuntimeOption::EvalJitTargetCacheSize / sizeof(MethodCache),
+    sizeof(MethodCacheSiteStats*));
+}
+
+CacheHandle
+MethodCache::alloc(const Func* caller, const StringData* name) {
+  CacheHandle handle = namedAlloc<NSInvalid>(nullptr, sizeof(MethodCache),
+                                             sizeof(MethodCache));
+  if (s_methodCacheSites) {
+    MethodCacheSiteStats* stats = new MethodCacheSiteStats();
+    memset(stats, 0, sizeof(*stats));
+    stats->caller = caller;
+    stats->name = name;
+    s_methodCacheSites[handle / sizeof(MethodCache)] = stats;
+    Lock l(s_methodCacheSiteLock);
+    s_methodCacheSiteList.push_back(stats);
+  }
+  return handle;
+}
+
+MethodCacheSiteStats* methodCacheSiteStats(CacheHandle chand) {
+  if (!s_methodCacheSites) return nullptr;
+  return s_methodCacheSites[chand / sizeof(MethodCache)];
+}
+
+std::string dumpMethodCacheStats() {
+  std::vector<MethodCacheSiteStats> sites;
+  {
+    Lock l(s_methodCacheSiteLock);
+    for (auto* site : s_methodCacheSiteList) sites.push_back(*site);
+  }
+  // Most expensive sites first.
+  std::sort(sites.begin(), sites.end(),
+            [](const MethodCacheSiteStats& a, const MethodCacheSiteStats& b) {
+              return a.misses + a.megaHits > b.misses + b.megaHits;
+            });
+  std::ostringstream out;
+  out << folly::format("{:>12} {:>12} {:>12} {:>12} {:>12}  {}\n",
+                       "inline", "pic", "slow", "mega", "miss", "site");
+  for (auto const& site : sites) {
+    out << folly::format("{:>12} {:>12} {:>12} {:>12} {:>12}  {}->{}()\n",
+                         site.inlineHits, site.picHits, site.slowHits,
+                         site.megaHits, site.misses,
+                         site.caller->fullName()->data(),
+                         site.name->data());
+  }
+  return out.str();
+}
+
+/*
+ * Cache for call sites that see more receiver classes than fit in their
+ * MethodCache, shared by all sites. The context class is part of the key
+ * since it decides which private methods are visible. It lives in the
+ * non-persistent part of the target cache, which requestInit zeroes, so
+ * entries never outlive the request that filled them.
+ */
+struct MegaMethodCache {
+  static const int kNumEntries = 256;
+
+  struct Entry {
+    uintptr_t         m_key; // Class* | static bit | magic bit
+    const StringData* m_name;
+    const Class*      m_ctx;
+    const Func*       m_func;
+  } m_entries[kNumEntries];
+
+  static Entry* entryFor(const Class* cls, const StringData* name,
+                         const Class* ctx) {
+    static const CacheHandle handle =
+      namedAlloc<NSInvalid>(nullptr, sizeof(MegaMethodCache), 64);
+    MegaMethodCache* thiz = handleToPtr<MegaMethodCache>(handle);
+    size_t h = hash_int64_pair(uintptr_t(cls) ^ uintptr_t(ctx),
+                               uintptr_t(name));
+    return &thiz->m_entries[h & (kNumEntries - 1)];
+  }
+};
+
+static inline void
+methodCacheInsert(MethodCache* cache, uintptr_t key, const Func* func) {
+  auto* pairs = cache->m_pairs;
+  for (int i = MethodCache::kNumEntries - 1; i > 0; --i) {
+    pairs[i] = pairs[i - 1];
+  }
+  pairs[0].m_key = key;
+  pairs[0].m_value = func;
 }
 
 /*
@@ -461,46 +563,78 @@ void methodCacheSlowPath(MethodCache::Pair* mce,
   assert(ar->getThis()->getVMClass() == cls);
   assert(IMPLIES(mce->m_key, mce->m_value));
 
+  auto* cache = reinterpret_cast<MethodCache*>(mce);
+  MethodCacheSiteStats* stats = nullptr;
+  if (UNLIKELY(RuntimeOption::EvalJitMethodCacheStats)) {
+    stats = methodCacheSiteStats(ptrToHandle(cache));
+  }
+
   try {
-    bool isMagicCall = mce->m_key & 0x1u;
-    bool isStatic;
-    const Func* func;
-
-    auto* storedClass = reinterpret_cast<Class*>(mce->m_key & ~0x3u);
-    if (storedClass == cls) {
-      isStatic = mce->m_key & 0x2u;
-      func = mce->m_value;
-    } else {
+    bool isMagicCall = false;
+    bool isStatic = false;
+    const Func* func = nullptr;
+
+    // One of the entries may still match if it has a flag bit set.
+    for (int i = 0; i < MethodCache::kNumEntries; ++i) {
+      auto const& pair = cache->m_pairs[i];
+      if ((pair.m_key & ~uintptr_t(0x3)) == uintptr_t(cls)) {
+        isMagicCall = pair.m_key & 0x1u;
+        isStatic = pair.m_key & 0x2u;
+        func = pair.m_value;
+        if (stats) atomic_inc(stats->picHits);
+        break;
+      }
+    }
+
+    if (!func) {
+      auto* storedClass = reinterpret_cast<Class*>(mce->m_key & ~0x3u);
+      MegaMethodCache::Entry* mega = nullptr;
       if (LIKELY(storedClass != nullptr &&
-                 ((func = cls->wouldCall(mce->m_value)) != nullptr) &&
-                 !isMagicCall)) {
+                 !(mce->m_key & 0x1u) &&
+                 ((func = cls->wouldCall(mce->m_value)) != nullptr))) {
         Stats::inc(Stats::TgtCache_MethodHit, func != nullptr);
+        if (stats) atomic_inc(stats->slowHits);
         isMagicCall = false;
       } else {
         Class* ctx = arGetContextClass((ActRec*)ar->m_savedRbp);
-        Stats::inc(Stats::TgtCache_MethodMiss);
-        TRACE(2, "MethodCache: miss class %p name %s!\n", cls, name->data());
-        func = g_vmContext->lookupMethodCtx(cls, name, ctx,
-                                            MethodLookup::ObjMethod, false);
-        if (UNLIKELY(!func)) {
-          isMagicCall = true;
-          func = cls->lookupMethod(s___call.get());
+        mega = MegaMethodCache::entryFor(cls, name, ctx);
+        if ((mega->m_key & ~uintptr_t(0x3)) == uintptr_t(cls) &&
+            mega->m_name == name && mega->m_ctx == ctx) {
+          isMagicCall = mega->m_key & 0x1u;
+          func = mega->m_func;
+          if (stats) atomic_inc(stats->megaHits);
+        } else {
+          Stats::inc(Stats::TgtCache_MethodMiss);
+          if (stats) atomic_inc(stats->misses);
+          TRACE(2, "MethodCache: miss class %p name %s!\n", cls,
+                name->data());
+          func = g_vmContext->lookupMethodCtx(cls, name, ctx,
+                                              MethodLookup::ObjMethod, false);
           if (UNLIKELY(!func)) {
-            // Do it again, but raise the error this time.
-            (void) g_vmContext->lookupMethodCtx(cls, name, ctx,
-                                                MethodLookup::ObjMethod, true);
-            NOT_REACHED();
+            isMagicCall = true;
+            func = cls->lookupMethod(s___call.get());
+            if (UNLIKELY(!func)) {
+              // Do it again, but raise the error this time.
+              (void) g_vmContext->lookupMethodCtx(cls, name, ctx,
+                                                  MethodLookup::ObjMethod,
+                                                  true);
+              NOT_REACHED();
+            }
+          } else {
+            isMagicCall = false;
           }
-        } else {
-          isMagicCall = false;
+          mega->m_name = name;
+          mega->m_ctx = ctx;
+          mega->m_func = func;
         }
       }
 
       isStatic = func->attrs() & AttrStatic;
 
-      mce->m_key = uintptr_t(cls) | (uintptr_t(isStatic) << 1) |
+      uintptr_t key = uintptr_t(cls) | (uintptr_t(isStatic) << 1) |
         uintptr_t(isMagicCall);
-      mce->m_value = func;
+      if (mega) mega->m_key = key;
+      methodCacheInsert(cache, key, func);
     }
 
     assert(func);
@@ -539,31 +673,31 @@ void methodCacheSlowPath(MethodCache::Pair* mce,
   }
 }
 
-template<>
 HOT_FUNC_VM
 void
 MethodCache::lookup(Handle handle, ActRec* ar, const void* extraKey) {
   assert(ar->hasThis());
   auto* cls = ar->getThis()->getVMClass();
-  auto* pair = MethodCache::cacheAtHandle(handle)->keyToPair(uintptr_t(cls));
+  auto* thiz = MethodCache::cacheAtHandle(handle);
 
   /*
-   * The MethodCache line consists of a Class* key (stored as a
-   * uintptr_t) and a Func*.  The low bit of the key is set if the
-   * function call is a magic call (in which case the cached Func* is
-   * the __call function).  The second lowest bit of the key is set if
-   * the cached Func has AttrStatic.
-   *
-   * For this fast path, we just check if the key is bitwise equal to
-   * the Class* on the object.  If either of the special bits are set
-   * in the key we'll bail to the slow path.
+   * For this fast path, we just check if one of the keys is bitwise
+   * equal to the Class* on the object.  If either of the special bits
+   * are set in the key we'll bail to the slow path.
    */
-  if (LIKELY(pair->m_key == reinterpret_cast<uintptr_t>(cls))) {
-    ar->m_func = pair->m_value;
-  } else {
-    auto* name = static_cast<const StringData*>(extraKey);
-    methodCacheSlowPath(pair, ar, const_cast<StringData*>(name), cls);
+  for (int i = 0; i < kNumEntries; ++i) {
+    if (LIKELY(thiz->m_pairs[i].m_key == reinterpret_cast<uintptr_t>(cls))) {
+      ar->m_func = thiz->m_pairs[i].m_value;
+      if (UNLIKELY(RuntimeOption::EvalJitMethodCacheStats)) {
+        if (auto* stats = methodCacheSiteStats(handle)) {
+          atomic_inc(i == 0 ? stats->inlineHits : stats->picHits);
+        }
+      }
+      return;
+    }
   }
+  auto* name = static_cast<const StringData*>(extraKey);
+  methodCacheSlowPath(thiz->m_pairs, ar, const_cast<StringData*>(name), cls);
 }
 
 //=============================================================================
@@ -234,8 +234,61 @@ struct StaticMethodFCache {
 
 typedef Cache<const StringData*, const Func*, StringData*, NSDynFunction>
   FuncCache;
-typedef Cache<uintptr_t, const Func*, ActRec*, NSInvalid, 1, void>
-  MethodCache;
+
+/*
+ * MethodCache --
+ *
+ *   Polymorphic inline cache for an FPushObjMethodD call site. The
+ *   translated code compares the receiver's Class* against each of the
+ *   kNumEntries keys in turn, most recently filled first, and only calls
+ *   out to methodCacheSlowPath when none of them match.
+ *
+ *   A key is a Class* with two flag bits: the low bit is set if the call
+ *   is a magic call (in which case the cached Func* is __call), and the
+ *   second lowest bit is set if the cached Func has AttrStatic. Since the
+ *   inline check compares against the bare Class*, either bit sends us
+ *   to the slow path.
+ *
+ *   The slow path consults a per-request megamorphic cache keyed on
+ *   (Class*, name, context class) before doing a full method lookup, so
+ *   that sites with more than kNumEntries receiver classes don't pay for
+ *   a lookup every time they cycle through them.
+ */
+struct MethodCache {
+  static const int kNumEntries = 4;
+
+  struct Pair {
+    uintptr_t   m_key;
+    const Func* m_value;
+  } m_pairs[kNumEntries];
+
+  static inline MethodCache* cacheAtHandle(CacheHandle handle) {
+    return (MethodCache*)handleToPtr(handle);
+  }
+
+  static CacheHandle alloc(const Func* caller, const StringData* name);
+  static void lookup(CacheHandle chand, ActRec* ar, const void* extraKey);
+};
+
+/*
+ * Per-site MethodCache counters, collected when Eval.JitMethodCacheStats
+ * is set. inlineHits are receivers that matched the first entry and
+ * picHits ones that matched another entry; the IR counts both in the
+ * code it emits, tx64 in MethodCache::lookup. slowHits are receivers the
+ * slow path resolved to the cached Func without a lookup.
+ */
+struct MethodCacheSiteStats {
+  const Func* caller;
+  const StringData* name;
+  uint64_t inlineHits;
+  uint64_t picHits;
+  uint64_t slowHits;
+  uint64_t megaHits;
+  uint64_t misses;
+};
+
+MethodCacheSiteStats* methodCacheSiteStats(CacheHandle chand);
+std::string dumpMethodCacheStats();
 typedef Cache<StringData*, const Class*, StringData*, NSClass> ClassCache;
 
 /*
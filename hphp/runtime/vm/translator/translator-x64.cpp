@@ -80,6 +80,8 @@ typedef __sighandler_t *sighandler_t;
 #include "runtime/vm/translator/srcdb.h"
 #include "runtime/vm/translator/x64-util.h"
 #include "runtime/vm/translator/unwind-x64.h"
+#include "runtime/vm/translator/warmup-profile.h"
+#include "runtime/vm/translator/compile-pool.h"
 #include "runtime/vm/stats.h"
 #include "runtime/vm/pendq.h"
 #include "runtime/vm/treadmill.h"
@@ -1267,6 +1269,37 @@ TCA TranslatorX64::retranslateAndPatchNoIR(SrcKey sk,
   return start;
 }
 
+/*
+ * Only use comes from REQ_RETRANSLATE_HOT, raised by the counter that
+ * emitHotTraceletCounter puts in front of cold translations. Everything
+ * already in sk's chain becomes garbage, and the chain is rebuilt in
+ * ahot as it gets re-entered. If we can't do that now, counter is reset
+ * so the tracelet asks again after another threshold's worth of entries.
+ */
+TCA TranslatorX64::retranslateHot(SrcKey sk, uint32_t* counter) {
+  LeaseHolder writer(s_writeLease);
+  if (!writer) {
+    *counter = 0;
+    return nullptr;
+  }
+  SrcRec* sr = getSrcRec(sk);
+  if (sr->isHot() || sr->hasDebuggerGuard()) {
+    *counter = 0;
+    return sr->getTopTranslation();
+  }
+  // Without room in ahot the new translation would land in a again, and
+  // all we'd have done is thrown away working code.
+  if (!ahotHasRoom()) {
+    SKTRACE(1, sk, "retranslateHot: ahot is full\n");
+    *counter = 0;
+    return sr->getTopTranslation();
+  }
+  SKTRACE(1, sk, "retranslateHot\n");
+  sr->setHot();
+  m_deadCodeBytes += sr->replaceOldTranslations(a, astubs);
+  return translate(sk, true, true);
+}
+
 /*
  * Satisfy an alignment constraint. If we're in a reachable section
  * of code, bridge the gap with nops. Otherwise, int3's.
@@ -1420,12 +1453,33 @@ TranslatorX64::lookupTranslation(SrcKey sk) const {
   return nullptr;
 }
 
+/*
+ * The assemblers can't back out of running off the end of a code block
+ * partway through a tracelet, so we stop translating while there is
+ * still this much room left in a and astubs; from then on everything
+ * new gets interpreted.
+ */
+static const size_t kMinFreeCodeBytes = 1 << 20;
+
+bool
+TranslatorX64::isCodeFull() const {
+  auto freeBytes = [](const Asm& as) {
+    return size_t(as.code.base + as.code.size - as.code.frontier);
+  };
+  return freeBytes(a) < kMinFreeCodeBytes ||
+    freeBytes(astubs) < kMinFreeCodeBytes;
+}
+
 TCA
 TranslatorX64::translate(SrcKey sk, bool align, bool allowIR) {
   bool useHHIR = allowIR && RuntimeOption::EvalJitUseIR;
   INC_TPC(translate);
   assert(((uintptr_t)vmsp() & (sizeof(Cell) - 1)) == 0);
   assert(((uintptr_t)vmfp() & (sizeof(Cell) - 1)) == 0);
+  if (isCodeFull()) {
+    SKTRACE(1, sk, "translate: out of code space\n");
+    return nullptr;
+  }
 
   if (useHHIR) {
     if (m_numHHIRTrans == RuntimeOption::EvalMaxHHIRTrans) {
@@ -1438,7 +1492,9 @@ TranslatorX64::translate(SrcKey sk, bool align, bool allowIR) {
     assert(m_useHHIR == false);
   }
 
-  AHotSelector ahs(this, curFunc()->attrs() & AttrHot);
+  SrcRec* sr = m_srcDB.find(sk);
+  AHotSelector ahs(this, (curFunc()->attrs() & AttrHot) ||
+                         (sr && sr->isHot()));
 
   if (align) {
     moveToAlign(a, kNonFallthroughAlign);
@@ -2091,8 +2147,14 @@ TranslatorX64::funcPrologue(Func* func, int nPassed, ActRec* ar) {
   // If the translator is getting replaced out from under us, refuse to
   // provide a prologue; we don't know whether this request is running on the
   // old or new context.
+  if (s_replaceInFlight) return nullptr;
+
+  // Let the compile pool emit it, if there is one; the caller will
+  // interpret this call and find the prologue in place on a later one.
+  if (CompilePool::deferPrologue(func, nPassed)) return nullptr;
+
   LeaseHolder writer(s_writeLease);
-  if (!writer || s_replaceInFlight) return nullptr;
+  if (!writer || s_replaceInFlight || isCodeFull()) return nullptr;
   // Double check the prologue array now that we have the write lease
   // in case another thread snuck in and set the prologue already.
   if (checkCachedPrologue(func, paramIndex, prologue)) return prologue;
@@ -2178,6 +2240,7 @@ TranslatorX64::funcPrologue(Func* func, int nPassed, ActRec* ar) {
         this, func->fullName()->data(), nPassed, start);
   assert(isValidCodeAddress(start));
   func->setPrologue(paramIndex, start);
+  WarmupProfile::recordPrologue(func, paramIndex);
 
   addTranslation(TransRec(skFuncBody, func->unit()->md5(),
                           TransProlog, aStart, a.code.frontier - aStart,
@@ -3398,6 +3461,12 @@ bool TranslatorX64::handleServiceRequest(TReqInfo& info,
     SKTRACE(2, sk, "retranslated @%p\n", start);
   } break;
 
+  case REQ_RETRANSLATE_HOT: {
+    sk = SrcKey(curFunc(), (Offset)args[0]);
+    start = retranslateHot(sk, (uint32_t*)args[1]);
+    SKTRACE(1, sk, "retranslated hot @%p\n", start);
+  } break;
+
   case REQ_INTERPRET: {
     Offset off = args[0];
     int numInstrs = args[1];
@@ -3650,6 +3719,37 @@ TranslatorX64::emitTransCounterInc(X64Assembler& a) {
   return start;
 }
 
+/*
+ * Count entries into a translation that isn't going into ahot, and ask
+ * for it to be moved there once it proves hot. Once ahot fills up we
+ * stop emitting counters, and retranslateHot ignores the ones already
+ * out there. The counter lives in m_globalData and isn't updated
+ * atomically: losing the odd increment only delays promotion. Since
+ * racing increments can step over the threshold, we test with >=;
+ * retranslateHot resets the counter when promotion fails (e.g., for
+ * want of the write lease), so the tracelet asks again later instead of
+ * on every entry.
+ *
+ * Both translateTracelet and irTranslateTracelet call this before their
+ * guards, so tx64 and HHIR translations are counted alike.
+ */
+void
+TranslatorX64::emitHotTraceletCounter(Asm& a, SrcKey sk, const SrcRec& sr) {
+  const uint32_t threshold = RuntimeOption::EvalJitHotTraceletThreshold;
+  if (!threshold || sr.isHot() || !ahotHasRoom() ||
+      !m_globalData.canEmit(sizeof(uint32_t))) {
+    return;
+  }
+  uint32_t* counter = m_globalData.alloc<uint32_t>(sizeof(uint32_t));
+  *counter = 0;
+  TCA req = emitServiceReq(REQ_RETRANSLATE_HOT, 2ull, uint64_t(sk.offset()),
+                           uint64_t(counter));
+  a.    movq (counter, rScratch);
+  a.    incl (*rScratch);
+  a.    cmpl (threshold, *rScratch);
+  a.    jcc  (CC_AE, req);
+}
+
 void
 TranslatorX64::spillTo(DataType type, PhysReg reg, bool writeType,
                        PhysReg base, int disp) {
@@ -9080,7 +9180,7 @@ TranslatorX64::translateFPushObjMethodD(const Tracelet &t,
   } else {
     emitVStackStore(a, i, getReg(objLoc), thisOff, sz::qword);
     using namespace TargetCache;
-    CacheHandle ch = MethodCache::alloc();
+    CacheHandle ch = MethodCache::alloc(curFunc(), name);
     if (false) { // typecheck
       ActRec* ar = nullptr;
       MethodCache::lookup(ch, ar, name);
@@ -11404,6 +11504,7 @@ TranslatorX64::translateTracelet(SrcKey sk, bool considerHHIR/*=true*/,
         return translateTracelet(sk, false);
       }
 
+      emitHotTraceletCounter(a, t.m_sk, srcRec);
       emitGuardChecks(a, t.m_sk, t.m_dependencies, t.m_refDeps, srcRec);
       dumpTranslationInfo(t, a.code.frontier);
 
@@ -11492,7 +11593,10 @@ TranslatorX64::translateTracelet(SrcKey sk, bool considerHHIR/*=true*/,
   // metadata is not yet visible.
   TRACE(1, "newTranslation: %p  sk: (func %d, bcOff %d)\n",
       start, sk.getFuncId(), sk.m_offset);
-  srcRec.newTranslation(a, astubs, start);
+  srcRec.newTranslation(a, astubs, start,
+                        (a.code.frontier - start) +
+                        (astubs.code.frontier - stubStart));
+  WarmupProfile::recordTracelet(curFunc(), sk.offset());
   TRACE(1, "tx64: %zd-byte tracelet\n", a.code.frontier - start);
   if (Trace::moduleEnabledRelease(Trace::tcspace, 1)) {
     Trace::traceRelease(getUsage().c_str());
@@ -11639,6 +11743,7 @@ TranslatorX64::TranslatorX64()
   m_funcPrologueRedispatch(0),
   m_irAUsage(0),
   m_irAstubsUsage(0),
+  m_deadCodeBytes(0),
   m_numHHIRTrans(0),
   m_regMap(kCallerSaved, kCalleeSaved, this),
   m_interceptsEnabled(false),
@@ -12023,6 +12128,7 @@ TranslatorX64::requestExit() {
             s_writeLease.m_hintGrabbed);
   PendQ::drain();
   Treadmill::finishRequest(g_vmContext->m_currentThreadIdx);
+  maybeReplace();
   TRACE(1, "done requestExit(%" PRId64 ")\n", g_vmContext->m_currentThreadIdx);
   Stats::dump();
   Stats::clear();
@@ -12147,6 +12253,7 @@ std::string TranslatorX64::getUsage() {
   size_t aHotUsage = ahot.code.frontier - ahot.code.base;
   size_t aUsage = a.code.frontier - a.code.base;
   size_t stubsUsage = astubs.code.frontier - astubs.code.base;
+  size_t codeUsage = std::max(aHotUsage + aUsage + stubsUsage, size_t(1));
   size_t dataUsage = m_globalData.frontier - m_globalData.base;
   size_t tcUsage = TargetCache::s_frontier;
   size_t persistentUsage =
@@ -12158,6 +12265,7 @@ std::string TranslatorX64::getUsage() {
     "tx64: %9zd bytes (%" PRId64 "%%) in astubs.code\n"
     "tx64: %9zd bytes (%" PRId64 "%%) in a.code from ir\n"
     "tx64: %9zd bytes (%" PRId64 "%%) in astubs.code from ir\n"
+    "tx64: %9zd bytes (%" PRId64 "%%) of code unreachable\n"
     "tx64: %9zd bytes (%" PRId64 "%%) in m_globalData\n"
     "tx64: %9zd bytes (%" PRId64 "%%) in targetCache\n"
     "tx64: %9zd bytes (%" PRId64 "%%) in persistentCache\n",
@@ -12166,11 +12274,22 @@ std::string TranslatorX64::getUsage() {
     stubsUsage, 100 * stubsUsage / astubs.code.size,
     m_irAUsage,     100 * m_irAUsage / a.code.size,
     m_irAstubsUsage, 100 * m_irAstubsUsage / astubs.code.size,
+    m_deadCodeBytes, 100 * m_deadCodeBytes / codeUsage,
     dataUsage, 100 * dataUsage / m_globalData.size,
     tcUsage,
     400 * tcUsage / RuntimeOption::EvalJitTargetCacheSize / 3,
     persistentUsage,
     400 * persistentUsage / RuntimeOption::EvalJitTargetCacheSize);
+  if (CompilePool::enabled()) {
+    CompilePool::Stats stats = CompilePool::getStats();
+    std::string poolUsage;
+    Util::string_printf(
+      poolUsage,
+      "tx64: %9" PRIu64 " prologues queued, %" PRIu64 " compiled in "
+      "background, %" PRIu64 " pending\n",
+      stats.queued, stats.compiled, stats.pending);
+    usage += poolUsage;
+  }
   return usage;
 }
 
@@ -12440,10 +12559,11 @@ void TranslatorX64::invalidateSrcKey(SrcKey sk) {
   assert(sr);
   /*
    * Since previous translations aren't reachable from here, we know we
-   * just created some garbage in the TC. We currently have no mechanism
-   * to reclaim this.
+   * just created some garbage in the TC. It can't be reused in place,
+   * but maybeReplace() will start over in a fresh space once there's
+   * enough of it.
    */
-  sr->replaceOldTranslations(a, astubs);
+  m_deadCodeBytes += sr->replaceOldTranslations(a, astubs);
 }
 
 void TranslatorX64::invalidateFileWork(Eval::PhpFile* f) {
@@ -132,10 +132,7 @@ class TranslatorX64 : public Translator
   class AHotSelector {
    public:
     AHotSelector(TranslatorX64* tx, bool hot) :
-        m_tx(tx), m_hot(hot &&
-                        tx->ahot.code.base + tx->ahot.code.size -
-                        tx->ahot.code.frontier > 8192 &&
-                        tx->a.code.base != tx->ahot.code.base) {
+        m_tx(tx), m_hot(hot && tx->ahotHasRoom()) {
       if (m_hot) {
         m_save = tx->a;
         tx->a = tx->ahot;
@@ -153,6 +150,13 @@ class TranslatorX64 : public Translator
     bool           m_hot;
   };
 
+  // Whether ahot is its own region, not already selected into a, and
+  // has room left for another translation.
+  bool ahotHasRoom() const {
+    return a.code.base != ahot.code.base &&
+      ahot.code.base + ahot.code.size - ahot.code.frontier > 8192;
+  }
+
   Asm                    ahot;
   Asm                    a;
   Asm                    astubs;
@@ -186,6 +190,9 @@ class TranslatorX64 : public Translator
   DataBlock              m_globalData;
   size_t                 m_irAUsage;
   size_t                 m_irAstubsUsage;
+  // Bytes of translations that invalidation has made unreachable; they
+  // only come back when the whole space is replaced.
+  size_t                 m_deadCodeBytes;
 
   // Data structures for HHIR-based translation
   uint64_t               m_numHHIRTrans;
@@ -705,6 +712,7 @@ PSEUDOINSTRS
                       Class* &cls, StringData*& invName, bool& forward);
   static uint64_t toStringHelper(ObjectData *obj);
   void invalidateSrcKey(SrcKey sk);
+  bool isCodeFull() const;
   bool dontGuardAnyInputs(Opcode op);
  public:
   template<typename T>
@@ -897,6 +905,7 @@ private:
   TCA lookupTranslation(SrcKey sk) const;
   TCA translate(SrcKey sk, bool align, bool useHHIR);
   TCA retranslate(SrcKey sk, bool align, bool useHHIR);
+  TCA retranslateHot(SrcKey sk, uint32_t* counter);
   TCA retranslateOpt(TransID transId, bool align);
   TCA retranslateAndPatchNoIR(SrcKey sk,
                               bool   align,
@@ -962,6 +971,7 @@ private:
   void emitTestSurpriseFlags(Asm& a);
   void emitCheckSurpriseFlagsEnter(bool inTracelet, Fixup f);
   TCA  emitTransCounterInc(Asm& a);
+  void emitHotTraceletCounter(Asm& a, SrcKey sk, const SrcRec& sr);
 
   static void trimExtraArgs(ActRec* ar);
   static int  shuffleArgsForMagicCall(ActRec* ar);
@@ -1065,6 +1075,11 @@ public:
   // a new space.
   bool replace();
 
+  // Replace the translation space if it is nearly full, or if too much
+  // of it is unreachable, per Eval.JitTCReplace{Full,Dead}Percent. Must
+  // be called from a point where this thread isn't running in the TC.
+  bool maybeReplace();
+
   // Debugging interfaces to prevent tampering with code.
   void protectCode();
   void unprotectCode();
@@ -2593,6 +2593,10 @@ void TraceletContext::recordJmp() {
   m_numJmps++;
 }
 
+void TraceletContext::recordCondJmp() {
+  m_numCondJmps++;
+}
+
 /*
  *   Helpers for recovering context of this instruction.
  */
@@ -2932,6 +2936,28 @@ static bool checkTaintFuncs(StringData* name) {
   return name->isame(s_extract);
 }
 
+/*
+ * traceThroughCondJmp --
+ *
+ *   Returns true if analyze should extend the tracelet along the
+ *   fall-through side of this JmpZ/JmpNZ rather than ending it there.
+ *   Only the IR can express a mid-trace conditional exit; tx64 reanalyzes
+ *   with m_useHHIR cleared if it has to take over. Backward branches are
+ *   left alone, since continuing past them would just fall out of the
+ *   loop they close.
+ */
+bool Translator::traceThroughCondJmp(const NormalizedInstruction& ni,
+                                     const TraceletContext& tas) const {
+  if (!m_useHHIR ||
+      (ni.op() != OpJmpZ && ni.op() != OpJmpNZ) ||
+      ni.m_txFlags == Interp) {
+    return false;
+  }
+  return ni.imm[0].u_BA > 0 &&
+    uint32_t(tas.m_numCondJmps) <
+      RuntimeOption::EvalHHIRMaxCondJmpsTracedThrough;
+}
+
 /*
  * analyze --
  *
@@ -3234,6 +3260,14 @@ std::unique_ptr<Tracelet> Translator::analyze(SrcKey sk) {
       tas.recordJmp();
       sk = SrcKey(curFunc(), sk.m_offset + ni->imm[0].u_IA);
       goto head; // don't advance sk
+    } else if (traceThroughCondJmp(*ni, tas)) {
+      // HHIR side-exits to the taken target of a conditional jump that
+      // isn't the last instruction of the trace, so we can keep going
+      // down the fall-through path and hand the optimizer a whole
+      // if-diamond or loop body instead of a lone basic block.
+      SKTRACE(1, sk, "continuing through %dth conditional jmp, taken + %d\n",
+              tas.m_numCondJmps, ni->imm[0].u_BA);
+      tas.recordCondJmp();
     } else if (opcodeBreaksBB(ni->op()) ||
         (ni->m_txFlags == Interp && opcodeChangesPC(ni->op()))) {
       SKTRACE(1, sk, "BB broken\n");
@@ -698,18 +698,21 @@ struct TraceletContext {
   LocationSet m_changeSet;
   LocationSet m_deletedSet;
   int         m_numJmps;
+  int         m_numCondJmps;
   bool        m_aliasTaint;
   bool        m_varEnvTaint;
 
   TraceletContext()
     : m_t(nullptr)
     , m_numJmps(0)
+    , m_numCondJmps(0)
     , m_aliasTaint(false)
     , m_varEnvTaint(false)
   {}
   TraceletContext(Tracelet* t)
     : m_t(t)
     , m_numJmps(0)
+    , m_numCondJmps(0)
     , m_aliasTaint(false)
     , m_varEnvTaint(false)
   {}
@@ -719,6 +722,7 @@ struct TraceletContext {
   void recordWrite(DynLocation* dl, NormalizedInstruction* source);
   void recordDelete(const Location& l);
   void recordJmp();
+  void recordCondJmp();
   void aliasTaint();
   void varEnvTaint();
 
@@ -983,6 +987,8 @@ public:
 
   void postAnalyze(NormalizedInstruction* ni, SrcKey& sk,
                    Tracelet& t, TraceletContext& tas);
+  bool traceThroughCondJmp(const NormalizedInstruction& ni,
+                           const TraceletContext& tas) const;
   std::unique_ptr<Tracelet> analyze(SrcKey sk);
   void advance(Opcode const **instrs);
   static int locPhysicalOffset(Location l, const Func* f = nullptr);
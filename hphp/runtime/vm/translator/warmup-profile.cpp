@@ -0,0 +1,253 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#include <stdio.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+
+#include "util/logger.h"
+#include "util/timer.h"
+#include "util/trace.h"
+#include "runtime/base/runtime_option.h"
+#include "runtime/base/execution_context.h"
+#include "runtime/base/thread_init_fini.h"
+#include "runtime/eval/runtime/file_repository.h"
+#include "runtime/vm/class.h"
+#include "runtime/vm/unit.h"
+#include "runtime/vm/translator/translator-x64.h"
+#include "runtime/vm/translator/warmup-profile.h"
+
+namespace HPHP { namespace VM { namespace Transl {
+
+TRACE_SET_MOD(trans);
+
+namespace WarmupProfile {
+
+static const char kHeader[] = "# hhvm jit warmup profile v1";
+
+struct FuncKey {
+  MD5 md5;
+  Offset base;
+
+  bool operator<(const FuncKey& o) const {
+    return md5 < o.md5 || (md5 == o.md5 && base < o.base);
+  }
+};
+
+struct FuncRecord {
+  FuncRecord() : prologues(0), numTracelets(0) {}
+
+  std::string path;
+  // Bit i is set if we emitted a prologue for paramIndex i.
+  uint64_t prologues;
+  uint32_t numTracelets;
+  std::set<Offset> tracelets;
+};
+
+typedef std::map<FuncKey, FuncRecord> ProfileMap;
+
+// Protected by the translator write lease.
+static ProfileMap s_recorded;
+
+bool enabled() {
+  return !RuntimeOption::EvalJitWarmupProfile.empty();
+}
+
+static inline bool shouldRecord() {
+  return RuntimeOption::EvalJitWarmupProfileRecord && enabled();
+}
+
+static FuncRecord& recordFor(const Func* func) {
+  assert(Translator::WriteLease().amOwner());
+  const Unit* unit = func->unit();
+  FuncKey key = { unit->md5(), func->base() };
+  FuncRecord& rec = s_recorded[key];
+  if (rec.path.empty()) rec.path = unit->filepath()->data();
+  return rec;
+}
+
+void recordTracelet(const Func* func, Offset off) {
+  if (!shouldRecord() || func->isPseudoMain()) return;
+  FuncRecord& rec = recordFor(func);
+  if (rec.tracelets.insert(off).second) {
+    rec.numTracelets++;
+  }
+}
+
+void recordPrologue(const Func* func, int nArgs) {
+  if (!shouldRecord() || nArgs >= 64) return;
+  recordFor(func).prologues |= 1ull << nArgs;
+}
+
+bool save() {
+  if (!shouldRecord()) return true;
+  const std::string& path = RuntimeOption::EvalJitWarmupProfile;
+  // Write to a temporary and rename it into place, so that a server
+  // starting up concurrently never sees a partial profile.
+  std::string tmp = path + ".tmp";
+  FILE* f = fopen(tmp.c_str(), "w");
+  if (!f) {
+    Logger::Error("Unable to write jit warmup profile %s", tmp.c_str());
+    return false;
+  }
+  fprintf(f, "%s\n", kHeader);
+  for (ProfileMap::const_iterator it = s_recorded.begin();
+       it != s_recorded.end(); ++it) {
+    fprintf(f, "%s %d %" PRIx64 " %u %s\n",
+            it->first.md5.toString().c_str(), it->first.base,
+            it->second.prologues, it->second.numTracelets,
+            it->second.path.c_str());
+  }
+  bool ok = !ferror(f);
+  ok = fclose(f) == 0 && ok;
+  if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+    Logger::Error("Unable to write jit warmup profile %s", path.c_str());
+    unlink(tmp.c_str());
+    return false;
+  }
+  Logger::Info("Wrote jit warmup profile for %zu funcs to %s",
+               s_recorded.size(), path.c_str());
+  return true;
+}
+
+static void saveAtExit() {
+  save();
+}
+
+static InitFiniNode s_saveAtExit(saveAtExit, InitFiniNode::ProcessExit);
+
+static bool load(ProfileMap& out) {
+  const std::string& path = RuntimeOption::EvalJitWarmupProfile;
+  std::ifstream in(path.c_str());
+  if (!in) return false;
+  std::string line;
+  if (!std::getline(in, line) || line != kHeader) {
+    Logger::Warning("Ignoring jit warmup profile %s: bad header",
+                    path.c_str());
+    return false;
+  }
+  while (std::getline(in, line)) {
+    char md5[33];
+    int base, pathOff = 0;
+    uint64_t prologues;
+    unsigned numTracelets;
+    if (sscanf(line.c_str(), "%32s %d %" SCNx64 " %u %n",
+               md5, &base, &prologues, &numTracelets, &pathOff) != 4 ||
+        strlen(md5) != 32 || !pathOff) {
+      TRACE(1, "warmup profile: malformed line '%s'\n", line.c_str());
+      continue;
+    }
+    FuncKey key = { MD5(md5), base };
+    FuncRecord& rec = out[key];
+    rec.path = line.substr(pathOff);
+    rec.prologues = prologues;
+    rec.numTracelets = numTracelets;
+  }
+  return true;
+}
+
+/*
+ * Apply the profile to one func. Returns the number of prologues emitted.
+ */
+static int warmupFunc(Func* func, const ProfileMap& profile) {
+  FuncKey key = { func->unit()->md5(), func->base() };
+  ProfileMap::const_iterator it = profile.find(key);
+  if (it == profile.end()) return 0;
+  func->setAttrs(Attr(func->attrs() | AttrHot));
+
+  // Methods don't have their Class yet, and closures need a live ActRec,
+  // so only top-level functions get their prologues up front.
+  if (func->isMethod() || func->isClonedClosure()) return 0;
+  // Holding the lease keeps funcPrologue from handing these to the
+  // compile pool; we want them in place before we take traffic.
+  BlockingLeaseHolder writer(Translator::WriteLease());
+  int emitted = 0;
+  uint64_t prologues = it->second.prologues;
+  for (int nArgs = 0; prologues; ++nArgs, prologues >>= 1) {
+    if ((prologues & 1) &&
+        Translator::Get()->funcPrologue(func, nArgs)) {
+      ++emitted;
+    }
+  }
+  return emitted;
+}
+
+void warmup() {
+  if (!enabled() || !RuntimeOption::RepoAuthoritative ||
+      !RuntimeOption::EvalJit) {
+    return;
+  }
+  ProfileMap profile;
+  if (!load(profile) || profile.empty()) return;
+
+  // Visit the heaviest units first so they get first dibs on ahot.
+  std::map<std::string, uint32_t> unitWeights;
+  for (ProfileMap::const_iterator it = profile.begin();
+       it != profile.end(); ++it) {
+    unitWeights[it->second.path] += it->second.numTracelets + 1;
+  }
+  std::vector<std::pair<uint32_t, std::string> > units;
+  for (std::map<std::string, uint32_t>::const_iterator it =
+         unitWeights.begin(); it != unitWeights.end(); ++it) {
+    units.push_back(std::make_pair(it->second, it->first));
+  }
+  std::sort(units.rbegin(), units.rend());
+
+  Timer timer(Timer::WallTime);
+  int numUnits = 0, numFuncs = 0, numPrologues = 0;
+  for (size_t i = 0; i < units.size(); ++i) {
+    const std::string& path = units[i].second;
+    Eval::PhpFile* efile = nullptr;
+    try {
+      String spath(path);
+      bool initial;
+      efile = g_vmContext->lookupPhpFile(spath.get(), "", &initial);
+    } catch (const Exception& e) {
+      TRACE(1, "warmup profile: %s: %s\n", path.c_str(), e.what());
+    }
+    Unit* unit = efile ? efile->unit() : nullptr;
+    if (!unit) continue;
+    ++numUnits;
+
+    for (Unit::MutableFuncRange fr(unit->nonMainFuncs()); !fr.empty();) {
+      Func* func = fr.popFront();
+      FuncKey key = { unit->md5(), func->base() };
+      if (!profile.count(key)) continue;
+      ++numFuncs;
+      numPrologues += warmupFunc(func, profile);
+    }
+    for (Unit::PreClassRange pcr(unit->preclasses()); !pcr.empty();) {
+      PreClass* preClass = pcr.popFront().get();
+      Func* const* methods = preClass->methods();
+      for (size_t m = 0; m < preClass->numMethods(); ++m) {
+        FuncKey key = { unit->md5(), methods[m]->base() };
+        if (!profile.count(key)) continue;
+        ++numFuncs;
+        numPrologues += warmupFunc(methods[m], profile);
+      }
+    }
+  }
+  Logger::Info("Jit warmup profile: %d units, %d hot funcs, "
+               "%d prologues in %" PRId64 "ms",
+               numUnits, numFuncs, numPrologues,
+               timer.getMicroSeconds() / 1000);
+}
+
+}
+
+} } }
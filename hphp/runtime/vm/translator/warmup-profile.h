@@ -0,0 +1,62 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#ifndef incl_RUNTIME_VM_TRANSLATOR_WARMUP_PROFILE_H_
+#define incl_RUNTIME_VM_TRANSLATOR_WARMUP_PROFILE_H_
+
+#include "runtime/vm/func.h"
+
+namespace HPHP { namespace VM { namespace Transl {
+
+/*
+ * The warmup profile remembers which functions the JIT found worth
+ * translating in a previous incarnation of the server, keyed by
+ * (unit md5, func base offset), so that a restarted server can get a
+ * head start on them before it accepts any traffic.
+ *
+ * Recording is enabled by Eval.JitWarmupProfileRecord and happens with
+ * the write lease held; the profile is written to Eval.JitWarmupProfile
+ * at process exit. Replaying only happens in RepoAuthoritative mode,
+ * where unit md5s are stable across restarts.
+ *
+ * Tracelet bodies depend on the live types in the frame that first
+ * reaches them, so they can't be translated ahead of time. What we can
+ * do up front is load the units, emit func prologues for the arities
+ * we saw before, and mark the profiled funcs AttrHot so their tracelets
+ * land in the hot code region once they do get translated.
+ */
+namespace WarmupProfile {
+
+bool enabled();
+
+void recordTracelet(const Func* func, Offset off);
+void recordPrologue(const Func* func, int nArgs);
+
+/*
+ * Load the profile from disk and warm up every unit it mentions. Must be
+ * called from a thread with an initialized request context.
+ */
+void warmup();
+
+/*
+ * Write the recorded profile to disk. Returns false on I/O failure.
+ */
+bool save();
+
+}
+
+} } }
+
+#endif
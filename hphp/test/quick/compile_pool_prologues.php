@@ -0,0 +1,40 @@
+<?php
+
+// Calls that need func prologues for many different argument counts, run
+// with the background compile pool on (it only starts in repo mode, so
+// run this with test/run -r to exercise it). Until a queued prologue is
+// emitted the call is interpreted, so every round must give the same
+// answers.
+
+function f0() { return 0; }
+function f1($a) { return $a; }
+function f2($a, $b = 2) { return $a + $b; }
+function f3($a, $b = 2, $c = 3) { return $a + $b + $c; }
+function fv() { return array_sum(func_get_args()); }
+
+class K {
+  function m($a, $b = 10) { return $a * $b; }
+  static function s($a = 1, $b = 1, $c = 1) { return $a + $b + $c; }
+}
+
+function round_trip($i) {
+  $k = new K;
+  return array(
+    f0(), f0($i), f1($i), f1($i, $i),
+    f2($i), f2($i, $i), f2($i, $i, $i),
+    f3($i), f3($i, 1), f3($i, 1, 1), f3($i, 1, 1, 1),
+    fv(), fv($i), fv($i, $i), fv($i, $i, $i, $i),
+    $k->m($i), $k->m($i, 2), K::s(), K::s($i), K::s($i, $i, $i, $i),
+  );
+}
+
+function main() {
+  $first = null;
+  for ($round = 0; $round < 200; $round++) {
+    $r = round_trip(3);
+    if ($first === null) $first = $r;
+    if ($r !== $first) echo "round $round differs\n";
+  }
+  echo implode(" ", $first), "\n";
+}
+main();
@@ -0,0 +1,99 @@
+<?php
+
+// Temporary arrays and strings built in a trace: some never leave it and
+// may be dropped, the rest escape through calls, stores, returns and
+// destructors and must survive intact.
+
+class D {
+  public $n;
+  function __construct($n) { $this->n = $n; }
+  function __destruct() { echo "destruct {$this->n}\n"; }
+}
+
+class Holder {
+  public $v;
+  public $nested;
+  public static $s;
+}
+
+function sink($a) { return count($a); }
+
+function dead($i) {
+  $a = array($i, $i + 1);
+  $b = array();
+  $b[] = $i;
+  $s = "x" . $i;
+  return $i;
+}
+
+function dead_with_object($i) {
+  $a = array(new D($i));
+  echo "after alloc $i\n";
+  $a = null;
+  echo "after unset $i\n";
+}
+
+function via_call($i) {
+  $a = array($i, $i * 2);
+  $a[] = "z";
+  return sink($a);
+}
+
+function via_store($h, $i) {
+  $a = array($i);
+  $a[5] = "five";
+  $h->v = $a;
+  Holder::$s = "s" . $i;
+}
+
+function via_global($i) {
+  $a = array('k' => $i);
+  $GLOBALS['g'] = $a;
+}
+
+function via_return($i) {
+  $a = array();
+  $a['key'] = $i;
+  $a[] = "str" . $i;
+  return $a;
+}
+
+function via_ref($i, &$out) {
+  $a = array($i, $i);
+  $out = $a;
+}
+
+// $inner only escapes by way of $outer.
+function via_nested($h, $i) {
+  $inner = array($i, "in");
+  $outer = array($inner);
+  $h->nested = $outer;
+}
+
+function via_static($i) {
+  static $keep;
+  $a = array($i);
+  $keep = $a;
+  return $keep;
+}
+
+function main() {
+  $h = new Holder;
+  $sum = 0;
+  for ($i = 0; $i < 50; $i++) {
+    $sum += dead($i);
+    $sum += via_call($i);
+    via_store($h, $i);
+    via_global($i);
+    $r = via_return($i);
+    via_ref($i, $out);
+    via_nested($h, $i);
+    $st = via_static($i);
+  }
+  var_dump($sum);
+  var_dump($h->v, Holder::$s, $GLOBALS['g'], $r, $out);
+  var_dump($h->nested, $st);
+  dead_with_object(1);
+  dead_with_object(2);
+}
+main();
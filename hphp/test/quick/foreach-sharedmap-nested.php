@@ -0,0 +1,102 @@
+<?php
+
+// Iterating arrays fetched from APC, with nested arrays and objects, and
+// changing them along the way.  None of it may leak back into APC.
+
+class Point {
+  public $x, $y;
+  function __construct($x, $y) { $this->x = $x; $this->y = $y; }
+}
+
+function show($v) {
+  if (is_array($v)) {
+    $parts = array();
+    foreach ($v as $k => $e) $parts[] = "$k:" . show($e);
+    return '[' . implode(',', $parts) . ']';
+  }
+  if (is_object($v)) return get_class($v) . '(' . $v->x . ',' . $v->y . ')';
+  return (string)$v;
+}
+
+function nested() {
+  $a = apc_fetch('nested');
+  foreach ($a as $k => $v) {
+    echo $k, ' => ', show($v), "\n";
+  }
+  foreach ($a['objs'] as $p) {
+    $p->x *= 10;
+  }
+  echo show($a['objs']), "\n";
+  $b = apc_fetch('nested');
+  echo show($b['objs']), "\n";
+}
+
+function modify_by_value() {
+  $a = apc_fetch('nested');
+  foreach ($a as $k => $v) {
+    $a[$k . '2'] = $k;
+    unset($a['str']);
+    if (is_array($v)) $v[] = 'x';
+  }
+  echo implode(',', array_keys($a)), "\n";
+  echo show($a['list']), "\n";
+}
+
+function modify_by_ref() {
+  $a = apc_fetch('vec');
+  foreach ($a as $k => &$v) {
+    $v = $v + 1;
+    if ($k == 0) $a[] = 50;
+    if ($k == 1) unset($a[2]);
+  }
+  unset($v);
+  echo show($a), "\n";
+  echo show(apc_fetch('vec')), "\n";
+}
+
+function modify_nested() {
+  $a = apc_fetch('nested');
+  foreach ($a['list'] as &$n) $n *= 2;
+  unset($n);
+  foreach ($a['map']['b'] as $k => &$s) $s = strtolower($s);
+  unset($s);
+  $a['map']['b']['d'] = 'D';
+  echo show($a['list']), ' ', show($a['map']), "\n";
+  $b = apc_fetch('nested');
+  echo show($b['list']), ' ', show($b['map']), "\n";
+}
+
+function pointers() {
+  $a = apc_fetch('vec');
+  $b = $a;
+  echo next($a), ' ', current($b), "\n";
+  echo end($a), ' ', current($b), "\n";
+  echo prev($a), ' ', key($a), "\n";
+  $c = $a;
+  echo next($c), ' ', current($a), "\n";
+  reset($a);
+  $e = each($a);
+  echo $e['key'], '=', $e['value'], ' ', current($a), "\n";
+  $v = array_values($a);
+  $v[] = 50;
+  echo show($v), ' ', count($a), "\n";
+  foreach ($a as $x) {
+    $a[] = $x;
+  }
+  echo count($a), ' ', count(apc_fetch('vec')), "\n";
+}
+
+apc_store('nested', array(
+  'list' => array(1, 2, 3),
+  'map' => array('a' => 'A', 'b' => array('c' => 'C')),
+  'obj' => new Point(1, 2),
+  'objs' => array(new Point(3, 4), new Point(5, 6)),
+  'str' => 'str',
+));
+apc_store('vec', array(10, 20, 30, 40));
+
+nested();
+modify_by_value();
+modify_by_ref();
+modify_nested();
+pointers();
@@ -0,0 +1,56 @@
+<?php
+
+// Tracelets that continue through forward conditional jumps, run with
+// Eval.HHIRMaxCondJmpsTracedThrough on. Each branch is taken on some calls
+// and falls through on others, so both the side exit and the traced
+// fall-through get executed.
+
+function diamond($x) {
+  if ($x > 5) {
+    $r = "big";
+  } else {
+    $r = "small";
+  }
+  return $r;
+}
+
+function chain($a, $b, $c) {
+  $n = 0;
+  if ($a) $n += 1;
+  if ($b) $n += 10;
+  if (!$c) $n += 100;
+  return $n;
+}
+
+function early($arr) {
+  if (!$arr) return -1;
+  $sum = 0;
+  foreach ($arr as $v) {
+    if ($v < 0) continue;
+    $sum += $v;
+  }
+  return $sum;
+}
+
+function main() {
+  $out = array();
+  for ($i = 0; $i < 10; $i++) {
+    $out[] = diamond($i);
+  }
+  echo implode(",", $out), "\n";
+
+  for ($i = 0; $i < 8; $i++) {
+    echo chain($i & 1, $i & 2, $i & 4), " ";
+  }
+  echo "\n";
+
+  // mixed types, so a traced-through branch also meets other inputs
+  var_dump(chain("", "0", null));
+  var_dump(chain("x", 1.5, array()));
+
+  var_dump(early(array()));
+  var_dump(early(array(1, -2, 3)));
+  var_dump(early(null));
+  var_dump(early(array(-1, -1)));
+}
+main();
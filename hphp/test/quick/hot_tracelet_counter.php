@@ -0,0 +1,36 @@
+<?php
+
+// With a threshold of 3, these tracelets get moved into ahot after a few
+// entries, part way through each loop.
+class Point {
+  public $x, $y;
+  function __construct($x, $y) { $this->x = $x; $this->y = $y; }
+  function len2() { return $this->x * $this->x + $this->y * $this->y; }
+}
+
+function add($a, $b) {
+  return $a + $b;
+}
+
+function sum_points($n) {
+  $s = 0;
+  for ($i = 0; $i < $n; $i++) {
+    $p = new Point($i, $i + 1);
+    $s = add($s, $p->len2());
+  }
+  return $s;
+}
+
+function concat($n) {
+  $s = '';
+  for ($i = 0; $i < $n; $i++) {
+    $s .= ($i % 2) ? 'a' : 'b';
+  }
+  return $s;
+}
+
+var_dump(sum_points(10));
+var_dump(sum_points(100));
+var_dump(concat(8));
+var_dump(add(1.5, 2));
+var_dump(add("3", 4));
@@ -0,0 +1,72 @@
+<?php
+
+// Getters and setters called on $this, simple enough for the JIT to
+// replace the call with the property access, including the cases where
+// it has to make the real call instead.
+
+class D {
+  public $n;
+  function __construct($n) { $this->n = $n; }
+  function __destruct() { echo "destruct {$this->n}\n"; }
+}
+
+class P {
+  private $x = 1;
+  protected $y = "y";
+  public $z;
+
+  function getX() { return $this->x; }
+  function setX($v) { $this->x = $v; }
+  function getY() { return $this->y; }
+  function setZ($v) { $this->z = $v; }
+  function getZ() { return $this->z; }
+
+  function __get($name) { return "__get($name)"; }
+
+  function getZViaThis() { return $this->getZ(); }
+  function setZViaThis($v) { $this->setZ($v); }
+
+  function run($i) {
+    $this->setX($i);
+    $this->setZ(array($i));
+    return array($this->getX(), $this->getY(), $this->getZ());
+  }
+}
+
+class Q extends P {
+  // a different $x; P's accessors still see P's private one
+  public $x = "Q";
+  function runQ() {
+    $this->setX(5);
+    return array($this->getX(), $this->x);
+  }
+}
+
+function main() {
+  $p = new P;
+  for ($i = 0; $i < 20; $i++) $r = $p->run($i);
+  var_dump($r);
+
+  $q = new Q;
+  for ($i = 0; $i < 20; $i++) $r = $q->runQ();
+  var_dump($r);
+
+  // unset property: the getter has to go through __get
+  unset($p->z);
+  var_dump($p->getZViaThis());
+
+  // property bound by reference
+  $p->setZViaThis(1);
+  $ref =& $p->z;
+  $ref = "by ref";
+  var_dump($p->getZViaThis());
+  unset($ref);
+
+  // overwriting an object runs its destructor inside the setter
+  $p->setZViaThis(new D(1));
+  $p->setZViaThis(new D(2));
+  echo "after\n";
+  $p->setZViaThis(null);
+  echo "done\n";
+}
+main();
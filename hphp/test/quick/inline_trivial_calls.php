@@ -0,0 +1,46 @@
+<?php
+
+// Callees simple enough for the JIT to replace the call with its result,
+// checked against the same calls made through call_user_func.
+
+function lit_null() { return null; }
+function lit_true() { return true; }
+function lit_false() { return false; }
+function lit_int() { return 42; }
+function lit_dbl() { return 1.5; }
+function lit_str() { return "str"; }
+function first($a, $b) { return $a; }
+function second($a, $b) { return $b; }
+
+class C {
+  public static function sm($x) { return $x; }
+  public function m() { return "m"; }
+  public function callM() { return $this->m(); }
+}
+
+function direct($i) {
+  $c = new C;
+  return array(lit_null(), lit_true(), lit_false(), lit_int(), lit_dbl(),
+               lit_str(), first($i, 2), second(1, $i), C::sm($i),
+               $c->callM());
+}
+
+function indirect($i) {
+  $c = new C;
+  return array(call_user_func('lit_null'), call_user_func('lit_true'),
+               call_user_func('lit_false'), call_user_func('lit_int'),
+               call_user_func('lit_dbl'), call_user_func('lit_str'),
+               call_user_func('first', $i, 2),
+               call_user_func('second', 1, $i),
+               call_user_func(array('C', 'sm'), $i),
+               call_user_func(array($c, 'm')));
+}
+
+function main() {
+  for ($i = 0; $i < 100; $i++) {
+    if (direct($i) !== indirect($i)) echo "mismatch at $i\n";
+  }
+  var_dump(direct(7));
+  echo "done\n";
+}
+main();
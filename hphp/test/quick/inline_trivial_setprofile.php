@@ -0,0 +1,25 @@
+<?php
+
+// A trivial callee may be inlined, but not while a profiler is watching:
+// it has to see every call.
+
+function trivial($x) { return $x; }
+
+$calls = 0;
+function prof($event, $name) {
+  global $calls;
+  if ($event == 'enter' && $name == 'trivial') $calls++;
+}
+
+function run($n) {
+  $sum = 0;
+  for ($i = 0; $i < $n; $i++) $sum += trivial($i);
+  return $sum;
+}
+
+var_dump(run(100));
+fb_setprofile('prof');
+var_dump(run(100));
+fb_setprofile(null);
+var_dump(run(100));
+var_dump($calls);
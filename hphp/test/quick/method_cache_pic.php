@@ -0,0 +1,49 @@
+<?php
+
+// A single FPushObjMethodD site fed receivers of more and more classes:
+// one class (monomorphic), up to four (the polymorphic cache), then more
+// than fit (the mega cache). Private methods, __call and static methods
+// go through the same sites.
+
+class A { function f() { return "A"; } }
+class B { function f() { return "B"; } }
+class C { function f() { return "C"; } }
+class D { function f() { return "D"; } }
+class E { function f() { return "E"; } }
+class F extends A { function f() { return "F"; } }
+class G extends A {}
+class M { function __call($n, $a) { return "M::$n"; } }
+class S { static function f() { return "S"; } }
+
+class Base {
+  private function p() { return "Base::p"; }
+  function callP($o) { return $o->p(); }
+}
+class Sub1 extends Base { function p() { return "Sub1::p"; } }
+class Sub2 extends Base {}
+
+function call_f($o) { return $o->f(); }
+
+function run($objs, $n) {
+  $out = array();
+  for ($i = 0; $i < $n; $i++) {
+    $out[] = call_f($objs[$i % count($objs)]);
+  }
+  return implode("", $out);
+}
+
+function main() {
+  echo run(array(new A), 4), "\n";
+  echo run(array(new A, new B), 8), "\n";
+  echo run(array(new A, new B, new C, new D), 12), "\n";
+  echo run(array(new A, new B, new C, new D, new E, new F, new G), 21), "\n";
+  echo run(array(new M, new S, new A), 9), "\n";
+
+  // The context class decides which p() is visible.
+  $b = new Base;
+  foreach (array(new Base, new Sub1, new Sub2) as $o) {
+    for ($i = 0; $i < 3; $i++) echo $b->callP($o), " ";
+    echo "\n";
+  }
+}
+main();
@@ -17857,6 +17857,17 @@ bool TestCodeRun::TestJson() {
        "$foo = new Foo(); $foo->foo = $foo;\n"
        "var_dump(json_encode($foo));\n");
 
+  // repeated keys share one string for the rest of the request
+  MVCR("<?php\n"
+       "$j = '[{\"id\":1,\"name\":\"a\"},{\"id\":2,\"name\":\"b\"}]';\n"
+       "$rows = json_decode($j, true);\n"
+       "$objs = json_decode($j);\n"
+       "$copy = unserialize(serialize($rows));\n"
+       "foreach ($rows as $row) {\n"
+       "  foreach ($row as $k => $v) { $k .= '!'; var_dump($k, $v); }\n"
+       "}\n"
+       "var_dump($objs[1]->name, $copy, $copy == $rows);\n");
+
 #if 0
   MVCR("<?php "
       "$a = array(1);"
@@ -23411,6 +23422,92 @@ bool TestCodeRun::TestAPC() {
       "}\n"
       );
 
+  {
+    OptionSetter w(this, OptionSetter::RunTime,
+                   "-vServer.APC.CompactSerialize=true");
+    // objects that don't need serialize()'s special cases are kept in the
+    // compact format; names shared by both records, __wakeup and visibility
+    // have to come back the same
+    MVCRO("<?php\n"
+          "class R {\n"
+          "  public $id;\n"
+          "  protected $tags = array();\n"
+          "  private $score = 1.5;\n"
+          "  function __construct($id, $tags) {\n"
+          "    $this->id = $id; $this->tags = $tags;\n"
+          "  }\n"
+          "  function __wakeup() { $this->id .= '!'; }\n"
+          "}\n"
+          "$a = array(new R(1, array('x' => 1, 'y' => array(true, null))),\n"
+          "           new R(2, array()));\n"
+          "apc_store('recs', $a);\n"
+          "var_dump(apc_fetch('recs'));\n",
+          "array(2) {\n"
+          "  [0]=>\n"
+          "  object(R)#3 (3) {\n"
+          "    [\"id\"]=>\n"
+          "    string(2) \"1!\"\n"
+          "    [\"tags\":protected]=>\n"
+          "    array(2) {\n"
+          "      [\"x\"]=>\n"
+          "      int(1)\n"
+          "      [\"y\"]=>\n"
+          "      array(2) {\n"
+          "        [0]=>\n"
+          "        bool(true)\n"
+          "        [1]=>\n"
+          "        NULL\n"
+          "      }\n"
+          "    }\n"
+          "    [\"score\":\"R\":private]=>\n"
+          "    float(1.5)\n"
+          "  }\n"
+          "  [1]=>\n"
+          "  object(R)#4 (3) {\n"
+          "    [\"id\"]=>\n"
+          "    string(2) \"2!\"\n"
+          "    [\"tags\":protected]=>\n"
+          "    array(0) {\n"
+          "    }\n"
+          "    [\"score\":\"R\":private]=>\n"
+          "    float(1.5)\n"
+          "  }\n"
+          "}\n"
+          );
+
+    // properties are written directly, not through __set(), and nested
+    // objects wake up before the ones holding them
+    MVCRO("<?php\n"
+          "class S {\n"
+          "  public $a = 1;\n"
+          "  function __set($n, $v) { echo \"__set $n\\n\"; $this->$n = $v; }\n"
+          "  function __wakeup() { echo \"wakeup S\\n\"; }\n"
+          "}\n"
+          "class W {\n"
+          "  public $inner;\n"
+          "  function __wakeup() { echo \"wakeup W\\n\"; }\n"
+          "}\n"
+          "$s = new S;\n"
+          "$s->dyn = 3;\n"
+          "$w = new W;\n"
+          "$w->inner = $s;\n"
+          "apc_store('w', $w);\n"
+          "var_dump(apc_fetch('w'));\n",
+          "__set dyn\n"
+          "wakeup S\n"
+          "wakeup W\n"
+          "object(W)#3 (1) {\n"
+          "  [\"inner\"]=>\n"
+          "  object(S)#4 (2) {\n"
+          "    [\"a\"]=>\n"
+          "    int(1)\n"
+          "    [\"dyn\"]=>\n"
+          "    int(3)\n"
+          "  }\n"
+          "}\n"
+          );
+  }
+
   // objects in an apc array can be changed without escalating the array
   MVCRO("<?php\n"
         "class A { var $i = 10; }\n"
@@ -19,6 +19,8 @@
 #include <util/logger.h>
 #include <runtime/base/memory/memory_manager.h>
 #include <runtime/base/builtin_functions.h>
+#include <runtime/base/array/hphp_array.h>
+#include <runtime/ext/ext_array.h>
 #include <runtime/ext/ext_variable.h>
 #include <runtime/ext/ext_apc.h>
 #include <runtime/ext/ext_mysql.h>
@@ -26,6 +28,7 @@
 #include <runtime/base/shared/shared_store_base.h>
 #include <runtime/base/runtime_option.h>
 #include <runtime/base/server/ip_block_map.h>
+#include <runtime/base/server/access_log.h>
 #include <hphp/test/test_mysql_info.h>
 #include <system/lib/systemlib.h>
 
@@ -41,9 +44,11 @@ bool TestCppBase::RunTests(const std::string &which) {
   RUN_TEST(TestSmartAllocator);
   RUN_TEST(TestString);
   RUN_TEST(TestArray);
+  RUN_TEST(TestPackedArray);
   RUN_TEST(TestObject);
   RUN_TEST(TestVariant);
   RUN_TEST(TestIpBlockMap);
+  RUN_TEST(TestAccessLogRing);
   RUN_TEST(TestEqualAsStr);
   return ret;
 }
@@ -625,6 +630,155 @@ bool TestCppBase::TestArray() {
   return Count(true);
 }
 
+static bool is_packed(CArrRef arr) {
+  return arr.get()->isHphpArray() &&
+    static_cast<HphpArray*>(arr.get())->isPacked();
+}
+
+bool TestCppBase::TestPackedArray() {
+  // appends and overwrites keep an array packed
+  {
+    Array arr = Array::Create();
+    for (int i = 0; i < 10; i++) arr.append(i * 10);
+    VERIFY(is_packed(arr));
+    VS(arr.size(), 10);
+    VS(arr[5], 50);
+    VERIFY(!arr.exists(10));
+    VERIFY(!arr.exists(-1));
+    VERIFY(!arr.exists("5x"));
+    arr.set(3, "three");
+    arr.set(10, 100);
+    VERIFY(is_packed(arr));
+    VS(arr[3], "three");
+    VS(arr[10], 100);
+  }
+
+  // a string key converts it, keeping values and iteration order
+  {
+    Array arr = CREATE_VECTOR3("a", "b", "c");
+    VERIFY(is_packed(arr));
+    arr.set("k", "v");
+    VERIFY(!is_packed(arr));
+    VS(arr.size(), 4);
+    VS(arr[0], "a"); VS(arr[1], "b"); VS(arr[2], "c"); VS(arr["k"], "v");
+    arr.append("d");
+    VS(arr[3], "d");
+    const char *keys[] = { "0", "1", "2", "k", "3" };
+    const char *vals[] = { "a", "b", "c", "v", "d" };
+    int i = 0;
+    for (ArrayIter iter(arr); iter; ++iter, ++i) {
+      VS(iter.first().toString(), keys[i]);
+      VS(iter.second(), vals[i]);
+    }
+    VERIFY(i == 5);
+  }
+
+  // unset leaves a hole that later appends don't fill
+  {
+    Array arr = CREATE_VECTOR3(1, 2, 3);
+    arr.remove(1);
+    VERIFY(!is_packed(arr));
+    VERIFY(!arr.exists(1));
+    VS(arr.size(), 2);
+    arr.append(4);
+    VS(arr[3], 4);
+    VERIFY(!arr.exists(1));
+    int64_t keys[] = { 0, 2, 3 };
+    int i = 0;
+    for (ArrayIter iter(arr); iter; ++iter, ++i) {
+      VS(iter.first(), keys[i]);
+    }
+    VERIFY(i == 3);
+  }
+
+  // unsetting the last element doesn't rewind the next key
+  {
+    Array arr = CREATE_VECTOR3(1, 2, 3);
+    arr.remove(2);
+    arr.append(9);
+    VERIFY(!arr.exists(2));
+    VS(arr[3], 9);
+    VS(arr.size(), 3);
+  }
+
+  // an integer key past the end converts it, and moves the next key on
+  {
+    Array arr = CREATE_VECTOR2("a", "b");
+    arr.set(5, "x");
+    VERIFY(!is_packed(arr));
+    arr.append("y");
+    VS(arr[6], "y");
+    VERIFY(!arr.exists(2));
+    int64_t keys[] = { 0, 1, 5, 6 };
+    int i = 0;
+    for (ArrayIter iter(arr); iter; ++iter, ++i) {
+      VS(iter.first(), keys[i]);
+    }
+    VERIFY(i == 4);
+
+    Array neg = CREATE_VECTOR1("a");
+    neg.set(-1, "b");
+    VERIFY(!is_packed(neg));
+    VS(neg[-1], "b");
+    VS(neg[0], "a");
+  }
+
+  // copy on write and escalation keep the packed layout and the values
+  {
+    Array arr = CREATE_VECTOR3(1, 2, 3);
+    Array copy = arr;
+    copy.set(0, "changed");
+    VS(arr[0], 1);
+    VS(copy[0], "changed");
+    VERIFY(is_packed(arr));
+    VERIFY(is_packed(copy));
+    copy.append(4);
+    VS(copy.size(), 4);
+    VS(arr.size(), 3);
+
+    Array esc = arr;
+    esc.escalate();
+    VS(esc, arr);
+    esc.set("s", 1);
+    VS(arr.size(), 3);
+    VERIFY(is_packed(arr));
+    VERIFY(!is_packed(esc));
+  }
+
+  // growing past the initial capacity stays packed
+  {
+    Array arr = Array::Create();
+    for (int i = 0; i < 1000; i++) arr.append(i);
+    VERIFY(is_packed(arr));
+    for (int i = 0; i < 1000; i++) VS(arr[i], i);
+  }
+
+  // arrays too big for the inline hash allocate it when they convert
+  {
+    Array arr = Array::Create();
+    for (int i = 0; i < 1000; i++) arr.append(i);
+    Array copy = arr;
+    arr.set("k", "v");
+    VERIFY(!is_packed(arr));
+    VERIFY(is_packed(copy));
+    VS(arr.size(), 1001);
+    VS(arr["k"], "v");
+    for (int i = 0; i < 1000; i++) VS(arr[i], i);
+    arr.append(1000);
+    VS(arr[1000], 1000);
+
+    Variant sorted = copy;
+    f_arsort(ref(sorted));
+    VERIFY(!is_packed(sorted.toArray()));
+    VS(sorted.toArray().size(), 1000);
+    VS(sorted[999], 999);
+    VS(sorted[0], 0);
+    ArrayIter iter(sorted.toArray());
+    VS(iter.first(), 999);
+  }
+  return Count(true);
+}
+
 bool TestCppBase::TestObject() {
   {
     String s = "O:1:\"B\":1:{s:3:\"obj\";O:1:\"A\":1:{s:1:\"a\";i:10;}}";
@@ -860,6 +1014,55 @@ static inline long in6addrWord(struct in6_addr addr, char wordNo) {
           (addr.s6_addr[(wordNo*4)+3] <<  0)) & 0xFFFFFFFF;
 }
 
+// Consume everything in the ring as "file:line;" pairs, the way the access
+// log writer does.
+static std::string drainRing(AccessLogRing &ring) {
+  std::string out;
+  uint64_t head = ring.peek([&](uint32_t file, const char *data,
+                                uint32_t len) {
+    out += char('0' + file);
+    out += ":" + std::string(data, len) + ";";
+  });
+  ring.release(head);
+  return out;
+}
+
+bool TestCppBase::TestAccessLogRing() {
+  // 8 byte headers, records padded to 8: "12345678" takes 16 bytes
+  AccessLogRing ring(64);
+  VERIFY(!ring.push(0, std::string(64, 'x')));
+
+  // full ring
+  VERIFY(ring.push(0, "12345678"));
+  VERIFY(ring.push(1, "12345678"));
+  VERIFY(ring.push(0, "12345678"));
+  VERIFY(ring.push(1, "12345678"));
+  VS((int64)ring.depth(), 64);
+  VERIFY(!ring.push(0, "1"));
+  VS(drainRing(ring), "0:12345678;1:12345678;0:12345678;1:12345678;");
+  VS((int64)ring.depth(), 0);
+  VS(drainRing(ring), "");
+
+  // reuse after a drain, leaving the next record at offset 48
+  VERIFY(ring.push(0, "a"));
+  VERIFY(ring.push(0, "b"));
+  VERIFY(ring.push(0, "c"));
+  VS(drainRing(ring), "0:a;0:b;0:c;");
+
+  // a 32 byte record doesn't fit in the last 16, so it wraps to offset 0
+  // behind a skip record, which counts towards the depth
+  VERIFY(ring.push(1, "wrapped around here!"));
+  VS((int64)ring.depth(), 48);
+  VERIFY(ring.push(0, "d"));
+  VS((int64)ring.depth(), 64);
+  VERIFY(!ring.push(0, "e"));
+  VS(drainRing(ring), "1:wrapped around here!;0:d;");
+  VS((int64)ring.depth(), 0);
+  VERIFY(ring.push(0, "e"));
+  VS(drainRing(ring), "0:e;");
+  return Count(true);
+}
+
 bool TestCppBase::TestIpBlockMap() {
   struct in6_addr addr;
   int bits;
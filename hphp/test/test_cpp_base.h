@@ -40,6 +40,7 @@ class TestCppBase : public TestBase {
   // building blocks
   bool TestSmartAllocator();
   bool TestIpBlockMap();
+  bool TestAccessLogRing();
 
   /**
    * Date types. This in turn tests StringData, ArrayData, StringOffset,
@@ -55,6 +56,7 @@ class TestCppBase : public TestBase {
    */
   bool TestString();
   bool TestArray();
+  bool TestPackedArray();
   bool TestObject();
   bool TestVariant();
   bool TestListAssignment();
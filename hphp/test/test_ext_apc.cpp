@@ -54,7 +54,28 @@ bool TestExtApc::RunTests(const std::string &which) {
   RUN_TEST(test_apc_bin_dumpfile);
   RUN_TEST(test_apc_bin_loadfile);
   RUN_TEST(test_apc_exists);
+  RUN_TEST(test_apc_memory_limit);
+  RUN_TEST(test_apc_memory_limit_lfu);
+  RUN_TEST(test_apc_snapshot);
 
+  RuntimeOption::ApcTableType = RuntimeOption::ApcShardedTable;
+  s_apc_store.reset();
+  printf("\nSharded version:\n");
+  RUN_TEST(test_apc_add);
+  RUN_TEST(test_apc_store);
+  RUN_TEST(test_apc_fetch);
+  RUN_TEST(test_apc_delete);
+  RUN_TEST(test_apc_clear_cache);
+  RUN_TEST(test_apc_inc);
+  RUN_TEST(test_apc_dec);
+  RUN_TEST(test_apc_cas);
+  RUN_TEST(test_apc_exists);
+  RUN_TEST(test_apc_sharded_tombstones);
+  RUN_TEST(test_apc_sharded_grow);
+  RUN_TEST(test_apc_sharded_ttl);
+
+  RuntimeOption::ApcTableType = RuntimeOption::ApcConcurrentTable;
+  s_apc_store.reset();
   return ret;
 }
 
@@ -324,3 +345,239 @@ bool TestExtApc::test_apc_exists() {
   VS(f_apc_exists(CREATE_VECTOR2("ts", "TestString")), CREATE_VECTOR1("ts"));
   return Count(true);
 }
+
+bool TestExtApc::test_apc_memory_limit() {
+  int64_t oldLimit = RuntimeOption::ApcMemoryLimit;
+  RuntimeOption::ApcMemoryLimit = 64 * 1024;
+  s_apc_store.reset();
+
+  String value(std::string(1024, 'x'));
+  for (int i = 0; i < 1000; i++) {
+    f_apc_store(String("evict:") + String(i), value);
+    // keep one key hot, so LRU should never pick it
+    VS(f_apc_fetch("evict:0"), value);
+  }
+  int present = 0;
+  for (int i = 0; i < 1000; i++) {
+    if (f_apc_exists(String("evict:") + String(i)).toBoolean()) present++;
+  }
+  VERIFY(present > 0 && present < 64);
+  VS(f_apc_fetch("evict:0"), value);
+  VS(f_apc_fetch("evict:999"), value);
+
+  // Keys that come and go while we're under the limit leave stale entries
+  // on the eviction queue; they mustn't crowd out the live ones.
+  for (int i = 0; i < 20000; i++) {
+    String key = String("churn:") + String(i);
+    f_apc_store(key, i);
+    f_apc_delete(key);
+  }
+  VS(f_apc_fetch("evict:0"), value);
+  VS(f_apc_fetch("evict:999"), value);
+
+  // Primed keys aren't evictable, but once overwritten they are.
+  std::vector<SharedStore::KeyValuePair> vars(1);
+  vars[0].key = "evict:primed";
+  vars[0].len = strlen(vars[0].key);
+  s_apc_store[0].constructPrime(value, vars[0], false);
+  s_apc_store[0].prime(vars);
+  VS(f_apc_fetch("evict:primed"), value);
+  f_apc_store("evict:primed", value);
+  for (int i = 0; i < 1000; i++) {
+    f_apc_store(String("evict2:") + String(i), value);
+  }
+  VS(f_apc_exists("evict:primed"), false);
+  VS(f_apc_fetch("evict2:999"), value);
+
+  RuntimeOption::ApcMemoryLimit = oldLimit;
+  s_apc_store.reset();
+  return Count(true);
+}
+
+bool TestExtApc::test_apc_memory_limit_lfu() {
+  int64_t oldLimit = RuntimeOption::ApcMemoryLimit;
+  RuntimeOption::ApcEvictionPolicies oldPolicy =
+    RuntimeOption::ApcEvictionPolicy;
+  RuntimeOption::ApcMemoryLimit = 64 * 1024;
+  RuntimeOption::ApcEvictionPolicy = RuntimeOption::ApcEvictLFU;
+  s_apc_store.reset();
+
+  // Fetched often, but only before the other keys go in.  LRU would
+  // evict it as soon as it's sampled twice; LFU keeps it for its hits.
+  String value(std::string(1024, 'x'));
+  f_apc_store("lfu:frequent", value);
+  for (int i = 0; i < 100; i++) {
+    VS(f_apc_fetch("lfu:frequent"), value);
+  }
+  for (int i = 0; i < 1000; i++) {
+    f_apc_store(String("lfu:") + String(i), value);
+  }
+  int present = 0;
+  for (int i = 0; i < 1000; i++) {
+    if (f_apc_exists(String("lfu:") + String(i)).toBoolean()) present++;
+  }
+  VERIFY(present > 0 && present < 64);
+  VS(f_apc_fetch("lfu:frequent"), value);
+  VS(f_apc_fetch("lfu:999"), value);
+
+  RuntimeOption::ApcMemoryLimit = oldLimit;
+  RuntimeOption::ApcEvictionPolicy = oldPolicy;
+  s_apc_store.reset();
+  return Count(true);
+}
+
+bool TestExtApc::test_apc_snapshot() {
+  std::string oldPath = RuntimeOption::ApcSnapshotPath;
+  RuntimeOption::ApcSnapshotPath = "/tmp/test_ext_apc.snapshot";
+  s_apc_store.reset();
+
+  Array arr = CREATE_MAP2("a", CREATE_VECTOR2(1, "two"), "b", 3.5);
+  f_apc_store("snap:int", 10);
+  f_apc_store("snap:str", "hello");
+  f_apc_store("snap:arr", arr);
+  f_apc_store("snap:mine", "old");
+  f_apc_store("snap:gone", 1, 1);
+  sleep(2);
+  VERIFY(apc_save_snapshot());
+
+  s_apc_store.reset();
+  f_apc_store("snap:mine", "new");
+  VERIFY(apc_adopt_snapshot());
+  // a snapshot is only ever adopted once
+  VERIFY(!apc_adopt_snapshot());
+
+  VS(f_apc_fetch("snap:int"), 10);
+  VS(f_apc_fetch("snap:str"), "hello");
+  VS(f_apc_fetch("snap:arr"), arr);
+  VS(f_apc_fetch("snap:mine"), "new");
+  VS(f_apc_fetch("snap:gone"), false);
+  f_apc_store("snap:str", "again");
+  VS(f_apc_fetch("snap:str"), "again");
+
+  RuntimeOption::ApcSnapshotPath = oldPath;
+  s_apc_store.reset();
+  return Count(true);
+}
+
+bool TestExtApc::test_apc_sharded_tombstones() {
+  s_apc_store.reset();
+
+  // About 100 keys per shard, well past the 3/4 load that makes a 64 slot
+  // shard grow.
+  const int n = 6400;
+
+  // Deleting and re-adding the same keys over and over must reuse their
+  // tombstones, not fill up (or endlessly grow) the shards.
+  for (int round = 0; round < 8; round++) {
+    for (int i = 0; i < n; i++) {
+      VS(f_apc_add(String("tomb:") + String(i), round), true);
+    }
+    VS(s_apc_store[0].size(), n);
+    for (int i = 0; i < n; i += 2) {
+      VS(f_apc_delete(String("tomb:") + String(i)), true);
+    }
+    VS(s_apc_store[0].size(), n / 2);
+    for (int i = 0; i < n; i++) {
+      VS(f_apc_fetch(String("tomb:") + String(i)),
+         i % 2 ? Variant(round) : Variant(false));
+    }
+    for (int i = 1; i < n; i += 2) {
+      VS(f_apc_delete(String("tomb:") + String(i)), true);
+    }
+    VS(s_apc_store[0].size(), 0);
+  }
+  VS(f_apc_delete("tomb:0"), false);
+
+  // New keys replacing deleted ones land on empty slots, so tombstones
+  // pile up until a grow sweeps them out.
+  for (int round = 0; round < 8; round++) {
+    String prefix = String("tomb:") + String(round) + ":";
+    for (int i = 0; i < n; i++) {
+      VS(f_apc_store(prefix + String(i), i), true);
+    }
+    if (round) {
+      String prev = String("tomb:") + String(round - 1) + ":";
+      for (int i = 0; i < n; i++) {
+        VS(f_apc_delete(prev + String(i)), true);
+      }
+      for (int i = 0; i < n; i += 7) {
+        VS(f_apc_fetch(prev + String(i)), false);
+      }
+    }
+    VS(s_apc_store[0].size(), n);
+    for (int i = 0; i < n; i++) {
+      VS(f_apc_fetch(prefix + String(i)), i);
+    }
+  }
+  f_apc_clear_cache();
+
+  // A key whose probe sequence runs over a tombstone is still found.
+  f_apc_store("tomb:a", "a");
+  f_apc_store("tomb:b", "b");
+  f_apc_delete("tomb:a");
+  VS(f_apc_fetch("tomb:b"), "b");
+  f_apc_store("tomb:b", "b2");
+  VS(f_apc_fetch("tomb:b"), "b2");
+  VS(s_apc_store[0].size(), 1);
+  return Count(true);
+}
+
+bool TestExtApc::test_apc_sharded_grow() {
+  s_apc_store.reset();
+
+  // Far more keys than one shard starts out with.
+  const int n = 20000;
+  for (int i = 0; i < n; i++) {
+    VS(f_apc_store(String("grow:") + String(i), i), true);
+  }
+  VS(s_apc_store[0].size(), n);
+  for (int i = 0; i < n; i++) {
+    VS(f_apc_fetch(String("grow:") + String(i)), i);
+  }
+  // Overwrites after growing replace rather than duplicate.
+  for (int i = 0; i < n; i += 3) {
+    f_apc_store(String("grow:") + String(i), CREATE_VECTOR1(i));
+  }
+  VS(s_apc_store[0].size(), n);
+  VS(f_apc_fetch("grow:3"), CREATE_VECTOR1(3));
+  VS(f_apc_fetch("grow:4"), 4);
+  VS(f_apc_inc("grow:4", 10), 14);
+  VERIFY(f_apc_cas("grow:5", 5, 50));
+  VS(f_apc_fetch("grow:5"), 50);
+
+  f_apc_clear_cache();
+  VS(s_apc_store[0].size(), 0);
+  VS(f_apc_fetch("grow:4"), false);
+  return Count(true);
+}
+
+bool TestExtApc::test_apc_sharded_ttl() {
+  s_apc_store.reset();
+
+  // Everything that has to expire is set up first, so there's one wait.
+  f_apc_store("ttl:short", "short", 1);
+  f_apc_store("ttl:long", "long", 100);
+  f_apc_store("ttl:none", "none");
+  f_apc_store("ttl:num", 1, 1);
+  f_apc_store("ttl:cas", 1, 1);
+  f_apc_store("ttl:add", "old", 1);
+  VS(f_apc_fetch("ttl:short"), "short");
+  VS(s_apc_store[0].size(), 6);
+  sleep(2);
+
+  VS(f_apc_fetch("ttl:short"), false);
+  VS(f_apc_exists("ttl:num"), false);
+  VS(f_apc_fetch("ttl:long"), "long");
+  VS(f_apc_fetch("ttl:none"), "none");
+
+  // An expired key behaves as if it were absent.
+  Variant success;
+  f_apc_inc("ttl:num", 1, ref(success));
+  VS(success, false);
+  VS(f_apc_cas("ttl:cas", 1, 2), false);
+  VS(f_apc_add("ttl:add", "new"), true);
+  VS(f_apc_fetch("ttl:add"), "new");
+  VS(f_apc_fetch("ttl:cas"), false);
+  VS(s_apc_store[0].size(), 3);
+  return Count(true);
+}
@@ -48,6 +48,12 @@ class TestExtApc : public TestCppExt {
   bool test_apc_bin_dumpfile();
   bool test_apc_bin_loadfile();
   bool test_apc_exists();
+  bool test_apc_memory_limit();
+  bool test_apc_memory_limit_lfu();
+  bool test_apc_snapshot();
+  bool test_apc_sharded_tombstones();
+  bool test_apc_sharded_grow();
+  bool test_apc_sharded_ttl();
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -128,6 +128,19 @@ bool TestExtString::test_stringdata() {
   String s3(StringData::MaxSmallSize * 2, ReserveString);
   String s4(StringData::MaxSmallSize * 2, ReserveString);
   s4.mutableSlice().ptr[0] = 'a';
+
+  // Growing past the small buffer, or out of a malloced one, leaves room
+  // for the next append.
+  String chunk("0123456789");
+  String s5("x", CopyString);
+  s5 += f_str_repeat(chunk, 10);
+  VERIFY(s5.size() == 101);
+  VERIFY(s5.get()->capacity() > s5.size());
+  String s6(strdup("malloced string that is too big for the small buffer"),
+            AttachString);
+  s6 += chunk;
+  VERIFY(s6.get()->capacity() > s6.size());
+  VS(s6, "malloced string that is too big for the small buffer0123456789");
   return Count(true);
 }
 
@@ -145,6 +158,9 @@ bool TestExtString::test_stripcslashes() {
 
 bool TestExtString::test_addslashes() {
   VS(f_addslashes("'\"\\\n"), "\\'\\\"\\\\\n");
+  // long enough to be scanned in blocks
+  VS(f_addslashes("O'Reilly and O'Brien wrote \"\\\" in 2013"),
+     "O\\'Reilly and O\\'Brien wrote \\\"\\\\\\\" in 2013");
   return Count(true);
 }
 
@@ -186,11 +202,17 @@ bool TestExtString::test_strrev() {
 
 bool TestExtString::test_strtolower() {
   VS(f_strtolower("ABC"), "abc");
+  VS(f_strtolower("The Quick Brown Fox @[`{ Jumps Over"),
+     "the quick brown fox @[`{ jumps over");
+  VS(f_strtolower("NON-ASCII \xC9T\xC9 BLOCK, THEN ASCII ONLY AGAIN"),
+     "non-ascii \xC9t\xC9 block, then ascii only again");
   return Count(true);
 }
 
 bool TestExtString::test_strtoupper() {
   VS(f_strtoupper("abc"), "ABC");
+  VS(f_strtoupper("The Quick Brown Fox @[`{ Jumps Over"),
+     "THE QUICK BROWN FOX @[`{ JUMPS OVER");
   return Count(true);
 }
 
@@ -365,6 +387,9 @@ bool TestExtString::test_str_replace() {
   {
     VS(f_str_replace("%body%", "black", "<body text='%body%'>"),
        "<body text='black'>");
+    VS(f_str_replace("%body%", "black",
+                     "<body text='%body%' style='%body' class='%body%'>"),
+       "<body text='black' style='%body' class='black'>");
   }
   {
     Array vowels;
@@ -513,6 +538,10 @@ bool TestExtString::test_htmlspecialchars_decode() {
 bool TestExtString::test_htmlspecialchars() {
   VS(f_htmlspecialchars("<a href='test'>Test</a>", k_ENT_QUOTES),
      "&lt;a href=&#039;test&#039;&gt;Test&lt;/a&gt;");
+  VS(f_htmlspecialchars("a paragraph of plain text long enough to scan, "
+                        "then <b>bold</b> & \"quoted\" text"),
+     "a paragraph of plain text long enough to scan, "
+     "then &lt;b&gt;bold&lt;/b&gt; &amp; &quot;quoted&quot; text");
 
   VS(f_bin2hex(f_htmlspecialchars("\xA0", k_ENT_COMPAT)), "a0");
   VS(f_bin2hex(f_htmlspecialchars("\xc2\xA0", k_ENT_COMPAT, "")), "c2a0");
@@ -860,6 +889,8 @@ bool TestExtString::test_strpos() {
   VS(f_strpos("abcdef abcdef", "a", 1), 7);
   VS(f_strpos("abcdef abcdef", "A", 1), false);
   VS(f_strpos("abcdef abcdef", "", 0), false);
+  VS(f_strpos("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab", "aab"), 37);
+  VS(f_strpos("abababababababababababababababab", "abb"), false);
   return Count(true);
 }
 
@@ -159,6 +159,8 @@ bool TestExtUrl::test_rawurldecode() {
 
 bool TestExtUrl::test_rawurlencode() {
   VS(f_rawurlencode("foo bar@baz"), "foo%20bar%40baz");
+  VS(f_rawurlencode("a-long_path.name/with some~chars+\xff"),
+     "a-long_path.name%2Fwith%20some%7Echars%2B%FF");
   return Count(true);
 }
 
@@ -169,5 +171,7 @@ bool TestExtUrl::test_urldecode() {
 
 bool TestExtUrl::test_urlencode() {
   VS(f_urlencode("foo bar@baz"), "foo+bar%40baz");
+  VS(f_urlencode("a-long_path.name/with some~chars+\xff"),
+     "a-long_path.name%2Fwith+some%7Echars%2B%FF");
   return Count(true);
 }
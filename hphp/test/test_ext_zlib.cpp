@@ -18,6 +18,8 @@
 #include <runtime/ext/ext_zlib.h>
 #include <runtime/ext/ext_file.h>
 #include <runtime/ext/ext_output.h>
+#include <runtime/ext/ext_string.h>
+#include <util/compression.h>
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -32,6 +34,7 @@ bool TestExtZlib::RunTests(const std::string &which) {
   RUN_TEST(test_gzinflate);
   RUN_TEST(test_gzencode);
   RUN_TEST(test_gzdecode);
+  RUN_TEST(test_deflate_piece);
   RUN_TEST(test_zlib_get_coding_type);
   RUN_TEST(test_gzopen);
   RUN_TEST(test_gzclose);
@@ -113,6 +116,33 @@ bool TestExtZlib::test_gzdecode() {
   return Count(true);
 }
 
+bool TestExtZlib::test_deflate_piece() {
+  String text = f_str_repeat("testing deflate_piece, ", 10000);
+  const char *data = text.data();
+  int size = text.size();
+
+  // three pieces deflated separately make one gzip stream
+  char *pieces[3];
+  int lens[3];
+  uLong crc = crc32(0L, Z_NULL, 0);
+  int pieceSize = size / 3;
+  for (int i = 0; i < 3; i++) {
+    int start = i * pieceSize;
+    int len = i == 2 ? size - start : pieceSize;
+    pieces[i] = deflate_piece(data + start, len, std::min(start, 32768), 3,
+                              i == 2, lens[i]);
+    VERIFY(pieces[i] != nullptr);
+    crc = crc32_combine(crc, crc32(0L, (const Bytef *)data + start, len), len);
+  }
+  int len;
+  char *zipped = gzip_wrap(pieces, lens, 3, crc, size, len);
+  VS(f_gzdecode(String(zipped, len, AttachString)), text);
+  for (int i = 0; i < 3; i++) {
+    free(pieces[i]);
+  }
+  return Count(true);
+}
+
 bool TestExtZlib::test_zlib_get_coding_type() {
   try {
     f_zlib_get_coding_type();
@@ -35,6 +35,7 @@ class TestExtZlib : public TestCppExt {
   bool test_gzinflate();
   bool test_gzencode();
   bool test_gzdecode();
+  bool test_deflate_piece();
   bool test_zlib_get_coding_type();
   bool test_gzopen();
   bool test_gzclose();
@@ -15,6 +15,16 @@
 */
 
 #include <test/test_performance.h>
+#include <runtime/base/shared/concurrent_shared_store.h>
+#include <runtime/base/shared/sharded_shared_store.h>
+#include <runtime/base/shared/compact_serializer.h>
+#include <runtime/ext/ext_apc.h>
+#include <runtime/ext/ext_string.h>
+#include <runtime/ext/ext_url.h>
+#include <system/lib/systemlib.h>
+#include <runtime/vm/treadmill.h>
+#include <util/async_func.h>
+#include <util/timer.h>
 #include <util/util.h>
 
 #define PERF_LOOP_COUNT "500"
@@ -49,6 +59,9 @@ bool TestPerformance::RunTests(const std::string &which) {
   RUN_TEST(TestMemoryUsage);
   RUN_TEST(TestAdHocFile);
   RUN_TEST(TestAdHoc);
+  RUN_TEST(TestApcContention);
+  RUN_TEST(TestApcSerialization);
+  RUN_TEST(TestStringKernels);
   return ret;
 }
 
@@ -79,6 +92,12 @@ bool TestPerformance::TestBasicOperations() {
       "\n\n/* String concatenation */"
       PERF_END);
 
+  VCR(PERF_START
+      "$a = '<td>cell</td>'; $b = '';\n"
+      "for ($i = 0; $i < " PERF_LOOP_COUNT "; $i++) { $b .= $a . $i;} "
+      "\n\n/* Appending to a string */"
+      PERF_END);
+
   VCR(PERF_START
       "function func() {}\n"
       "for ($i = 0; $i < " PERF_LOOP_COUNT "; $i++) { func();}"
@@ -187,3 +206,185 @@ bool TestPerformance::TestAdHoc() {
 
   return true;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+// APC table contention: every thread fetches the same few hot keys.
+
+namespace {
+
+const int kApcFetches = 1000000;
+
+struct ApcFetcher {
+  ApcFetcher(SharedStore* store, const std::vector<String>* keys, int id)
+    : m_store(store), m_keys(keys), m_id(id), m_bad(0) {}
+
+  void run() {
+    VM::Treadmill::startRequest(m_id);
+    Variant v;
+    int nkeys = m_keys->size();
+    for (int i = 0; i < kApcFetches; i++) {
+      bool hit = m_store->get((*m_keys)[i % nkeys], v);
+      if (!hit || v.toInt64() != i % nkeys) m_bad++;
+    }
+    VM::Treadmill::finishRequest(m_id);
+  }
+
+  SharedStore* m_store;
+  const std::vector<String>* m_keys;
+  int m_id;
+  int m_bad;
+};
+
+// Returns false if any fetch missed or came back with the wrong value.
+bool benchApcStore(const char* name, SharedStore* store, int nthreads) {
+  std::vector<String> keys;
+  for (int i = 0; i < 8; i++) {
+    keys.push_back(StringData::GetStaticString("apc_hot_key_" +
+                                               boost::lexical_cast<string>(i)));
+    store->store(keys.back(), i, 0);
+  }
+
+  std::vector<ApcFetcher*> fetchers;
+  std::vector<AsyncFunc<ApcFetcher>*> funcs;
+  for (int i = 0; i < nthreads; i++) {
+    fetchers.push_back(new ApcFetcher(store, &keys, i + 1));
+    funcs.push_back(new AsyncFunc<ApcFetcher>(fetchers.back(),
+                                              &ApcFetcher::run));
+  }
+  timespec start, end;
+  gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < nthreads; i++) funcs[i]->start();
+  for (int i = 0; i < nthreads; i++) funcs[i]->waitForEnd();
+  gettime(CLOCK_MONOTONIC, &end);
+
+  int64_t us = gettime_diff_us(start, end);
+  printf("%s, %d threads: %.1fM fetches/s\n", name, nthreads,
+         double(kApcFetches) * nthreads / us);
+  bool ok = true;
+  for (int i = 0; i < nthreads; i++) {
+    if (fetchers[i]->m_bad) ok = false;
+    delete funcs[i];
+    delete fetchers[i];
+  }
+  return ok;
+}
+
+}
+
+bool TestPerformance::TestApcContention() {
+  static const int threads[] = { 1, 4, 16, 32 };
+  bool ret = true;
+  for (unsigned i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+    ConcurrentTableSharedStore concurrent(0);
+    if (!benchApcStore("concurrent", &concurrent, threads[i])) ret = false;
+    ShardedTableSharedStore sharded(0);
+    if (!benchApcStore("sharded", &sharded, threads[i])) ret = false;
+  }
+  return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// APC object decoding: serialize() text against the compact format, on
+// something shaped like a cached query result.
+
+static StaticString s_id("id");
+static StaticString s_name("name");
+static StaticString s_score("score");
+static StaticString s_tags("tags");
+
+bool TestPerformance::TestApcSerialization() {
+  Array records;
+  for (int i = 0; i < 100; i++) {
+    Object rec(SystemLib::AllocStdClassObject());
+    rec->o_set(s_id, i);
+    rec->o_set(s_name, String("user") + String(i));
+    rec->o_set(s_score, i * 1.5);
+    rec->o_set(s_tags, CREATE_VECTOR3("red", "green", "blue"));
+    records.append(rec);
+  }
+  String text = apc_serialize(records);
+  String compact = CompactSerializer::Serialize(records);
+  if (compact.isNull()) {
+    printf("records can't be kept in the compact format\n");
+    return false;
+  }
+
+  const int kDecodes = 2000;
+  timespec start, end;
+  gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < kDecodes; i++) {
+    apc_unserialize(text);
+  }
+  gettime(CLOCK_MONOTONIC, &end);
+  int64_t textUs = gettime_diff_us(start, end);
+
+  gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < kDecodes; i++) {
+    CompactSerializer::Unserialize(compact.data(), compact.size());
+  }
+  gettime(CLOCK_MONOTONIC, &end);
+  int64_t compactUs = gettime_diff_us(start, end);
+
+  printf("text:    %d bytes, %.1fus per decode\n", text.size(),
+         double(textUs) / kDecodes);
+  printf("compact: %d bytes, %.1fus per decode (%.1fx)\n", compact.size(),
+         double(compactUs) / kDecodes, double(textUs) / compactUs);
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Throughput of the string functions that scan for a few special bytes,
+// on page-like text from a field name up to a whole page.
+
+static String benchHtmlspecialchars(CStrRef s) {
+  return f_htmlspecialchars(s, k_ENT_QUOTES, "UTF-8");
+}
+static String benchAddslashes(CStrRef s) { return f_addslashes(s); }
+static String benchUrlencode(CStrRef s) { return f_urlencode(s); }
+static String benchStrtolower(CStrRef s) { return f_strtolower(s); }
+static String benchStrpos(CStrRef s) {
+  f_strpos(s, "</html>");
+  return s;
+}
+static String benchStrReplace(CStrRef s) {
+  return f_str_replace("{user}", "jdoe", s);
+}
+
+bool TestPerformance::TestStringKernels() {
+  static const struct {
+    const char *name;
+    String (*fn)(CStrRef);
+  } funcs[] = {
+    { "htmlspecialchars", benchHtmlspecialchars },
+    { "addslashes",       benchAddslashes },
+    { "urlencode",        benchUrlencode },
+    { "strtolower",       benchStrtolower },
+    { "strpos",           benchStrpos },
+    { "str_replace",      benchStrReplace },
+  };
+  static const int sizes[] = { 16, 64, 256, 4096, 65536 };
+  static const char sample[] =
+    "<li class=\"item\">Welcome back, {user}! You have 3 new messages "
+    "from O'Brien &amp; friends. Last_login=2013-05-01.</li>\n";
+
+  for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    StringBuffer sb;
+    while (sb.size() < sizes[i]) sb.append(sample, sizeof(sample) - 1);
+    String input(sb.data(), sizes[i], CopyString);
+    // Touch about 64MB per function and size.
+    int iters = (64 << 20) / sizes[i];
+
+    for (unsigned j = 0; j < sizeof(funcs) / sizeof(funcs[0]); j++) {
+      timespec start, end;
+      gettime(CLOCK_MONOTONIC, &start);
+      for (int k = 0; k < iters; k++) {
+        funcs[j].fn(input);
+      }
+      gettime(CLOCK_MONOTONIC, &end);
+      int64_t us = gettime_diff_us(start, end);
+      printf("%-16s %6d bytes: %8.1f MB/s\n", funcs[j].name, sizes[i],
+             double(sizes[i]) * iters / (us ? us : 1));
+    }
+  }
+  return true;
+}
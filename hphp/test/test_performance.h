@@ -34,6 +34,9 @@ class TestPerformance : public TestCodeRun {
   bool TestMemoryUsage();
   bool TestAdHocFile();
   bool TestAdHoc();
+  bool TestApcContention();
+  bool TestApcSerialization();
+  bool TestStringKernels();
 };
 
 ///////////////////////////////////////////////////////////////////////////////
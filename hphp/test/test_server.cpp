@@ -56,20 +56,7 @@ bool TestServer::VerifyServerResponse(const char *input, const char **outputs,
   assert(input);
   if (port == 0) port = s_server_port;
 
-  if (!CleanUp()) return false;
-  string fullPath = "runtime/tmp/string";
-  std::ofstream f(fullPath.c_str());
-  if (!f) {
-    printf("Unable to open %s for write. Run this test from hphp/.\n",
-           fullPath.c_str());
-    return false;
-  }
-
-  f << input;
-  f.close();
-
-  AsyncFunc<TestServer> func(this, &TestServer::RunServer);
-  func.start();
+  if (!StartServer(input)) return false;
 
   bool passed = true;
 
@@ -77,34 +64,7 @@ bool TestServer::VerifyServerResponse(const char *input, const char **outputs,
 
   int url = 0;
   for (url = 0; url < nUrls; url++) {
-    String server = "http://";
-    server += f_php_uname("n");
-    server += ":" + lexical_cast<string>(port) + "/";
-    server += urls[url];
-    actual = "<No response from server>";
-    string err;
-    for (int i = 0; i < 10; i++) {
-      Variant c = f_curl_init();
-      f_curl_setopt(c, k_CURLOPT_URL, server);
-      f_curl_setopt(c, k_CURLOPT_RETURNTRANSFER, true);
-      if (postdata) {
-        f_curl_setopt(c, k_CURLOPT_POSTFIELDS, postdata);
-        f_curl_setopt(c, k_CURLOPT_POST, true);
-      }
-      if (header) {
-        f_curl_setopt(c, k_CURLOPT_HTTPHEADER, CREATE_VECTOR1(header));
-      }
-      if (responseHeader) {
-        f_curl_setopt(c, k_CURLOPT_HEADER, 1);
-      }
-
-      Variant res = f_curl_exec(c);
-      if (!same(res, false)) {
-        actual = res.toString();
-        break;
-      }
-      sleep(1); // wait until HTTP server is up and running
-    }
+    actual = Fetch(port, urls[url], header, postdata, responseHeader);
     if (actual != outputs[url]) {
       if (!responseHeader ||
           actual.find(outputs[url]) == string::npos) {
@@ -114,8 +74,7 @@ bool TestServer::VerifyServerResponse(const char *input, const char **outputs,
     }
   }
 
-  AsyncFunc<TestServer>(this, &TestServer::StopServer).run();
-  func.waitForEnd();
+  StopServerAndWait();
 
   if (!passed) {
     printf("%s:%d\nParsing: [%s] (req %d)\nBet %d:\n"
@@ -133,6 +92,64 @@ bool TestServer::VerifyServerResponse(const char *input, const char **outputs,
   return true;
 }
 
+bool TestServer::StartServer(const char *input) {
+  if (!CleanUp()) return false;
+  string fullPath = "runtime/tmp/string";
+  std::ofstream f(fullPath.c_str());
+  if (!f) {
+    printf("Unable to open %s for write. Run this test from hphp/.\n",
+           fullPath.c_str());
+    return false;
+  }
+
+  f << input;
+  f.close();
+
+  m_serverThread.reset(new AsyncFunc<TestServer>(this,
+                                                 &TestServer::RunServer));
+  m_serverThread->start();
+  return true;
+}
+
+void TestServer::StopServerAndWait() {
+  AsyncFunc<TestServer>(this, &TestServer::StopServer).run();
+  m_serverThread->waitForEnd();
+  m_serverThread.reset();
+}
+
+string TestServer::Fetch(int port, const string &path, const char *header,
+                         const char *postdata, bool responseHeader,
+                         int *code /* = nullptr */) {
+  String server = "http://";
+  server += f_php_uname("n");
+  server += ":" + lexical_cast<string>(port) + "/";
+  server += path;
+  for (int i = 0; i < 10; i++) {
+    Variant c = f_curl_init();
+    f_curl_setopt(c, k_CURLOPT_URL, server);
+    f_curl_setopt(c, k_CURLOPT_RETURNTRANSFER, true);
+    if (postdata) {
+      f_curl_setopt(c, k_CURLOPT_POSTFIELDS, postdata);
+      f_curl_setopt(c, k_CURLOPT_POST, true);
+    }
+    if (header) {
+      f_curl_setopt(c, k_CURLOPT_HTTPHEADER, CREATE_VECTOR1(header));
+    }
+    if (responseHeader) {
+      f_curl_setopt(c, k_CURLOPT_HEADER, 1);
+    }
+
+    Variant res = f_curl_exec(c);
+    if (!same(res, false)) {
+      if (code) *code = f_curl_getinfo(c, k_CURLINFO_HTTP_CODE).toInt32();
+      return res.toString().data();
+    }
+    sleep(1); // wait until HTTP server is up and running
+  }
+  if (code) *code = 0;
+  return "<No response from server>";
+}
+
 void TestServer::RunServer() {
   string out, err;
   string portConfig = "-vServer.Port=" + lexical_cast<string>(s_server_port);
@@ -142,12 +159,16 @@ void TestServer::RunServer() {
     lexical_cast<string>(s_rpc_port);
   string fd = lexical_cast<string>(inherit_fd);
 
-  const char *argv[] = {
+  std::vector<const char *> argv = {
     "", "--mode=server", "--config=test/config-server.hdf",
     portConfig.c_str(), adminConfig.c_str(), rpcConfig.c_str(),
     "--port-fd", fd.c_str(),
-    NULL
   };
+  for (auto const& opt : m_serverOptions) {
+    argv.push_back("-v");
+    argv.push_back(opt.c_str());
+  }
+  argv.push_back(nullptr);
 
   if (Option::EnableEval < Option::FullEval) {
     argv[0] = "runtime/tmp/TestServer/test";
@@ -155,7 +176,7 @@ void TestServer::RunServer() {
     argv[0] = HHVM_PATH;
   }
 
-  Process::Exec(argv[0], argv, NULL, out, &err);
+  Process::Exec(argv[0], &argv[0], NULL, out, &err);
 }
 
 void TestServer::StopServer() {
@@ -226,6 +247,11 @@ bool TestServer::RunTests(const std::string &which) {
   RUN_TEST(TestRPCServer);
   RUN_TEST(TestXboxServer);
   RUN_TEST(TestPageletServer);
+  RUN_TEST(TestMethodCacheStats);
+  RUN_TEST(TestTCReplace);
+  RUN_TEST(TestEventLoops);
+  RUN_TEST(TestStaticETag);
+  RUN_TEST(TestWarmupProfile);
 
   return ret;
 }
@@ -283,6 +309,10 @@ bool TestServer::TestServerVariables() {
 
         "string?a=1&b=2");
 
+  VSRX("<?php var_dump($_SERVER['HTTP_X_TEST_HEADER']);",
+       "string(5) \"value\"\n", "string", "GET",
+       "x-test-header: value", nullptr);
+
   return true;
 }
 
@@ -789,3 +819,240 @@ bool TestServer::TestPageletServer() {
 
   return true;
 }
+
+bool TestServer::TestMethodCacheStats() {
+  // Six receiver classes overflow the call site's MethodCache, so the
+  // site sees inline, pic and mega cache hits as well as misses.
+  const char *input =
+    "<?php\n"
+    "class C0 { function f() { return 0; } }\n"
+    "class C1 { function f() { return 1; } }\n"
+    "class C2 { function f() { return 2; } }\n"
+    "class C3 { function f() { return 3; } }\n"
+    "class C4 { function f() { return 4; } }\n"
+    "class C5 { function f() { return 5; } }\n"
+    "function call_f($o) { return $o->f(); }\n"
+    "$objs = array(new C0, new C1, new C2, new C3, new C4, new C5);\n"
+    "$sum = 0;\n"
+    "for ($i = 0; $i < 600; $i++) $sum += call_f($objs[$i % 6]);\n"
+    "echo $sum;\n";
+
+  m_serverOptions.push_back("Eval.Jit=true");
+  m_serverOptions.push_back("Eval.JitMethodCacheStats=true");
+  if (!StartServer(input)) return false;
+  string page = Fetch(s_server_port, "string", nullptr, nullptr, false);
+  string stats = Fetch(s_admin_port, "vm-method-caches", nullptr, nullptr,
+                       false);
+  StopServerAndWait();
+  m_serverOptions.clear();
+
+  VS(String(page), "1500");
+  VERIFY(stats.find("inline") != string::npos);
+  VERIFY(stats.find("call_f->f()") != string::npos);
+  return Count(true);
+}
+
+bool TestServer::TestTCReplace() {
+  const char *input =
+    "<?php\n"
+    "class C { public $v = 1; function get() { return $this->v; } }\n"
+    "function sum($n) {\n"
+    "  $c = new C; $s = 0;\n"
+    "  for ($i = 0; $i < $n; $i++) $s += $c->get() + strlen(\"ab\" . $i);\n"
+    "  return $s;\n"
+    "}\n"
+    "echo sum(1000);\n";
+
+  // A 2MB a and astubs, replaced at 1% full and checked at every
+  // requestExit, so each request finishes by swapping in a fresh TC and
+  // the next one has to retranslate everything.
+  m_serverOptions.push_back("Eval.Jit=true");
+  m_serverOptions.push_back("Eval.JitASize=2097152");
+  m_serverOptions.push_back("Eval.JitAStubsSize=2097152");
+  m_serverOptions.push_back("Eval.JitTCReplaceFullPercent=1");
+  m_serverOptions.push_back("Eval.JitTCReplaceCheckMs=0");
+  if (!StartServer(input)) return false;
+  std::vector<string> pages;
+  for (int i = 0; i < 4; i++) {
+    pages.push_back(Fetch(s_server_port, "string", nullptr, nullptr, false));
+  }
+  StopServerAndWait();
+  m_serverOptions.clear();
+
+  for (auto const& page : pages) {
+    VS(String(page), "5890");
+  }
+  return Count(true);
+}
+
+bool TestServer::TestEventLoops() {
+  // Every loop flushes for GracefulShutdownWait seconds as it stops; they
+  // have to do that side by side, or stopping takes five times as long.
+  m_serverOptions.push_back("Server.EventLoops=4");
+  m_serverOptions.push_back("Server.GracefulShutdownWait=3");
+  if (!StartServer("<?php echo 'loop';")) return false;
+  std::vector<string> pages;
+  for (int i = 0; i < 16; i++) {
+    pages.push_back(Fetch(s_server_port, "string", nullptr, nullptr, false));
+  }
+  time_t start = time(nullptr);
+  StopServerAndWait();
+  time_t elapsed = time(nullptr) - start;
+  m_serverOptions.clear();
+
+  for (auto const& page : pages) {
+    VS(String(page), "loop");
+  }
+  VERIFY(elapsed < 10);
+  return Count(true);
+}
+
+bool TestServer::TestWarmupProfile() {
+  // Only the VM replays a profile, and only from a repo.
+  if (Option::EnableEval < Option::FullEval) return CountSkip();
+
+  const char *input =
+    "<?php\n"
+    "function add($a, $b) { return $a + $b; }\n"
+    "class K { function twice($x) { return add($x, $x); } }\n"
+    "$k = new K; $s = 0;\n"
+    "for ($i = 0; $i < 100; $i++) $s += $k->twice($i);\n"
+    "echo $s;\n";
+
+  string cwd = Process::GetCurrentDirectory();
+  string repo = cwd + "/runtime/tmp/warmup-repo";
+  string profile = cwd + "/runtime/tmp/warmup.prof";
+  string log = cwd + "/runtime/tmp/warmup.log";
+  unlink(profile.c_str());
+  unlink(log.c_str());
+  {
+    std::ofstream f("runtime/tmp/string");
+    f << input;
+  }
+  {
+    string out, err;
+    string outputDir = "--output-dir=" + repo;
+    const char *argv[] = {"", "--hphp", "-thhbc", "-l0", "-k1",
+                          "--input-dir=runtime/tmp", outputDir.c_str(),
+                          "string", nullptr};
+    Process::Exec(HHVM_PATH, argv, nullptr, out, &err);
+  }
+
+  m_serverOptions.push_back("Repo.Authoritative=true");
+  m_serverOptions.push_back("Repo.Central.Path=" + repo + "/hhvm.hhbc");
+  m_serverOptions.push_back("Eval.Jit=true");
+  m_serverOptions.push_back("Eval.JitWarmupProfile=" + profile);
+
+  // The first server records the profile, and writes it as it exits.
+  m_serverOptions.push_back("Eval.JitWarmupProfileRecord=true");
+  if (!StartServer(input)) return false;
+  std::vector<string> pages;
+  for (int i = 0; i < 3; i++) {
+    pages.push_back(Fetch(s_server_port, "string", nullptr, nullptr, false));
+  }
+  StopServerAndWait();
+  m_serverOptions.pop_back();
+
+  std::vector<string> lines;
+  {
+    std::ifstream f(profile.c_str());
+    string line;
+    while (std::getline(f, line)) lines.push_back(line);
+  }
+
+  // The second one loads it before taking traffic.
+  m_serverOptions.push_back("Log.Level=Info");
+  m_serverOptions.push_back("Log.File=" + log);
+  if (!StartServer(input)) return false;
+  pages.push_back(Fetch(s_server_port, "string", nullptr, nullptr, false));
+  StopServerAndWait();
+  m_serverOptions.clear();
+
+  for (auto const& page : pages) {
+    VS(String(page), "9900");
+  }
+
+  // add() and K::twice(); the pseudo-main isn't recorded
+  VS((int)lines.size(), 3);
+  VS(String(lines[0]), "# hhvm jit warmup profile v1");
+  for (unsigned i = 1; i < lines.size(); i++) {
+    VERIFY(lines[i].size() > 6 &&
+           lines[i].compare(lines[i].size() - 6, 6, "string") == 0);
+  }
+
+  // Both funcs are marked hot, but only add() gets its prologue up
+  // front; methods don't have their Class yet.
+  int units = 0, funcs = 0, prologues = 0;
+  {
+    std::ifstream f(log.c_str());
+    string line;
+    const char *marker = "Jit warmup profile: ";
+    while (std::getline(f, line)) {
+      size_t pos = line.find(marker);
+      if (pos == string::npos) continue;
+      sscanf(line.c_str() + pos + strlen(marker),
+             "%d units, %d hot funcs, %d prologues",
+             &units, &funcs, &prologues);
+    }
+  }
+  VS(units, 1);
+  VS(funcs, 2);
+  VS(prologues, 1);
+  return Count(true);
+}
+
+bool TestServer::TestStaticETag() {
+  m_serverOptions.push_back("StaticFile.Extensions.txt=text/plain");
+  if (!StartServer("<?php echo 'page';")) return false;
+  {
+    std::ofstream f("runtime/tmp/etag.txt");
+    f << "static text";
+  }
+
+  int code;
+  string full = Fetch(s_server_port, "etag.txt", nullptr, nullptr, true,
+                      &code);
+  string etag;
+  size_t pos = full.find("ETag: ");
+  if (pos != string::npos) {
+    pos += strlen("ETag: ");
+    etag = full.substr(pos, full.find_first_of("\r\n", pos) - pos);
+  }
+  string strong = etag.compare(0, 2, "W/") == 0 ? etag.substr(2) : etag;
+
+  std::vector<string> match = {
+    etag,                    // as sent; the tag is weak
+    strong,                  // weak comparison ignores W/
+    "\"nope\", " + etag,     // one of a list
+    "*",
+  };
+  std::vector<int> matchCodes;
+  std::vector<string> matchBodies;
+  for (auto const& tags : match) {
+    string header = "If-None-Match: " + tags;
+    matchBodies.push_back(Fetch(s_server_port, "etag.txt", header.c_str(),
+                                nullptr, false, &code));
+    matchCodes.push_back(code);
+  }
+  string other = Fetch(s_server_port, "etag.txt",
+                       "If-None-Match: \"nope\"", nullptr, false, &code);
+  int otherCode = code;
+  string postHeader = "If-None-Match: " + etag;
+  string post = Fetch(s_server_port, "etag.txt", postHeader.c_str(), "x=1",
+                      false, &code);
+  int postCode = code;
+  StopServerAndWait();
+  m_serverOptions.clear();
+
+  VERIFY(etag.compare(0, 3, "W/\"") == 0);
+  for (unsigned i = 0; i < match.size(); i++) {
+    VS(matchCodes[i], 304);
+    VS(String(matchBodies[i]), "");
+  }
+  VS(otherCode, 200);
+  VS(String(other), "static text");
+  // a POST with a matching tag is served, not answered with a 304
+  VS(postCode, 200);
+  VS(String(post), "static text");
+  return Count(true);
+}
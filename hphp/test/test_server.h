@@ -19,6 +19,7 @@
 
 #include <test/test_code_run.h>
 #include <runtime/base/complex_types.h>
+#include <util/async_func.h>
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -65,9 +66,37 @@ public:
   // test PageletServer
   bool TestPageletServer();
 
+  // test the admin server's /vm-method-caches
+  bool TestMethodCacheStats();
+
+  // test that requests keep running across translation cache replaces
+  bool TestTCReplace();
+
+  // test serving from, and stopping, several event loops
+  bool TestEventLoops();
+
+  // test If-None-Match on static files
+  bool TestStaticETag();
+
+  // test that a restarted server warms up what the last one found hot
+  bool TestWarmupProfile();
+
 protected:
   void RunServer();
   void StopServer();
+
+  // Start a server that serves input as "string", with m_serverOptions
+  // added to its command line as -v options.
+  bool StartServer(const char *input);
+  void StopServerAndWait();
+  // Fetch path from the server on port, retrying while it starts up.
+  std::string Fetch(int port, const std::string &path, const char *header,
+                    const char *postdata, bool responseHeader,
+                    int *code = nullptr);
+
+  std::vector<std::string> m_serverOptions;
+  std::unique_ptr<AsyncFunc<TestServer> > m_serverThread;
+
   bool VerifyServerResponse(const char *input, const char *output,
                             const char *url, const char *method,
                             const char *header, const char *postdata,
@@ -15,6 +15,7 @@
 */
 
 #include "async_func.h"
+#include "maphuge.h"
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
@@ -27,6 +28,8 @@ void* AsyncFuncImpl::s_initFuncArg = nullptr;
 PFN_THREAD_FUNC* AsyncFuncImpl::s_finiFunc = nullptr;
 void* AsyncFuncImpl::s_finiFuncArg = nullptr;
 
+bool AsyncFuncImpl::s_hugeStacks = false;
+
 AsyncFuncImpl::AsyncFuncImpl(void *obj, PFN_THREAD_FUNC *func)
     : m_obj(obj), m_func(func),
       m_threadStack(nullptr), m_stackSize(0), m_threadId(0),
@@ -56,9 +59,17 @@ void AsyncFuncImpl::start() {
     rlim.rlim_cur = m_stackSizeMinimum;
   }
 
+  size_t stackSize = rlim.rlim_cur;
+  if (s_hugeStacks) {
+    stackSize = (stackSize + kHugePageSize - 1) & ~(kHugePageSize - 1);
+    m_threadStack = allocHuge(stackSize);
+  } else if (posix_memalign(&m_threadStack, Util::s_pageSize, stackSize)) {
+    m_threadStack = nullptr;
+  }
+
   // On Success use the allocated memory for the thread's stack
-  if (posix_memalign(&m_threadStack, Util::s_pageSize, rlim.rlim_cur) == 0) {
-    pthread_attr_setstack(&m_attr, m_threadStack, rlim.rlim_cur);
+  if (m_threadStack) {
+    pthread_attr_setstack(&m_attr, m_threadStack, stackSize);
   }
 
   pthread_create(&m_threadId, &m_attr, ThreadFunc, (void*)this);
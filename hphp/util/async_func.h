@@ -150,6 +150,13 @@ public:
     return s_finiFunc;
   }
 
+  /**
+   * Allocate thread stacks for threads started after this on huge pages.
+   */
+  static void SetHugeStacks(bool huge) {
+    s_hugeStacks = huge;
+  }
+
   void setNoInit() { m_noInit = true; }
 
 private:
@@ -161,6 +168,7 @@ private:
   static PFN_THREAD_FUNC* s_finiFunc;
   static void* s_initFuncArg;
   static void* s_finiFuncArg;
+  static bool s_hugeStacks;
   void* m_threadStack;
   size_t m_stackSize;
   pthread_attr_t m_attr;
@@ -19,6 +19,8 @@
 #include "logger.h"
 #include "exception.h"
 
+#include <lz4.h>
+
 #define PHP_ZLIB_MODIFIER 1000
 #define GZIP_HEADER_LENGTH 10
 #define GZIP_FOOTER_LENGTH 8
@@ -432,4 +434,111 @@ char *gzdecode(const char *data, int &len) {
   return nullptr;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+char *deflate_piece(const char *data, int len, int dictLen, int level,
+                    bool last, int &outLen) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  int status = deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS,
+                            MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+  if (status != Z_OK) {
+    Logger::Error("%s", zError(status));
+    return nullptr;
+  }
+  if (dictLen > 0) {
+    dictLen = std::min(dictLen, 1 << MAX_WBITS);
+    deflateSetDictionary(&stream, (const Bytef *)data - dictLen, dictLen);
+  }
+
+  // a sync flush takes a few bytes on top of the bound
+  int size = deflateBound(&stream, len) + 16;
+  char *out = (char *)malloc(size);
+  stream.next_in = (Bytef *)data;
+  stream.avail_in = len;
+  stream.next_out = (Bytef *)out;
+  stream.avail_out = size;
+
+  // all but the last piece end on a byte boundary without ending the stream
+  status = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+  bool done = last ? status == Z_STREAM_END :
+    (status == Z_OK && stream.avail_in == 0 && stream.avail_out > 0);
+  outLen = stream.total_out;
+  deflateEnd(&stream);
+  if (!done) {
+    free(out);
+    Logger::Error("%s", zError(status == Z_OK ? Z_BUF_ERROR : status));
+    return nullptr;
+  }
+  return out;
+}
+
+char *gzip_wrap(char *const *pieces, const int *lens, int count,
+                uLong crc, uLong size, int &len) {
+  len = GZIP_HEADER_LENGTH + GZIP_FOOTER_LENGTH;
+  for (int i = 0; i < count; i++) {
+    len += lens[i];
+  }
+  char *s2 = (char *)malloc(len + 1);
+  s2[0] = gz_magic[0];
+  s2[1] = gz_magic[1];
+  s2[2] = Z_DEFLATED;
+  s2[3] = s2[4] = s2[5] = s2[6] = s2[7] = s2[8] = 0; /* time set to 0 */
+  s2[9] = 0x03; // OS_CODE
+
+  char *p = s2 + GZIP_HEADER_LENGTH;
+  for (int i = 0; i < count; i++) {
+    memcpy(p, pieces[i], lens[i]);
+    p += lens[i];
+  }
+
+  /* write crc & size in LSB order */
+  for (int i = 0; i < 4; i++) {
+    p[i] = (char)(crc >> (i * 8)) & 0xFF;
+    p[i + 4] = (char)(size >> (i * 8)) & 0xFF;
+  }
+  s2[len] = '\0';
+  return s2;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// LZ4StreamCompressor
+
+static char *lz4_put_varint(char *p, uint32_t val) {
+  while (val >= 128) {
+    *p++ = 0x80 | (val & 0x7f);
+    val >>= 7;
+  }
+  *p++ = val;
+  return p;
+}
+
+char *LZ4StreamCompressor::compress(const char *data, int &len,
+                                    bool trailer) {
+  // two varints of at most 5 bytes each, plus the terminating frame
+  char *s2 = (char *)malloc(LZ4_compressBound(len) + 10 + 1 + 1);
+  char *p = s2;
+  if (len) {
+    char *sizes = p;
+    p += 10;
+    int clen = LZ4_compress(data, p, len);
+    if (clen <= 0) {
+      free(s2);
+      Logger::Error("LZ4 compression failed: len=%d", len);
+      return nullptr;
+    }
+    // now that we know how long the block is, move it up behind its sizes
+    char *block = lz4_put_varint(lz4_put_varint(sizes, len), clen);
+    memmove(block, p, clen);
+    p = block + clen;
+  }
+  if (trailer) {
+    p = lz4_put_varint(p, 0);
+  }
+  len = p - s2;
+  *p = '\0';
+  return s2;
+}
+
+///////////////////////////////////////////////////////////////////////////////
 }
@@ -33,17 +33,47 @@ bool is_compressible_file(const char *filename);
 char *gzencode(const char *data, int &len, int level, int encoding_mode);
 char *gzdecode(const char *data, int &len);
 
+/**
+ * For building one gzip stream out of pieces deflated separately, maybe at
+ * the same time: deflate_piece() each one, passing how many of the bytes
+ * just before it to use as a dictionary (up to 32KB; that keeps the ratio
+ * close to compressing it all in one go), then gzip_wrap() the results in
+ * order with the crc32 and size of all the input.
+ */
+char *deflate_piece(const char *data, int len, int dictLen, int level,
+                    bool last, int &outLen);
+char *gzip_wrap(char *const *pieces, const int *lens, int count,
+                uLong crc, uLong size, int &len);
+
 ///////////////////////////////////////////////////////////////////////////////
 
-class StreamCompressor {
+/**
+ * A codec compressing a response one chunk at a time, as it's sent out.
+ * compress() returns a malloc-ed buffer and sets len to its size, or
+ * returns null on failure; trailer is set on the last call, which may have
+ * no data. encoding() is the Content-Encoding to send with the output.
+ */
+class Compressor {
+public:
+  virtual ~Compressor() {}
+
+  virtual const char *encoding() const = 0;
+  virtual char *compress(const char *data, int &len, bool trailer) = 0;
+};
+
+class StreamCompressor : public Compressor {
 public:
   StreamCompressor(int level, int encoding_mode, bool header);
   ~StreamCompressor();
 
+  virtual const char *encoding() const {
+    return m_encoding == CODING_GZIP ? "gzip" : "deflate";
+  }
+
   /**
    * Compress one chunk a time.
    */
-  char *compress(const char *data, int &len, bool trailer);
+  virtual char *compress(const char *data, int &len, bool trailer);
 
 private:
   int m_level;
@@ -54,6 +84,20 @@ private:
   bool m_ended;
 };
 
+/**
+ * Cheap compression for internal clients that can take it, as
+ * "Content-Encoding: x-lz4". Each chunk becomes a frame of
+ *
+ *   varint uncompressed size, varint compressed size, LZ4 block
+ *
+ * and a zero uncompressed size ends the stream.
+ */
+class LZ4StreamCompressor : public Compressor {
+public:
+  virtual const char *encoding() const { return "x-lz4";}
+  virtual char *compress(const char *data, int &len, bool trailer);
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 }
 
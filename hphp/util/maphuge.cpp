@@ -14,11 +14,13 @@
    +----------------------------------------------------------------------+
 */
 
+#include <stdlib.h>
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/types.h>
 
 #include "util/kernel_version.h"
+#include "util/maphuge.h"
 
 namespace HPHP {
 
@@ -33,4 +35,11 @@ void hintHuge(void* mem, size_t length) {
 #endif
 }
 
+void* allocHuge(size_t length) {
+  void* mem;
+  if (posix_memalign(&mem, kHugePageSize, length) != 0) return nullptr;
+  hintHuge(mem, length);
+  return mem;
+}
+
 }
@@ -13,6 +13,23 @@
    | license@php.net so we can mail you a copy immediately.               |
    +----------------------------------------------------------------------+
 */
+#ifndef incl_HPHP_UTIL_MAPHUGE_H_
+#define incl_HPHP_UTIL_MAPHUGE_H_
+
+#include <stddef.h>
+
 namespace HPHP {
+
+const size_t kHugePageSize = 2 << 20;
+
 void hintHuge(void* mem, size_t length);
+
+/*
+ * Allocate length bytes, aligned to a huge page and hinted for huge
+ * pages, or return nullptr.  Release with free().
+ */
+void* allocHuge(size_t length);
+
 }
+
+#endif
@@ -0,0 +1,114 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010- Facebook, Inc. (http://www.facebook.com)         |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef __HPHP_STRING_SCAN_H__
+#define __HPHP_STRING_SCAN_H__
+
+#include <stddef.h>
+
+#ifdef __x86_64__
+#include <emmintrin.h>
+#endif
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Escaping functions like htmlspecialchars(), addslashes() and urlencode()
+ * spend most of their time on long runs of bytes they copy unchanged.
+ * scan_for<Set>() finds the end of such a run 16 bytes at a time, so the
+ * caller can memcpy the run and only look at the bytes in between.
+ *
+ * A Set has static match() functions for a single byte and, on x86_64,
+ * for a 16-byte vector (0xff in each byte that matches). We only use
+ * SSE2, which every x86_64 cpu has, so there is no cpu check to make;
+ * other platforms get the byte loop.
+ */
+
+template<class Set>
+inline const char *scan_for(const char *p, const char *end) {
+#ifdef __x86_64__
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    int mask = _mm_movemask_epi8(Set::match(v));
+    if (mask) return p + __builtin_ctz(mask);
+    p += 16;
+  }
+#endif
+  while (p < end && !Set::match((unsigned char)*p)) p++;
+  return p;
+}
+
+/*
+ * Any of the bytes Cs.
+ */
+template<char... Cs> struct AnyOf;
+
+template<> struct AnyOf<> {
+  static bool match(unsigned char c) { return false; }
+#ifdef __x86_64__
+  static __m128i match(__m128i v) { return _mm_setzero_si128(); }
+#endif
+};
+
+template<char C, char... Cs> struct AnyOf<C, Cs...> {
+  static bool match(unsigned char c) {
+    return c == (unsigned char)C || AnyOf<Cs...>::match(c);
+  }
+#ifdef __x86_64__
+  static __m128i match(__m128i v) {
+    return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(C)),
+                        AnyOf<Cs...>::match(v));
+  }
+#endif
+};
+
+/*
+ * Bytes outside 7-bit ASCII.
+ */
+struct NonAscii {
+  static bool match(unsigned char c) { return c >= 0x80; }
+#ifdef __x86_64__
+  static __m128i match(__m128i v) {
+    return _mm_cmplt_epi8(v, _mm_setzero_si128());
+  }
+#endif
+};
+
+template<class A, class B> struct Either {
+  static bool match(unsigned char c) { return A::match(c) || B::match(c); }
+#ifdef __x86_64__
+  static __m128i match(__m128i v) {
+    return _mm_or_si128(A::match(v), B::match(v));
+  }
+#endif
+};
+
+#ifdef __x86_64__
+/*
+ * 0xff in the bytes of v between lo and hi inclusive; both must be ASCII,
+ * since SSE2 only has signed byte compares.
+ */
+inline __m128i byte_range(__m128i v, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                       _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif // __HPHP_STRING_SCAN_H__
@@ -17,6 +17,7 @@
 
 #include "util/zend/zend_html.h"
 #include <util/lock.h>
+#include <util/string_scan.h>
 #include <unicode/uchar.h>
 #include <unicode/utf8.h>
 
@@ -474,8 +475,18 @@ char *string_html_encode(const char *input, int &len, bool encode_double_quote,
   if (!ret) {
     return nullptr;
   }
+  typedef AnyOf<'"', '\'', '<', '>', '&'> Special;
   char *q = ret;
   for (const char *p = input, *end = input + len; p < end; p++) {
+    // Copy the run up to the next byte that might need encoding in one go.
+    const char *run = nbsp ? scan_for<Either<Special, NonAscii> >(p, end)
+                           : scan_for<Special>(p, end);
+    if (run != p) {
+      memcpy(q, p, run - p);
+      q += run - p;
+      p = run;
+      if (p == end) break;
+    }
     char c = *p;
     switch (c) {
     case '"':